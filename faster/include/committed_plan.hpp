@@ -0,0 +1,170 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2020, Jesus Tordesillas Torres, Aerospace Controls Laboratory
+ * Massachusetts Institute of Technology
+ * All Rights Reserved
+ * Authors: Jesus Tordesillas, et al.
+ * See LICENSE file for the license information
+ * -------------------------------------------------------------------------- */
+
+#ifndef COMMITTED_PLAN_HPP
+#define COMMITTED_PLAN_HPP
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include "faster_types.hpp"
+
+// Committed trajectory, shared between the setpoint publisher (consumer) and the planner (producer).
+//
+// The states live in a ring buffer and are addressed with absolute indexes: front_ is the next state to publish (all
+// the states before it have been sent), and end_ is one past the last committed state. The consumer never takes a
+// lock: it announces its read with reading_ and then checks end_. A commit first moves end_ back to the first state it
+// replaces (so no new reads of those states can start), waits for a read in progress (if any) and then checks front_:
+// if that state has already been sent, the commit is rejected ("already published"). Otherwise it writes the new
+// states and publishes the new end_. The consumer is only held while a commit replaces the very next state.
+// Producers (replan and the first state) are serialized with mtx_producer_.
+class CommittedPlan
+{
+public:
+  CommittedPlan(int capacity = 16384) : slots_(capacity)
+  {
+  }
+
+  enum Read
+  {
+    EMPTY,       // Nothing has been committed yet (data is not written)
+    NEXT,        // The next state, front_ advances
+    EXHAUSTED,   // All the committed states have been sent: the last one again
+    COMMITTING,  // A commit is replacing the next state right now: the last one sent again (held for this call)
+  };
+
+  ///////////////////////// Consumer (only one thread) /////////////////////////
+
+  // Returns the next state and advances to the following one. After the last committed state, it's returned again
+  // until a new trajectory is committed
+  Read next(state& data)
+  {
+    int64_t f = front_.load(std::memory_order_relaxed);
+    reading_.store(true, std::memory_order_seq_cst);
+    int64_t e = end_.load(std::memory_order_seq_cst);
+
+    Read read = EXHAUSTED;
+    if (f < e)
+    {
+      last_ = slots_[f % slots_.size()];
+      has_last_ = true;
+      front_.store(f + 1, std::memory_order_seq_cst);  // From now on, no commit can replace the state f
+      read = NEXT;
+    }
+    else if (committing_.load(std::memory_order_seq_cst) || end_.load(std::memory_order_seq_cst) > f)
+    {
+      read = COMMITTING;  // end_ is moved back during a commit (or the commit has just finished)
+    }
+
+    reading_.store(false, std::memory_order_release);
+
+    if (has_last_ == false)
+    {
+      return EMPTY;
+    }
+    data = last_;
+    return read;
+  }
+
+  ///////////////////////// Producers /////////////////////////
+
+  // Number of states not published yet (0 if the consumer is repeating the last one)
+  int size() const
+  {
+    return end_.load() - front_.load();
+  }
+
+  // State at position k counting from the end (k=0 is the last state, that may have been published)
+  state fromEnd(int k)
+  {
+    std::lock_guard<std::mutex> lock(mtx_producer_);
+    return slots_[(end_.load() - 1 - k) % slots_.size()];
+  }
+
+  state back()
+  {
+    return fromEnd(0);
+  }
+
+  // Replaces the last k_end+1 states (i.e. from A=fromEnd(k_end) onwards) with states. k_end=-1 appends them. Returns
+  // false (and keeps the committed plan) if A was already published
+  bool commit(int k_end, const std::vector<state>& states)
+  {
+    std::lock_guard<std::mutex> lock(mtx_producer_);
+
+    int64_t old_end = end_.load();
+    int64_t a = old_end - 1 - k_end;
+
+    committing_.store(true, std::memory_order_seq_cst);
+    end_.store(a, std::memory_order_seq_cst);  // No new reads of the states >= a can start from now on
+    while (reading_.load(std::memory_order_seq_cst))
+    {
+      std::this_thread::yield();  // The consumer is copying one state
+    }
+    int64_t f = front_.load(std::memory_order_seq_cst);
+
+    // a < f: the state a has been sent
+    if (a < f || (a + (int64_t)states.size() - f) > (int64_t)slots_.size())
+    {
+      end_.store(old_end, std::memory_order_seq_cst);
+      committing_.store(false, std::memory_order_seq_cst);
+      return false;
+    }
+
+    for (size_t i = 0; i < states.size(); i++)
+    {
+      slots_[(a + i) % slots_.size()] = states[i];
+    }
+    end_.store(a + states.size(), std::memory_order_seq_cst);
+    committing_.store(false, std::memory_order_seq_cst);
+    generation_++;
+    return true;
+  }
+
+  void push_back(const state& data)
+  {
+    commit(-1, std::vector<state>(1, data));
+  }
+
+  // Absolute indexes (they never go back): front is the next state to publish, end is one past the last state (front
+  // == end once all the states have been sent)
+  int64_t frontIndex() const
+  {
+    return front_.load();
+  }
+
+  int64_t endIndex() const
+  {
+    return end_.load();
+  }
+
+  // Incremented every time a commit succeeds
+  uint64_t generation() const
+  {
+    return generation_.load();
+  }
+
+private:
+  std::vector<state> slots_;
+
+  std::atomic<int64_t> front_{ 0 };
+  std::atomic<int64_t> end_{ 0 };
+  std::atomic<bool> reading_{ false };
+  std::atomic<bool> committing_{ false };  // Between moving end_ back and publishing the new end_
+  std::atomic<uint64_t> generation_{ 0 };
+
+  // Only used by the consumer
+  state last_;
+  bool has_last_ = false;
+
+  std::mutex mtx_producer_;
+};
+
+#endif
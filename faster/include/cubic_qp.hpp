@@ -0,0 +1,101 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2020, Jesus Tordesillas Torres, Aerospace Controls Laboratory
+ * Massachusetts Institute of Technology
+ * All Rights Reserved
+ * Authors: Jesus Tordesillas, et al.
+ * See LICENSE file for the license information
+ * -------------------------------------------------------------------------- */
+
+#ifndef CUBIC_QP_HPP
+#define CUBIC_QP_HPP
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <Eigen/Dense>
+#include <decomp_geometry/polyhedron.h>
+
+// QP of the trajectory when the polytope of each interval is fixed (the convex problem of SolverGurobi::convex_).
+// X0 and the continuity between intervals are eliminated: the state at the start of each interval is an affine
+// function of the jerks of the previous intervals, so the only variables are the 3*N jerks, the cost (sum of the
+// squared jerks) is diagonal and the only equalities are the ones of Xf. It's solved with the dual active set method
+// of Goldfarb and Idnani, which gives the exact optimum (or proves that there is none) in a few iterations for
+// problems this small. All the memory is allocated in resize()
+class CubicQP
+{
+public:
+  enum Status
+  {
+    SOLVED,
+    INFEASIBLE,
+    MAX_ITERATIONS,
+    STOPPED,
+    NUMERIC  // Stopped at a point that violates a constraint (degenerate steps)
+  };
+
+  // N intervals, and at most max_faces faces per polytope. Only allocates if the workspace is smaller
+  void resize(int N, int max_faces);
+
+  // x0 and xf: pos, vel and accel. force_final: also the final position
+  void setProblem(const double x0[9], const double xf[9], bool force_final, double dt, double v_max, double a_max,
+                  double j_max);
+  // The interval t is inside polytopes[assignment[t]]. Call it after setProblem()
+  void setPolytopes(const std::vector<LinearConstraint3D>& polytopes, const std::vector<int>& assignment);
+
+  // Checks stop and deadline every 16 iterations
+  Status solve(const std::atomic<bool>* stop, std::chrono::steady_clock::time_point deadline);
+
+  double cost() const;  // Objective of SolverGurobi: sum of the squared jerk of all the intervals
+  // With the layout of TrajectorySolver::getCoefficients()
+  void getCoefficients(std::vector<double>& coeffs) const;
+  int iterations() const
+  {
+    return iterations_;
+  }
+
+  int max_iter = 1000;
+
+private:
+  typedef Eigen::Matrix<double, 3, Eigen::Dynamic> Mat3X;
+
+  // coeffs * jerks + constant <= upper (coeffs(i, k): axis i of the interval k), in the columns of CI_ or CE_ as
+  // CI_' * x + ci0_ >= 0 and CE_' * x + ce0_ = 0. addInequality() returns false if the row doesn't depend on the jerks
+  // and is violated
+  bool addInequality(const Mat3X& coeffs, double constant, double upper);
+  void addEquality(const Mat3X& coeffs, double constant, double value);
+
+  Status checkFeasible();  // SOLVED or NUMERIC
+  void updateZR(int iq);   // d_ --> z_, r_
+  bool addConstraint(int& iq, double& R_norm);
+  void deleteConstraint(int& iq, int l);
+
+  int N_ = 0;
+  int n_ = 0;  // 3 * N_
+  int max_faces_ = 0;
+  double dt_ = 1;
+  double j_max_ = 1;  // x_ = jerks / j_max_
+  int iterations_ = 0;
+
+  // Affine maps from the jerks (of one axis, the same for the 3) to the pos, vel and accel at the start of each
+  // interval (rows 0..N): state = S.row(t) * jerks + s0.row(t)(axis)
+  Eigen::MatrixXd Sp_, Sv_, Sa_, Sp0_, Sv0_, Sa0_;
+  // Same for the Bezier control point k of the interval t (row 4t+k), see SolverGurobi::setPolytopesConstraints()
+  Eigen::MatrixXd Scp_, Scp0_;
+  Mat3X row_;  // Scratch of addInequality()
+
+  Eigen::MatrixXd CI_, CE_;
+  Eigen::VectorXd ci0_, ce0_;
+  int mi_ = 0, me_ = 0;
+  int mi_fixed_ = 0;            // Rows of CI_ of the limits (before the faces)
+  bool fixed_infeasible_ = false;  // Violated rows that don't depend on the jerks
+  bool faces_infeasible_ = false;
+
+  // Goldfarb-Idnani: J_ = L^-T Q, R_ upper triangular of the active constraints, u_ multipliers and A_ indexes of
+  // the active constraints (-i-1 for the equality i), iai_[i] = -1 if the inequality i is active
+  Eigen::MatrixXd J_, R_;
+  Eigen::VectorXd x_, x_old_, s_, d_, z_, r_, u_, u_old_;
+  std::vector<int> A_, A_old_, iai_;
+  std::vector<bool> excluded_;
+};
+
+#endif
@@ -14,6 +14,8 @@
 #include <math.h>
 #include <algorithm>
 #include <vector>
+#include <deque>
+#include <future>
 #include <stdlib.h>
 
 #include "timer.hpp"
@@ -21,8 +23,10 @@
 #include "faster_types.hpp"
 // Solvers includes
 //#include "solvers/solvers.hpp" CVXGEN solver interface
-#include "solverGurobi.hpp"
+#include "trajectory_solver.hpp"
 #include "jps_manager.hpp"
+#include "committed_plan.hpp"
+#include "telemetry.hpp"
 
 #define MAP 1          // MAP refers to the occupancy grid
 #define UNKNOWN_MAP 2  // UNKNOWN_MAP refers to the unkown grid
@@ -50,6 +54,45 @@ enum PlannerStatus
 using namespace JPS;
 using namespace termcolor;
 
+// Output of the front end of a replan (JPS + convex decomposition for the whole trajectory). With replan_pipeline, the
+// front end of the next replan runs while Gurobi solves the current one
+struct FrontEnd
+{
+  std::shared_ptr<const MapSnapshot> map;  // Snapshot used
+  uint64_t goal_generation = 0;            // Goal used
+  state A;                                 // Start of JPS
+  bool solved = false;                     // JPS found a solution
+  vec_Vecf<3> JPS_in;                      // Part of JPS inside the sphere S
+  vec_Vecf<3> JPS_whole;                   // JPS_in with at most max_poly_whole segments (only if use_faster)
+  std::vector<LinearConstraint3D> l_constraints_whole;
+  vec_E<Polyhedron<3>> poly_whole;
+  state E;  // End of JPS_whole
+  double jps_ms = -1;
+  double decomp_whole_ms = -1;
+  double jps_length = -1;  // [m] Length of the whole JPS path
+};
+
+// Polytopes that contain the states [first, last] (absolute indexes of plan_) of the committed plan
+struct CorridorPiece
+{
+  int64_t first;
+  int64_t last;
+  std::vector<LinearConstraint3D> polytopes;
+};
+
+// Safe path from one candidate rescue point R (see safe_candidates)
+struct SafeCandidate
+{
+  int k_safe;  // Index of R in the whole trajectory
+  vec_Vecf<3> JPS_safe;
+  std::vector<LinearConstraint3D> l_constraints_safe;
+  vec_E<Polyhedron<3>> poly_safe;
+  state M;
+  bool solved = false;
+  double decomp_safe_ms = -1;
+  double gurobi_safe_ms = -1;
+};
+
 class Faster
 {
 public:
@@ -57,22 +100,33 @@ public:
   void replan(vec_Vecf<3>& JPS_safe_out, vec_Vecf<3>& JPS_whole_out, vec_E<Polyhedron<3>>& poly_safe_out,
               vec_E<Polyhedron<3>>& poly_whole_out, std::vector<state>& X_safe_out, std::vector<state>& X_whole_out);
   void updateState(state data);
+  bool replanNeeded();  // True if something changed (map, goal, status) or the committed plan is running low
 
   void updateMap(pcl::PointCloud<pcl::PointXYZ>::Ptr pclptr_map, pcl::PointCloud<pcl::PointXYZ>::Ptr pclptr_unk);
   bool getNextGoal(state& next_goal);
   void getState(state& data);
   void getG(state& G);
+  void getReplanTimes(replan_times& times);  // Timings of the last call to replan()
+  void getReplanRecord(replan_record& record);  // Summary of the last call to replan() (see Telemetry)
+  // Starts logging a replan_record per replan() to telemetry_file (if not empty) and to sink (if not nullptr)
+  void startTelemetry(Telemetry::Sink sink = nullptr);
+  // Builds the models of the solvers for max_poly_whole and max_poly_safe polytopes (and all the N with adaptive_size),
+  // so that the first replan isn't slower than the rest. Call it once, after the constructor
+  void warmUpSolvers();
   void setTerminalGoal(state& term_goal);
   void resetInitialization();
 
 private:
   state M_;
-  std::deque<state> plan_;
+  CommittedPlan plan_;  // States committed, read without locks by getNextGoal()
 
   double previous_yaw_ = 0.0;
 
-  SolverGurobi sg_whole_;  // solver gurobi whole trajectory
-  SolverGurobi sg_safe_;   // solver gurobi whole trajectory
+  std::unique_ptr<TrajectorySolver> sg_whole_;  // solver whole trajectory
+  std::unique_ptr<TrajectorySolver> sg_safe_;   // solver safe trajectory
+  std::vector<std::unique_ptr<TrajectorySolver>> sg_safe_candidates_;  // For the candidates R earlier than the one
+                                                                       // of findIndexR (safe_candidates>1)
+  std::vector<TrajectorySolver*> safe_solvers_;                         // sg_safe_, and then sg_safe_candidates_
 
   JPS_Manager jps_manager_;  // Manager of JPS
 
@@ -82,11 +136,12 @@ private:
 
   // void yaw(double diff, snapstack_msgs::QuadGoal& quad_goal);
   void createMoreVertexes(vec_Vecf<3>& path, double d);
+  void mergeStraightVertexes(vec_Vecf<3>& path, double d);
 
   int findIndexR(int indexH);
 
-  int findIndexH(bool& needToComputeSafePath);
-  bool ARisInFreeSpace(int index);
+  int findIndexH(const MapSnapshot& map, bool& needToComputeSafePath);
+  bool ARisInFreeSpace(const MapSnapshot& map, int index);
 
   void updateInitialCond(int i);
 
@@ -101,14 +156,31 @@ private:
   // map B if JPS was computed using an older map A
   // If type_return==Intersection, it returns the last point in the JPS path that is at least par_.inflation_jps from
   // map
-  Eigen::Vector3d getFirstCollisionJPS(vec_Vecf<3>& path, bool* thereIsIntersection, int map, int type_return);
+  Eigen::Vector3d getFirstCollisionJPS(const MapSnapshot& map, vec_Vecf<3>& path, bool* thereIsIntersection,
+                                       int map_type, int type_return);
 
   bool appendToPlan(int k_end_whole, const std::vector<state>& whole, int k_safe, const std::vector<state>& safe);
 
+  FrontEnd runFrontEnd(std::shared_ptr<const MapSnapshot> map, uint64_t goal_generation, state A, state G,
+                       double dist_to_goal, std::chrono::steady_clock::time_point deadline);
+  bool canStitch(FrontEnd& front, const std::shared_ptr<const MapSnapshot>& map, const state& A);
+  SafeCandidate solveSafe(TrajectorySolver& sg, const MapSnapshot& map, int k_safe, state x0, vec_Vecf<3> JPS_safe,
+                          state G, std::chrono::steady_clock::time_point deadline);
+
+  void updateDeltaT(int states_last_replan);
+  int countFaces(const std::vector<LinearConstraint3D>& constraints);
+  ReplanOutcome replanStages(vec_Vecf<3>& JPS_safe_out, vec_Vecf<3>& JPS_whole_out,
+                             vec_E<Polyhedron<3>>& poly_safe_out, vec_E<Polyhedron<3>>& poly_whole_out,
+                             std::vector<state>& X_safe_out, std::vector<state>& X_whole_out);
+
+  void updateCorridor(int64_t a, int k_safe, int n_states);
+  bool corridorIsFree(const MapSnapshot& map);
+
   bool initialized();
   bool initializedAllExceptPlanner();
 
   void print_status();
+  const char* statusName(int status);
 
   parameters par_;
 
@@ -128,20 +200,37 @@ private:
   std::vector<LinearConstraint3D> l_constraints_whole_;  // Polytope (Linear) constraints
   std::vector<LinearConstraint3D> l_constraints_safe_;   // Polytope (Linear) constraints
 
-  int deltaT_ = 10;
+  int deltaT_ = 10;  // A is chosen deltaT_ states before the end of the committed plan (see updateDeltaT())
   int deltaT_min_ = 10;
   int indexR_ = 0;
 
+  std::deque<int> states_replans_;  // States published during each one of the last replans
+
+  // Incremented by updateMap() and setTerminalGoal(). replanNeeded() compares them with the ones the last replan used
+  std::atomic<uint64_t> map_generation_{ 0 };
+  std::atomic<uint64_t> goal_generation_{ 0 };
+  uint64_t map_generation_replan_ = 0;
+  uint64_t goal_generation_replan_ = 0;
+  int drone_status_replan_ = DroneStatus::GOAL_REACHED;
+  bool last_replan_succeeded_ = false;
+
+  std::vector<CorridorPiece> corridor_;               // Polytopes of the committed plan (only if revalidate_plan)
+  std::shared_ptr<const MapSnapshot> map_validated_;  // Last map the corridor was checked against
+
+  std::future<FrontEnd> next_front_end_;  // Front end started by the previous replan (only with replan_pipeline)
+
   Eigen::MatrixXd U_safe_, X_safe_;
   double spinup_time_;
   double z_start_;
 
-  pcl::KdTreeFLANN<pcl::PointXYZ> kdtree_map_;       // kdtree of the point cloud of the occuppancy grid
-  pcl::KdTreeFLANN<pcl::PointXYZ> kdtree_unk_;       // kdtree of the point cloud of the unknown grid
   pcl::KdTreeFLANN<pcl::PointXYZ> kdtree_frontier_;  // kdtree of the frontier
 
-  bool kdtree_map_initialized_ = 0;
-  bool kdtree_unk_initialized_ = 0;
+  // Last map received (kdtrees, voxel map for JPS, obstacles). Use only std::atomic_load/std::atomic_store on it
+  std::shared_ptr<const MapSnapshot> map_snapshot_;
+
+  // Checked by getNextGoal() without touching map_snapshot_
+  std::atomic<bool> kdtree_map_initialized_{ false };
+  std::atomic<bool> kdtree_unk_initialized_{ false };
 
   bool terminal_goal_initialized_ = false;
 
@@ -160,14 +249,8 @@ private:
 
   double dyaw_filtered_ = 0;
 
-  pcl::PointCloud<pcl::PointXYZ>::Ptr pclptr_map_;
-  pcl::PointCloud<pcl::PointXYZ>::Ptr pclptr_unk_;
-
-  std::mutex mtx_map;  // mutex of occupied map (kdtree_map_)
-  std::mutex mtx_unk;  // mutex of unkonwn map (pclptr_unk_)
   std::mutex mtx_frontier;
   std::mutex mtx_inst;  // mutex of instanteneous data (v_kdtree_new_pcls_)
-  std::mutex mtx_goals;
 
   std::mutex mtx_k;
   std::mutex mtx_X_U_temp;
@@ -177,7 +260,6 @@ private:
   std::mutex mtx_initial_cond;
   std::mutex mtx_state;
   std::mutex mtx_offsets;
-  std::mutex mtx_plan_;
   // std::mutex mtx_factors;
 
   std::mutex mtx_G;
@@ -194,4 +276,8 @@ private:
   state state_;
   state G_;       // This goal is always inside of the map
   state G_term_;  // This goal is the clicked goal
+
+  replan_times times_;
+  replan_record record_;  // Of the replan in progress
+  Telemetry telemetry_;
 };
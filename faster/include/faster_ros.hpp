@@ -28,6 +28,7 @@
 #include <snapstack_msgs/State.h>
 #include <snapstack_msgs/Goal.h>
 #include <faster_msgs/Mode.h>
+#include <faster_msgs/ReplanRecord.h>
 
 // TimeSynchronizer includes
 #include <message_filters/subscriber.h>
@@ -35,7 +36,8 @@
 #include <message_filters/sync_policies/exact_time.h>
 #include <message_filters/sync_policies/approximate_time.h>
 
-#include "utils.hpp"
+#include <decomp_ros_utils/data_ros_utils.h>
+#include "ros_utils.hpp"
 
 #include "faster.hpp"
 #include "faster_types.hpp"
@@ -69,6 +71,7 @@ private:
   void modeCB(const faster_msgs::Mode& msg);
   void pubCB(const ros::TimerEvent& e);
   void replanCB(const ros::TimerEvent& e);
+  void pubReplanRecord(const replan_record& record);  // Called from the telemetry thread
 
   visualization_msgs::Marker createMarkerLineStrip(Eigen::MatrixXd X);
 
@@ -148,6 +151,7 @@ private:
   ros::Publisher pub_log_;
   ros::Publisher poly_whole_pub_;
   ros::Publisher poly_safe_pub_;
+  ros::Publisher pub_replan_record_;
 
   // ros::Publisher cvx_decomp_poly_uo_pub_;
   ros::Subscriber sub_goal_;
@@ -8,6 +8,11 @@
 
 #pragma once
 
+#include <string>
+#include <stdint.h>
+#include <iostream>
+#include <Eigen/Dense>
+
 struct polytope
 {
   Eigen::MatrixXd A;
@@ -53,11 +58,43 @@ struct parameters
   int max_poly_safe;
   double dist_max_vertexes;
 
+  bool adaptive_size;
+  int adaptive_N_min;
+  double adaptive_length_per_interval;
+  double adaptive_length_per_poly;
+
+  bool solution_cache;
+  int solution_cache_size;
+  double solution_cache_resolution;
+
   int gurobi_threads;
+  int parallel_factors;
+  bool factor_bisection;
+  bool warm_start;
+  int monotone_qp;
+  bool monotone_binaries;
+  bool lazy_faces;
+  double lazy_faces_margin;
+  std::string gurobi_formulation;
+  std::string solver_backend;
   int gurobi_verbose;
 
   bool use_faster;
 
+  double replan_horizon_min;
+  int replan_latency_window;
+  double replan_latency_percentile;
+  double replan_deadline;
+  bool replan_pipeline;
+
+  bool revalidate_plan;
+
+  int safe_candidates;
+  double safe_candidates_dt;
+
+  std::string telemetry_file;
+  bool telemetry_topic;
+
   double wdx;
   double wdy;
   double wdz;
@@ -162,4 +199,67 @@ struct state
     std::cout << "Pos, Vel, Accel, Jerk= " << pos.transpose() << " " << vel.transpose() << " " << accel.transpose()
               << " " << jerk.transpose() << std::endl;
   }
-};
\ No newline at end of file
+};
+// Wall-clock time [ms] spent in each stage of the last call to Faster::replan(). A stage that was not reached keeps
+// the value -1 (also jps and decomp_whole when they were run by the previous replan, see replan_pipeline)
+struct replan_times
+{
+  double jps = -1;           // JPS search
+  double decomp_whole = -1;  // Convex decomposition along JPS (occupied space)
+  double gurobi_whole = -1;  // Gurobi, whole trajectory
+  double decomp_safe = -1;   // Convex decomposition around the rescue path (unknown and occupied space)
+  double gurobi_safe = -1;   // Gurobi, safe trajectory
+  double incumbent_whole = -1;  // Gurobi, whole trajectory, until the first incumbent of the factor that worked
+  double incumbent_safe = -1;   // Same for the safe trajectory
+  double fillX = -1;         // Sampling of both solutions (whole + safe)
+  double append = -1;        // Appending the new trajectory to plan_
+  double total = -1;         // Whole replan() call, only set if the replan succeeded
+};
+
+// Result of a call to Faster::replan()
+enum ReplanOutcome
+{
+  REPLAN_OK = 0,
+  REPLAN_NOT_INITIALIZED = 1,  // State, map or terminal goal not received yet
+  REPLAN_NOT_TRAVELING = 2,    // Goal reached or yawing: nothing to plan
+  REPLAN_JPS_FAILED = 3,
+  REPLAN_WHOLE_FAILED = 4,
+  REPLAN_SAFE_FAILED = 5,
+  REPLAN_A_PUBLISHED = 6  // Solution found, but A had already been published (see CommittedPlan::commit())
+};
+
+// Summary of one call to Faster::replan(), see Telemetry. It is written to the telemetry file byte by byte, so it only
+// has fixed-size fields (doubles first, so that there is no padding). Changing it requires a new TELEMETRY_VERSION
+struct replan_record
+{
+  double stamp = 0;  // [s] Wall clock (since epoch) at the start of the replan
+  replan_times times;
+  double runtime_whole_ms = -1;  // Gurobi runtime reported by SolverGurobi (all the trials)
+  double runtime_safe_ms = -1;
+  double factor_whole = -1;  // factor_that_worked_
+  double factor_safe = -1;
+  double jps_length = -1;  // [m] Length of the JPS path, from A to G
+  double nodes_whole = -1;  // Branch-and-bound nodes explored by Gurobi (all the trials)
+  double nodes_safe = -1;
+  double iterations_whole = -1;  // Simplex and barrier iterations of Gurobi (all the trials)
+  double iterations_safe = -1;
+
+  int32_t outcome = REPLAN_NOT_INITIALIZED;
+  int32_t trials_whole = -1;
+  int32_t trials_safe = -1;
+  int32_t n_poly_whole = -1;  // Number of polytopes
+  int32_t n_poly_safe = -1;
+  int32_t n_faces_whole = -1;  // Sum of the number of faces of all the polytopes
+  int32_t n_faces_safe = -1;
+  int32_t safe_candidate = -1;  // Candidate R used (see safe_candidates)
+  int32_t n_points_map = -1;    // Points of the map snapshot used
+  int32_t n_points_unk = -1;
+  int32_t deltaT = -1;  // [states] Between A and the end of the committed plan
+  int32_t stitched = 0;  // 1 if the front end came from the previous replan (see replan_pipeline)
+  int32_t numeric_whole = -1;  // Solves that ended with numerical trouble (TrajectorySolver::numeric_issues_)
+  int32_t numeric_safe = -1;
+  int32_t n_intervals_whole = -1;  // N of the problem (see adaptive_size)
+  int32_t n_intervals_safe = -1;
+  int32_t cache_hit_whole = -1;  // 1 if the solution came from the solution_cache
+  int32_t cache_hit_safe = -1;
+};
@@ -7,9 +7,11 @@
  * -------------------------------------------------------------------------- */
 
 // Class JPS Manager
-#include "ros/ros.h"
+#ifndef JPS_MANAGER_HPP
+#define JPS_MANAGER_HPP
+
 // Convex Decomposition includes
-#include <decomp_ros_utils/data_ros_utils.h>
+#include <decomp_geometry/polyhedron.h>
 #include <decomp_util/ellipsoid_decomp.h>
 #include <decomp_util/seed_decomp.h>
 
@@ -20,8 +22,10 @@
 #include <Eigen/Dense>
 
 #include "utils.hpp"
+#include "map_snapshot.hpp"
 
 #include <mutex>
+#include <chrono>
 
 class JPS_Manager
 {
@@ -30,20 +34,22 @@ public:
 
   std::mutex mtx_jps_map_util;  // mutex for map_util_ and planner_ptr_
 
+  // Working copy of the voxel map of the last snapshot used (JPS frees the voxels around start and goal)
   std::shared_ptr<JPS::VoxelMapUtil> map_util_;
   std::unique_ptr<JPSPlanner3D> planner_ptr_;
 
-  vec_Vec3f vec_o_;   // Vector that contains the occupied points
-  vec_Vec3f vec_uo_;  // Vector that contains the unkown and occupied points
-
   // JPS
-  void updateJPSMap(pcl::PointCloud<pcl::PointXYZ>::Ptr pclptr, Eigen::Vector3d& center);
-  vec_Vecf<3> solveJPS3D(Vec3f& start, Vec3f& goal, bool* solved, int i);
+  std::shared_ptr<const JPS::VoxelMapUtil> buildJPSMap(pcl::PointCloud<pcl::PointXYZ>::Ptr pclptr,
+                                                       Eigen::Vector3d& center);
+  // No solution (solved=false) if the deadline is reached
+  vec_Vecf<3> solveJPS3D(const MapSnapshot& map, Vec3f& start, Vec3f& goal, bool* solved, int i,
+                         std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
   void setNumCells(int cells_x, int cells_y, int cells_z);
 
-  // Convex Decomposition
-  void cvxEllipsoidDecomp(vec_Vecf<3>& path, int type_space, std::vector<LinearConstraint3D>& l_constraints,
-                          vec_E<Polyhedron<3>>& poly_out);
+  // Convex Decomposition. If the deadline is reached, path is truncated to the segments already decomposed (at least one)
+  void cvxEllipsoidDecomp(const MapSnapshot& map, vec_Vecf<3>& path, int type_space,
+                          std::vector<LinearConstraint3D>& l_constraints, vec_E<Polyhedron<3>>& poly_out,
+                          std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
 
   void setResolution(double res);
   void setFactorJPS(double factor_jps);
@@ -57,5 +63,7 @@ private:
   double factor_jps_, res_, inflation_jps_, z_ground_, z_max_, drone_radius_;
   int cells_x_, cells_y_, cells_z_;
   bool visual_;
-  EllipsoidDecomp3D ellip_decomp_util_;
-};
\ No newline at end of file
+  std::shared_ptr<const JPS::VoxelMapUtil> map_util_source_;  // Voxel map of the snapshot map_util_ was copied from
+};
+
+#endif
@@ -0,0 +1,120 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2020, Jesus Tordesillas Torres, Aerospace Controls Laboratory
+ * Massachusetts Institute of Technology
+ * All Rights Reserved
+ * Authors: Jesus Tordesillas, et al.
+ * See LICENSE file for the license information
+ * -------------------------------------------------------------------------- */
+
+#ifndef LOGGER_HPP
+#define LOGGER_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include "spsc_ring.hpp"
+#include "termcolor.hpp"
+
+#define FASTER_LOG_DEBUG 0
+#define FASTER_LOG_INFO 1
+#define FASTER_LOG_WARN 2
+#define FASTER_LOG_ERROR 3
+#define FASTER_LOG_NONE 4
+
+// Messages below this level are removed at compile time (the arguments are not even evaluated). Set it with the CMake
+// variable FASTER_LOG_LEVEL
+#ifndef FASTER_LOG_LEVEL
+#define FASTER_LOG_LEVEL FASTER_LOG_INFO
+#endif
+
+// Usage: FASTER_WARN("No solution found, dt=" << dt_);
+#define FASTER_LOG(level, ...)                                                                                         \
+  do                                                                                                                   \
+  {                                                                                                                    \
+    if ((level) >= FASTER_LOG_LEVEL)                                                                                   \
+    {                                                                                                                  \
+      LogLine faster_log_line_;                                                                                        \
+      faster_log_line_.stream() << __VA_ARGS__;                                                                        \
+    }                                                                                                                  \
+  } while (0)
+
+#define FASTER_DEBUG(...) FASTER_LOG(FASTER_LOG_DEBUG, __VA_ARGS__)
+#define FASTER_INFO(...) FASTER_LOG(FASTER_LOG_INFO, __VA_ARGS__)
+#define FASTER_WARN(...) FASTER_LOG(FASTER_LOG_WARN, __VA_ARGS__)
+#define FASTER_ERROR(...) FASTER_LOG(FASTER_LOG_ERROR, __VA_ARGS__)
+
+// Writes the log lines to stdout from a background thread. Each thread that logs gets its own SpscRing, so logging
+// never waits for stdout nor for other threads (only the first line of each thread takes a lock, to register its
+// ring). Lines of different threads may be printed in a different order than they were logged. If a ring is full,
+// the line is dropped (and counted)
+class Logger
+{
+public:
+  static Logger& instance();
+
+  void push(std::string&& line);
+  void flush();  // Writes all the pending lines. Also called by the background thread every few ms
+
+  bool colorized() const
+  {
+    return colorized_;
+  }
+
+private:
+  struct ThreadRing
+  {
+    ThreadRing() : ring(256)
+    {
+    }
+    SpscRing<std::string> ring;
+    std::atomic<bool> thread_finished{ false };  // The ring is removed once it is empty
+  };
+
+  Logger();
+  ~Logger();
+  std::shared_ptr<ThreadRing> registerThread();
+  void drain();
+
+  std::mutex mtx_rings_;  // Protects rings_
+  std::vector<std::shared_ptr<ThreadRing>> rings_;
+
+  std::mutex mtx_flush_;  // flush() can be called from any thread
+  std::atomic<uint64_t> dropped_{ 0 };
+  bool colorized_;
+
+  std::atomic<bool> running_{ true };
+  std::thread thread_;
+};
+
+// One log line: it's built in a local stream and pushed to the Logger when the LogLine is destroyed
+class LogLine
+{
+public:
+  LogLine()
+  {
+    if (Logger::instance().colorized())
+    {
+      stream_ << termcolor::colorize;  // termcolor only colors std::cout and std::cerr by default
+    }
+  }
+
+  ~LogLine()
+  {
+    Logger::instance().push(stream_.str());
+  }
+
+  std::ostringstream& stream()
+  {
+    return stream_;
+  }
+
+private:
+  std::ostringstream stream_;
+};
+
+#endif
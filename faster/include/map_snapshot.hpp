@@ -0,0 +1,54 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2020, Jesus Tordesillas Torres, Aerospace Controls Laboratory
+ * Massachusetts Institute of Technology
+ * All Rights Reserved
+ * Authors: Jesus Tordesillas, et al.
+ * See LICENSE file for the license information
+ * -------------------------------------------------------------------------- */
+
+#ifndef MAP_SNAPSHOT_HPP
+#define MAP_SNAPSHOT_HPP
+
+#include <memory>
+#include <unordered_set>
+#include <stdint.h>
+#include <math.h>
+#include <pcl/point_types.h>
+#include <pcl/kdtree/kdtree_flann.h>
+#include <jps_basis/data_type.h>
+#include <jps_collision/map_util.h>
+
+// Key of the voxel (of size res) that contains p. Valid for |p/res| < 2^20
+inline int64_t voxelKey(const Eigen::Vector3d& p, double res)
+{
+  const int64_t offset = 1 << 20;
+  int64_t ix = (int64_t)floor(p.x() / res) + offset;
+  int64_t iy = (int64_t)floor(p.y() / res) + offset;
+  int64_t iz = (int64_t)floor(p.z() / res) + offset;
+  return (ix << 42) | (iy << 21) | iz;
+}
+
+// Everything the planner needs from one map update. It is built completely by Faster::updateMap() and then published
+// with an atomic swap of a shared_ptr, so it is never modified after that: each replan pins one snapshot (it stays
+// alive, and consistent, until the replan finishes) and never waits for a map update
+struct MapSnapshot
+{
+  pcl::PointCloud<pcl::PointXYZ>::Ptr pclptr_map;  // occupied space
+  pcl::PointCloud<pcl::PointXYZ>::Ptr pclptr_unk;  // unknown space
+
+  // nullptr until a non-empty cloud is received. If a cloud is empty, the ones of the previous snapshot are kept
+  std::shared_ptr<const pcl::KdTreeFLANN<pcl::PointXYZ>> kdtree_map;
+  std::shared_ptr<const pcl::KdTreeFLANN<pcl::PointXYZ>> kdtree_unk;
+
+  std::shared_ptr<const JPS::VoxelMapUtil> map_util;  // Voxel map used by JPS (occupied space, inflated)
+
+  vec_Vec3f vec_o;   // Occupied points (obstacles of the convex decomposition)
+  vec_Vec3f vec_uo;  // Unknown and occupied points
+
+  // Voxels of pclptr_map and pclptr_unk (see voxelKey()), used to find the points that are new with respect to an older
+  // snapshot. Only filled if revalidate_plan is true
+  std::shared_ptr<const std::unordered_set<int64_t>> keys_map;
+  std::shared_ptr<const std::unordered_set<int64_t>> keys_unk;
+};
+
+#endif
@@ -0,0 +1,76 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2020, Jesus Tordesillas Torres, Aerospace Controls Laboratory
+ * Massachusetts Institute of Technology
+ * All Rights Reserved
+ * Authors: Jesus Tordesillas, et al.
+ * See LICENSE file for the license information
+ * -------------------------------------------------------------------------- */
+
+#ifndef ROS_UTILS_HPP
+#define ROS_UTILS_HPP
+
+// ROS-dependent helpers (markers, colors, message conversions, parameters). The planner core only needs utils.hpp
+#include "ros/ros.h"
+#include <std_msgs/ColorRGBA.h>
+#include <geometry_msgs/Vector3.h>
+#include <geometry_msgs/Point.h>
+#include "tf2_geometry_msgs/tf2_geometry_msgs.h"
+#include "visualization_msgs/Marker.h"
+#include "visualization_msgs/MarkerArray.h"
+#include "utils.hpp"
+
+#define RED 1
+#define RED_TRANS 2
+#define RED_TRANS_TRANS 3
+#define GREEN 4
+#define BLUE 5
+#define BLUE_TRANS 6
+#define BLUE_TRANS_TRANS 7
+#define BLUE_LIGHT 8
+#define YELLOW 9
+#define ORANGE_TRANS 10
+
+void vectorOfVectors2MarkerArray(vec_Vecf<3> traj, visualization_msgs::MarkerArray* m_array, std_msgs::ColorRGBA color,
+                                 int type = visualization_msgs::Marker::ARROW,
+                                 std::vector<double> radii = std::vector<double>());
+
+std_msgs::ColorRGBA getColorJet(double v, double vmin, double vmax);
+
+std_msgs::ColorRGBA color(int id);
+
+//## From Wikipedia - http://en.wikipedia.org/wiki/Conversion_between_quaternions_and_Euler_angles
+void quaternion2Euler(tf2::Quaternion q, double& roll, double& pitch, double& yaw);
+
+void quaternion2Euler(Eigen::Quaterniond q, double& roll, double& pitch, double& yaw);
+
+void quaternion2Euler(geometry_msgs::Quaternion q, double& roll, double& pitch, double& yaw);
+
+visualization_msgs::Marker getMarkerSphere(double scale, int my_color);
+
+geometry_msgs::Point pointOrigin();
+
+Eigen::Vector3d vec2eigen(geometry_msgs::Vector3 vector);
+
+geometry_msgs::Vector3 eigen2rosvector(Eigen::Vector3d vector);
+
+geometry_msgs::Point eigen2point(Eigen::Vector3d vector);
+
+geometry_msgs::Vector3 vectorNull();
+
+geometry_msgs::Vector3 vectorUniform(double a);
+
+visualization_msgs::MarkerArray stateVector2ColoredMarkerArray(const std::vector<state>& data, int type,
+                                                               double max_value);
+
+template <typename T>
+inline bool safeGetParam(ros::NodeHandle& nh, std::string const& param_name, T& param_value)
+{
+  if (!nh.getParam(param_name, param_value))
+  {
+    ROS_ERROR("Failed to find parameter: %s", nh.resolveName(param_name, true).c_str());
+    exit(1);
+  }
+  return true;
+}
+
+#endif
@@ -14,11 +14,18 @@
 #include <Eigen/Dense>
 #include <type_traits>
 #include <fstream>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <vector>
 #include "termcolor.hpp"
 
-#include <decomp_ros_utils/data_ros_utils.h>
-#include <unsupported/Eigen/Polynomials>
+#include <decomp_geometry/polyhedron.h>
 #include "faster_types.hpp"
+#include "trajectory_solver.hpp"
+#include "logger.hpp"
 using namespace termcolor;
 
 // TODO: This function is the same as solvePolyOrder2 but with other name (weird conflicts...)
@@ -43,47 +50,71 @@ inline double solvePolynomialOrder2(Eigen::Vector3f& coeff)
       return x2;
     }
   }
-  printf("No solution found to the equation\n");
+  FASTER_WARN("No solution found to the equation");
   return std::numeric_limits<float>::max();
 }
 
+class SolverGurobi;
+
 class mycallback : public GRBCallback
 {
 public:
-  bool should_terminate_;
+  std::atomic<bool> should_terminate_;  // Can be set from another thread (StopExecution())
+  std::atomic<bool> cancel_trial_;      // A smaller factor worked in another solver (see genNewTraj())
+  bool got_incumbent_;                   // The current trial has found a feasible solution, at first_incumbent_
+  std::chrono::steady_clock::time_point first_incumbent_;
+  SolverGurobi* lazy_solver_ = nullptr;  // Checks the faces of the incumbents (see SolverGurobi::separateFaces())
   mycallback();  // constructor
   // void abortar();
 
+  // For separateFaces()
+  using GRBCallback::addLazy;
+  using GRBCallback::getSolution;
+
 protected:
   void callback();
 };
 
-class SolverGurobi
+// Gurobi backend of TrajectorySolver: MIQP where binaries choose the polytope of each interval
+class SolverGurobi : public TrajectorySolver
 {
 public:
   SolverGurobi();
 
+  void setup(const solver_settings& settings) override;
+
   // void setQ(double q);
   void setN(int N);
-  void setX0(state& data);
+  void setX0(state& data) override;
   // void set_u0(double u0[]);
-  void setXf(state& data);
+  void setXf(state& data) override;
   void resetX();
   void setBounds(double max_values[3]);
-  bool genNewTraj();
+  bool genNewTraj() override;
+  // Number of time factors tried at the same time, each one in its own model (n-1 factor workers are created with the
+  // current N, DC, bounds, threads and verbosity, so call it after the rest of the setup)
+  void setParallelFactors(int n);
+  // n>0: instead of the MIQP, solve the monotone assignments of intervals to polytopes as convex QPs, n at the same
+  // time (see solveAssignments()). Call it before setParallelFactors()
+  void setMonotoneQP(int n);
   bool callOptimizer();
   double getDTInitial();
 
   void setDC(double dc);
-  void setPolytopes(std::vector<LinearConstraint3D> polytopes);
+  void setPolytopes(std::vector<LinearConstraint3D> polytopes) override;
+  void setGuidePath(const vec_Vecf<3>& path) override;  // Used by lazy_faces_
   void setPolytopesConstraints();
+  void setPolytopesStructure(int n_polytopes, int n_faces);
+  void warmUp(int n_polytopes, int n_faces) override;  // Builds the polytope structure (and of the workers)
+  void setDTCoefficients();
   void findDT(double factor);
-  void fillX();
+  void fillX() override;
+  void getCoefficients(std::vector<double>& coeffs, double& dt) override;
   void setObjective();
   void setConstraintsXf();
   void setConstraintsX0();
   void setDynamicConstraints();
-  void setForceFinalConstraint(bool forceFinalConstraint);
+  void setForceFinalConstraint(bool forceFinalConstraint) override;
 
   // For the jackal
   void setWMax(double w_max);
@@ -94,8 +125,11 @@ public:
   void setThreads(int threads);
   void setVerbose(int verbose);
 
-  void StopExecution();
-  void ResetToNormalState();
+  void StopExecution() override;
+  void ResetToNormalState() override;
+  // genNewTraj() doesn't try more factors once this time is reached, and Gurobi stops there (TimeLimit). If Gurobi
+  // stops with a feasible solution, that solution is used
+  void setDeadline(std::chrono::steady_clock::time_point deadline) override;
 
   void setDistances(vec_Vecf<3>& samples, std::vector<double> dist_near_obs);
 
@@ -104,7 +138,17 @@ public:
   void setDistanceConstraints();
 
   void setMode(int mode);
-  void setFactorInitialAndFinalAndIncrement(double factor_initial, double factor_final, double factor_increment);
+  void setFactorInitialAndFinalAndIncrement(double factor_initial, double factor_final,
+                                            double factor_increment) override;
+  void setFactorBisection(bool factor_bisection);  // See genNewTraj()
+  void setWarmStart(bool warm_start);              // See setWarmStartValues()
+  void setMonotoneBinaries(bool monotone_binaries);  // See setPolytopesStructure()
+  void setLazyFaces(bool lazy_faces, double margin);  // See setLazyFaceConstraints()
+  // Variables of the MIQP, see Formulation. Call it before createVars()
+  void setFormulation(const std::string& formulation);
+  // Called by mycallback with each new incumbent when lazy_faces_. Returns true if it added lazy constraints (the
+  // incumbent is then rejected)
+  bool separateFaces(mycallback& cb);
 
   GRBLinExpr getPos(int t, double tau, int ii);
   GRBLinExpr getVel(int t, double tau, int ii);
@@ -122,21 +166,61 @@ public:
   GRBLinExpr getCn(int t, int ii);
   GRBLinExpr getDn(int t, int ii);
 
-  std::vector<GRBLinExpr> getCP0(int t);
-  std::vector<GRBLinExpr> getCP1(int t);
-  std::vector<GRBLinExpr> getCP2(int t);
-  std::vector<GRBLinExpr> getCP3(int t);
+  GRBVar getCPVar(int t, int k, int axis);
+  int faceIndex(int t, int k, int poly, int face);
+  void setUsedPolytopes(int n_polytopes);
+  void setLazyFaceConstraints();
+  void setControlPointConstraints();
+  void setDTRightHandSides();
+  void readSolution(std::vector<double>& sol);  // Of the last optimization, with the layout of x_sol_
+  void addFaceRows(const std::vector<int>& faces);  // Faces given by faceIndex(), with lazy_faces_
+
+  // Rows of a block of constraints, added to the model with one GRBModel::addConstrs() (see addBatch()). The names
+  // are only kept with FASTER_GUROBI_NAMES
+  struct ConstrBatch
+  {
+    std::vector<GRBLinExpr> exprs;
+    std::vector<char> senses;
+    std::vector<double> rhs;
+    std::vector<std::string> names;
+
+    // sum(coeffs[i] * vars[i]) sense rhs
+    void add(const double* coeffs, const GRBVar* vars, int count, char sense, double rhs, const std::string& name);
+    void add(std::initializer_list<double> coeffs, std::initializer_list<GRBVar> vars, char sense, double rhs,
+             const std::string& name);
+  };
+  std::vector<GRBConstr> addBatch(const ConstrBatch& batch);
+  // count variables with one GRBModel::addVars(). name(i) is only called with FASTER_GUROBI_NAMES
+  std::vector<GRBVar> addVarsBatch(int count, double lb, double ub, char type,
+                                   const std::function<std::string(int)>& name);
 
-  std::vector<state> X_temp_;
   double dt_;  // time step found by the solver
-  int trials_ = 0;
   int temporal_ = 0;
-  double runtime_ms_ = 0;
-  double factor_that_worked_ = 0;
   int N_ = 10;
   mycallback cb_;
 
 protected:
+  // COEFFICIENTS: the variables are the coefficients of the polynomials (x), and the control points of the polytope
+  // constraints (q) are defined with equality constraints whose coefficients depend on dt.
+  // BEZIER: the variables are the Bezier control points (p), the last one of each interval shared with the next
+  // interval. The polytope constraints apply directly to the variables, and dt only appears in right-hand sides.
+  // MINVO: the variables of BEZIER, and the polytope constraints apply to the MINVO vertices of each interval (v),
+  // whose hull is tighter than the one of the Bezier control points.
+  // NORMALIZED: COEFFICIENTS in normalized time (x are the coefficients of the polynomials in tau/dt, in [0, 1]): all
+  // the coefficients of the constraints are the ones of dt=1 (small integers), and dt only appears in right-hand sides
+  enum Formulation
+  {
+    COEFFICIENTS,
+    BEZIER,
+    MINVO,
+    NORMALIZED
+  };
+  Formulation formulation_ = COEFFICIENTS;
+  bool controlPoints() const  // The variables are p
+  {
+    return formulation_ == BEZIER || formulation_ == MINVO;
+  }
+
   double cost_;
 
   double xf_[3 * 3];
@@ -151,20 +235,36 @@ protected:
 
   int N_of_polytopes_ = 3;
 
-  GRBEnv* env = new GRBEnv();
-  GRBModel m = GRBModel(*env);
+  static GRBEnv* startEnv();
+  std::unique_ptr<GRBEnv> env_ = std::unique_ptr<GRBEnv>(startEnv());  // Only of m (see startEnv()), before it
+  GRBModel m = GRBModel(*env_);
 
+  // The model is built once and then updated in place (coefficients and right-hand sides). Only the polytope
+  // constraints are rebuilt, when there are more polytopes than built_polytopes_ or a polytope has more faces than
+  // built_faces_. With fewer polytopes, the ones after the last are padding (see setPolytopesConstraints())
   std::vector<GRBConstr> at_least_1_pol_cons;  // Constraints at least in one polytope
-  std::vector<GRBGenConstr> polytopes_cons;    // Used for the whole trajectory
-  std::vector<GRBConstr> polytope_cons;        // Used for the rescue path
+  std::vector<GRBGenConstr> polytopes_cons;    // Indicators b[t][poly]==1 --> s<=0
+  std::vector<GRBConstr> face_cons;            // A_face * cp - s <= b_face, see faceIndex()
   std::vector<GRBConstr> dyn_cons;
   std::vector<GRBConstr> init_cons;
   std::vector<GRBConstr> final_cons;
+  std::vector<GRBConstr> cp_cons;  // Definition of q
+  std::vector<GRBConstr> order_cons;  // Order of the polytopes (only if monotone_binaries_)
+  std::vector<GRBConstr> max_cons;    // Limits (their right-hand sides depend on dt, except with COEFFICIENTS)
+  int built_polytopes_ = -1;
+  int built_faces_ = 0;
+  int used_polytopes_ = 0;  // Of the built ones, the ones whose binaries can be 1
+  bool built_final_pos_ = true;  // forceFinalConstraint_ when final_cons was built
+  bool objective_set_ = false;
 
   std::vector<GRBQConstr> distances_cons;
 
   std::vector<std::vector<GRBVar>> b;  // binary variables
   std::vector<std::vector<GRBVar>> x;
+  std::vector<std::vector<GRBVar>> q;  // Control points 1, 2, 3 of each interval: q[t][3 * (k - 1) + axis]
+  std::vector<std::vector<GRBVar>> p;  // Bezier control points: p[t][3 * k + axis], p[t][9..11] is p[t + 1][0..2]
+  std::vector<std::vector<GRBVar>> v;  // MINVO vertices of each interval: v[t][3 * k + axis]
+  std::vector<GRBVar> s;               // Slack of each face constraint (of each control point and polytope if lazy)
   std::vector<std::vector<GRBVar>> u;
 
   vec_Vecf<3> samples_;           // Samples along the rescue path
@@ -173,6 +273,14 @@ protected:
   std::vector<double> dist_near_obs_;
   std::vector<LinearConstraint3D> polytopes_;
 
+  // Lazy face constraints (see setLazyFaceConstraints())
+  bool lazy_faces_ = false;
+  double lazy_faces_margin_ = 1;
+  vec_Vecf<3> guide_path_;
+  std::vector<char> face_in_model_;      // By faceIndex()
+  std::vector<int> lazy_faces_found_;    // Added as lazy constraints in this optimization, see callOptimizer()
+  std::vector<GRBVar> separation_vars_;  // Control points (t, k, axis) and then b (t, poly)
+
   std::ofstream times_log;
 
   int mode_;
@@ -183,5 +291,41 @@ protected:
 
   int total_not_solved = 0;
   double w_max_ = 1;
+
+  std::chrono::steady_clock::time_point deadline_ = std::chrono::steady_clock::time_point::max();
+
+  bool factor_bisection_ = false;
+  bool monotone_binaries_ = false;
+
+  void prepareModel();
+  double timeLeft();
+  bool tryFactor(double factor);
+  void tryFactors(const std::vector<double>& factors, int first, std::atomic<int>& best,
+                  const std::vector<SolverGurobi*>& solvers);
+  int bisectFactors(const std::vector<double>& factors, const std::vector<SolverGurobi*>& solvers);
+
+  std::vector<double> x_sol_;  // Values of x of the last trial that worked: x_sol_[12 * t + j] = x[t][j]
+  double dt_sol_ = 0;          // dt_ of that trial
+  std::chrono::steady_clock::time_point gen_start_;
+
+  bool warm_start_ = false;
+  bool warm_start_set_ = false;     // Start and VarHintVal are set in the model
+  std::vector<double> warm_x_sol_;  // x_sol_ of the last genNewTraj() that succeeded
+  double warm_dt_sol_ = 0;
+  double warm_shift_ = 0;  // Time of warm_x_sol_ closest to X0
+  void setWarmStartValues();
+
+  bool convex_ = false;          // QP worker: fixed polytope for each interval (assignment_), no binaries
+  std::vector<int> assignment_;  // Polytope of each interval (only in convex_ mode)
+  double qp_cost_;               // Lowest cost found by this QP worker in the current solveAssignments()
+  std::vector<std::unique_ptr<SolverGurobi>> qp_workers_;
+  bool solveAssignments();
+  void evalSolution(const std::vector<double>& sol, double dt, double T, double out[4][3]);
+  double closestTime(const std::vector<double>& sol, double dt, const Eigen::Vector3d& pos);
+
+  std::vector<std::unique_ptr<SolverGurobi>> factor_workers_;
+  std::atomic<int> current_factor_{ -1 };  // Index of the factor being tried (-1 if none)
+  int threads_ = 0;
+  int verbose_ = 0;
 };
 #endif
\ No newline at end of file
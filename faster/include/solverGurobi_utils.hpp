@@ -16,21 +16,6 @@
 #include <type_traits>
 // using namespace std;
 
-inline double MinPositiveElement(std::vector<double> v)
-{
-  std::sort(v.begin(), v.end());  // sorted in ascending order
-  double min_value = 0;
-  for (int i = 0; i < v.size(); i++)
-  {
-    if (v[i] > 0)
-    {
-      min_value = v[i];
-      break;
-    }
-  }
-  return min_value;
-}
-
 template <typename T>
 GRBQuadExpr GetNorm2(const std::vector<T>& x)  // Return the squared norm of a vector
 {
@@ -42,39 +27,6 @@ GRBQuadExpr GetNorm2(const std::vector<T>& x)  // Return the squared norm of a v
   return result;
 }
 
-template <typename T>
-std::vector<GRBLinExpr> MatrixMultiply(const std::vector<std::vector<double>>& A, const std::vector<T>& x)
-{
-  std::vector<GRBLinExpr> result;
-
-  for (int i = 0; i < A.size(); i++)
-  {
-    GRBLinExpr lin_exp = 0;
-    for (int m = 0; m < x.size(); m++)
-    {
-      lin_exp = lin_exp + A[i][m] * x[m];
-    }
-    result.push_back(lin_exp);
-  }
-  return result;
-}
-
-/*std::vector<GRBLinExpr> MatrixMultiply(const std::vector<std::vector<double>>& A, const std::vector<GRBLinExpr>& x)
-{
-  std::vector<GRBLinExpr> result;
-
-  for (int i = 0; i < A.size(); i++)
-  {
-    GRBLinExpr lin_exp = 0;
-    for (int m = 0; m < x.size(); m++)
-    {
-      lin_exp = lin_exp + A[i][m] * x[m];
-    }
-    result.push_back(lin_exp);
-  }
-  return result;
-}*/
-
 template <typename T>  // Overload + to sum Elementwise std::vectors
 std::vector<T> operator+(const std::vector<T>& a, const std::vector<T>& b)
 {
@@ -111,44 +63,4 @@ std::vector<GRBLinExpr> operator-(const std::vector<T>& x, const std::vector<dou
   return result;
 }
 
-template <typename T>
-std::vector<T> eigenVector2std(const Eigen::Matrix<T, -1, 1>& x)
-{
-  std::vector<T> result = 0;
-  for (int i = 0; i < x.rows(); i++)
-  {
-    result.push_back(x(i, 1));
-  }
-  return result;
-}
-
-template <typename T>
-std::vector<std::vector<T>> eigenMatrix2std(const Eigen::Matrix<T, -1, -1>& x)
-{
-  std::vector<std::vector<T>> result;
-
-  for (int i = 0; i < x.rows(); i++)
-  {
-    std::vector<T> row;
-    for (int j = 0; j < x.cols(); j++)
-    {
-      row.push_back(x(i, j));
-    }
-    result.push_back(row);
-  }
-  return result;
-}
-
-template <typename T>
-std::vector<T> GetColumn(std::vector<std::vector<T>> x, int column)
-{
-  std::vector<T> result;
-
-  for (int i = 0; i < x.size(); i++)
-  {
-    result.push_back(x[i][column]);
-  }
-  return result;
-}
-
 #endif
\ No newline at end of file
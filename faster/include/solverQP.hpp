@@ -0,0 +1,78 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2020, Jesus Tordesillas Torres, Aerospace Controls Laboratory
+ * Massachusetts Institute of Technology
+ * All Rights Reserved
+ * Authors: Jesus Tordesillas, et al.
+ * See LICENSE file for the license information
+ * -------------------------------------------------------------------------- */
+
+#ifndef SOLVER_QP_HPP
+#define SOLVER_QP_HPP
+
+#include <atomic>
+#include <map>
+#include <utility>
+#include <vector>
+#include "cubic_qp.hpp"
+#include "trajectory_solver.hpp"
+
+// Backend "qp": no license needed. As SolverGurobi with monotone_qp, each monotone assignment of intervals to
+// polytopes (see monotoneAssignments()) is solved as a convex QP (with CubicQP) and the feasible one with the lowest
+// cost is used. The factors are tried in ascending order in this thread (factor_bisection, warm_start,
+// monotone_binaries, monotone_qp and parallel_factors are options of the Gurobi backend and are ignored)
+class SolverQP : public TrajectorySolver
+{
+public:
+  void setup(const solver_settings& settings) override;
+
+  void setX0(state& data) override;
+  void setXf(state& data) override;
+  void setPolytopes(std::vector<LinearConstraint3D> polytopes) override;
+  void setForceFinalConstraint(bool forceFinalConstraint) override;
+  void setFactorInitialAndFinalAndIncrement(double factor_initial, double factor_final,
+                                            double factor_increment) override;
+  void setDeadline(std::chrono::steady_clock::time_point deadline) override;
+  void warmUp(int n_polytopes, int n_faces) override;  // Allocates the workspace of the QP
+
+  bool genNewTraj() override;
+  void fillX() override;
+  void getCoefficients(std::vector<double>& coeffs, double& dt) override;
+
+  void StopExecution() override;
+  void ResetToNormalState() override;
+
+private:
+  // Cheapest assignment with this dt (saved in x_sol_)
+  bool solveAssignments(double dt, const std::vector<std::vector<int>>& assignments);
+  // monotoneAssignments(N_, n_polytopes), computed the first time it's needed
+  const std::vector<std::vector<int>>& assignments(int n_polytopes);
+  void resizeQP(int max_faces);  // Only if N_ changed or max_faces is larger than the workspace of qp_
+
+  CubicQP qp_;
+  int qp_N_ = 0;
+  int qp_faces_ = 0;
+  std::map<std::pair<int, int>, std::vector<std::vector<int>>> assignments_;  // (N, polytopes) --> assignments
+
+  int N_ = 10;
+  double dc_ = 0.01;
+  double v_max_ = 1;
+  double a_max_ = 1;
+  double j_max_ = 1;
+  bool force_final_ = true;
+  double factor_initial_ = 1;
+  double factor_final_ = 10;
+  double factor_increment_ = 1;
+  int verbose_ = 0;
+
+  double x0_[9];
+  double xf_[9];
+  std::vector<LinearConstraint3D> polytopes_;
+  std::chrono::steady_clock::time_point deadline_ = std::chrono::steady_clock::time_point::max();
+  std::atomic<bool> should_terminate_{ false };
+
+  std::vector<double> x_sol_;  // Coefficients of the last genNewTraj() that succeeded (see getCoefficients())
+  double dt_sol_ = 0;
+  std::vector<double> coeffs_;  // Of the current assignment
+};
+
+#endif
@@ -0,0 +1,57 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2020, Jesus Tordesillas Torres, Aerospace Controls Laboratory
+ * Massachusetts Institute of Technology
+ * All Rights Reserved
+ * Authors: Jesus Tordesillas, et al.
+ * See LICENSE file for the license information
+ * -------------------------------------------------------------------------- */
+
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+
+// Fixed-size ring with one producer and one consumer. Neither push() nor pop() blocks (nor allocates, unless copying a T
+// does): push() returns false (and the item is lost) if the ring is full
+template <typename T>
+class SpscRing
+{
+public:
+  SpscRing(int capacity) : slots_(capacity + 1)  // One slot is always empty (full and empty are distinguishable)
+  {
+  }
+
+  bool push(const T& item)
+  {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t next = (head + 1) % slots_.size();
+    if (next == tail_.load(std::memory_order_acquire))
+    {
+      return false;
+    }
+    slots_[head] = item;
+    head_.store(next, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T& item)
+  {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire))
+    {
+      return false;
+    }
+    item = slots_[tail];
+    tail_.store((tail + 1) % slots_.size(), std::memory_order_release);
+    return true;
+  }
+
+private:
+  std::vector<T> slots_;
+  std::atomic<size_t> head_{ 0 };  // Next slot to write (only written by the producer)
+  std::atomic<size_t> tail_{ 0 };  // Next slot to read (only written by the consumer)
+};
+
+#endif
@@ -0,0 +1,71 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2020, Jesus Tordesillas Torres, Aerospace Controls Laboratory
+ * Massachusetts Institute of Technology
+ * All Rights Reserved
+ * Authors: Jesus Tordesillas, et al.
+ * See LICENSE file for the license information
+ * -------------------------------------------------------------------------- */
+
+#ifndef TELEMETRY_HPP
+#define TELEMETRY_HPP
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <stdint.h>
+#include <stdio.h>
+#include "faster_types.hpp"
+#include "spsc_ring.hpp"
+
+// Telemetry file: TelemetryHeader followed by the replan_record's, as they are in memory (little endian on x86/ARM)
+#define TELEMETRY_MAGIC "FSTRTLM"
+// 2: incumbent_whole and incumbent_safe in replan_times. 3: nodes_whole and nodes_safe. 4: iterations_* and numeric_*.
+// 5: n_intervals_*. 6: cache_hit_*
+#define TELEMETRY_VERSION 6
+
+struct TelemetryHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;  // sizeof(replan_record)
+};
+
+// Per-replan records. The replan thread only copies the record into the ring; a background thread writes them to the
+// telemetry file and passes them to the sink (e.g. a ROS publisher). If the drain thread falls behind, records are
+// dropped (and counted) instead of delaying the replan
+class Telemetry
+{
+public:
+  typedef std::function<void(const replan_record&)> Sink;
+
+  Telemetry(int capacity = 1024);
+  ~Telemetry();
+
+  // file="" --> no file. sink=nullptr --> no sink. Returns false if the file can't be opened
+  bool start(const std::string& file, Sink sink);
+  void stop();  // Writes the records still in the ring and closes the file
+
+  // Called only from the replan thread. Does nothing if start() hasn't been called
+  void push(const replan_record& record);
+
+  uint64_t dropped() const
+  {
+    return dropped_.load();
+  }
+
+private:
+  void drain();
+  void flush();
+
+  SpscRing<replan_record> ring_;
+  std::atomic<bool> running_{ false };
+  std::atomic<uint64_t> dropped_{ 0 };
+  std::thread thread_;
+
+  // Only used by the drain thread (after start())
+  FILE* file_ = nullptr;
+  Sink sink_;
+};
+
+#endif
@@ -5,7 +5,7 @@ namespace JPS
 class Timer
 {
   typedef std::chrono::high_resolution_clock high_resolution_clock;
-  typedef std::chrono::milliseconds milliseconds;
+  typedef std::chrono::duration<double, std::milli> milliseconds;  // fractional ms, stages often take < 1 ms
   // typedef std::chrono::microseconds microseconds;
 
 public:
@@ -20,7 +20,7 @@ public:
   }
   double ElapsedMs() const
   {
-    return (std::chrono::duration_cast<milliseconds>(high_resolution_clock::now() - _start)).count();
+    return milliseconds(high_resolution_clock::now() - _start).count();
   }
   template <typename T, typename Traits>
   friend std::basic_ostream<T, Traits>& operator<<(std::basic_ostream<T, Traits>& out, const Timer& timer)
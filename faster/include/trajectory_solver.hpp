@@ -0,0 +1,147 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2020, Jesus Tordesillas Torres, Aerospace Controls Laboratory
+ * Massachusetts Institute of Technology
+ * All Rights Reserved
+ * Authors: Jesus Tordesillas, et al.
+ * See LICENSE file for the license information
+ * -------------------------------------------------------------------------- */
+
+#ifndef TRAJECTORY_SOLVER_HPP
+#define TRAJECTORY_SOLVER_HPP
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <decomp_geometry/polyhedron.h>
+#include "faster_types.hpp"
+
+// Setup of a TrajectorySolver (see TrajectorySolver::setup())
+struct solver_settings
+{
+  int N = 10;  // Number of intervals
+  double dc = 0.01;
+  double v_max = 1;
+  double a_max = 1;
+  double j_max = 1;
+  double w_max = 1;
+  bool force_final_constraint = true;
+  double factor_initial = 1;
+  double factor_final = 10;
+  double factor_increment = 1;
+  int threads = 0;
+  int verbose = 0;
+
+  // Options of the Gurobi backend (the other backends can ignore them)
+  bool factor_bisection = false;
+  bool warm_start = false;
+  bool monotone_binaries = false;
+  int monotone_qp = 0;
+  int parallel_factors = 1;
+  bool lazy_faces = false;
+  double lazy_faces_margin = 1;
+  std::string formulation = "coefficients";
+
+  // Options of createAdaptiveSolver(): N of each problem in [N_min, N]
+  int N_min = 1;
+  double length_per_interval = 2;  // [m] Of the guide path
+
+  // Options of createCachedSolver()
+  int cache_size = 16;             // Solutions kept
+  double cache_resolution = 1e-3;  // [m, m/s, m/s2] Quantization of X0 and Xf in the key
+};
+
+// Solver of the trajectory through a sequence of polytopes: N cubic intervals of duration dt, from X0 to Xf, with
+// limits on vel, accel and jerk, minimizing the jerk. dt is searched with factors of getDTInitial() (the lower bound
+// given by the limits): the smallest factor in the range that is feasible is used. Faster only talks to the solvers
+// through this interface, so that the backends can be compared with the same inputs and outputs (see
+// createTrajectorySolver())
+class TrajectorySolver
+{
+public:
+  virtual ~TrajectorySolver()
+  {
+  }
+
+  virtual void setup(const solver_settings& settings) = 0;  // Called once, before the rest
+
+  // Inputs of each problem
+  virtual void setX0(state& data) = 0;
+  virtual void setXf(state& data) = 0;
+  virtual void setPolytopes(std::vector<LinearConstraint3D> polytopes) = 0;
+  // Optional hint: the path that the polytopes were built around (the polytope i around the segment i). The backends
+  // that don't use it can ignore it
+  virtual void setGuidePath(const vec_Vecf<3>& path)
+  {
+  }
+  virtual void setForceFinalConstraint(bool forceFinalConstraint) = 0;
+  virtual void setFactorInitialAndFinalAndIncrement(double factor_initial, double factor_final,
+                                                    double factor_increment) = 0;
+  // genNewTraj() returns (with the best solution found, if any) when this time is reached
+  virtual void setDeadline(std::chrono::steady_clock::time_point deadline) = 0;
+  // Optional: builds ahead of time (after setup(), before the first genNewTraj()) what the backend would build for
+  // problems with n_polytopes polytopes of at most n_faces faces, so that the first genNewTraj() isn't slower
+  virtual void warmUp(int n_polytopes, int n_faces)
+  {
+  }
+
+  virtual bool genNewTraj() = 0;
+  virtual void fillX() = 0;  // Samples the solution of the last genNewTraj() that succeeded every dc into X_temp_
+
+  // Coefficients of the solution: coeffs[12 * t + j] for the interval t are A (j=0..2, one per axis), B, C and D of
+  // A*tau^3 + B*tau^2 + C*tau + D, tau in [0, dt]
+  virtual void getCoefficients(std::vector<double>& coeffs, double& dt) = 0;
+
+  // Can be called from another thread to stop genNewTraj() as soon as possible
+  virtual void StopExecution() = 0;
+  virtual void ResetToNormalState() = 0;
+
+  // Outputs
+  std::vector<state> X_temp_;
+  // Stats of the last genNewTraj()
+  int trials_ = 0;                  // Factors tried
+  double runtime_ms_ = 0;           // Time spent in the solver (all the trials)
+  double node_count_ = 0;           // Branch-and-bound nodes (0 if the backend has none)
+  double iterations_ = 0;           // Simplex, barrier or active set iterations
+  int numeric_issues_ = 0;          // Solves that ended because of numerical trouble (or without converging)
+  double factor_that_worked_ = 0;   // Of the last genNewTraj() that succeeded
+  double first_incumbent_ms_ = -1;  // From the start of genNewTraj() to the first feasible solution that was used
+  int intervals_ = 0;               // N of the problem
+  bool from_cache_ = false;         // The solution is a stored one (see createCachedSolver())
+};
+
+// backend: "gurobi", "qp" or "gurobi_vs_qp" (runs both, uses the result of Gurobi and logs the differences). Returns
+// nullptr if the backend is unknown (or this build doesn't have it: Gurobi is optional, see CMakeLists.txt)
+TrajectorySolver* createTrajectorySolver(const std::string& backend);
+// Same backends, but N is chosen for each problem (in [settings.N_min, settings.N]) from the number of polytopes and
+// from the length and the turns of the guide path. It keeps one solver of the backend per N used (built the first
+// time that N is needed), so the easy problems are solved with smaller models
+TrajectorySolver* createAdaptiveSolver(const std::string& backend);
+// Keeps the last settings.cache_size solutions of solver (which it owns), keyed by X0 and Xf (quantized to
+// settings.cache_resolution), the polytopes (exact) and the final constraint. If a problem is in the cache, and the
+// stored solution starts at X0 (within the resolution), is inside the polytopes (checked with the control points of
+// settings.formulation: MINVO vertices for "minvo", Bezier for the rest) and satisfies the limits, it's returned
+// without calling solver. The least recently used solution is dropped when the cache is full. setup() must be called
+// only once: the stored solutions are checked against the limits of that setup
+TrajectorySolver* createCachedSolver(TrajectorySolver* solver);
+
+// Shared by the backends
+
+// Lower bound of dt given by the limits (dt = factor * dtLowerBound()). x0 and xf: pos, vel and accel
+double dtLowerBound(const double x0[9], const double xf[9], double v_max, double a_max, double j_max, int N);
+
+// Assignments of the N intervals to the polytopes that start in the first polytope and either stay in the same
+// polytope or move to the next one in each interval
+std::vector<std::vector<int>> monotoneAssignments(int N, int n_polytopes);
+
+// MINVO vertices of an interval = minvoFromBezier() * its Bezier control points (one per row)
+Eigen::Matrix4d minvoFromBezier();
+
+// Vertexes of the path where its direction changes more than 20 degrees
+int countTurns(const vec_Vecf<3>& path);
+bool isTurn(const Vecf<3>& previous, const Vecf<3>& vertex, const Vecf<3>& next);
+
+// Samples every dc the coefficients of TrajectorySolver::getCoefficients() into X (with the final vel, accel and
+// jerk set to zero)
+void sampleSolution(const std::vector<double>& coeffs, double dt, double dc, std::vector<state>& X);
+
+#endif
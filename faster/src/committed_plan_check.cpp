@@ -0,0 +1,169 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2020, Jesus Tordesillas Torres, Aerospace Controls Laboratory
+ * Massachusetts Institute of Technology
+ * All Rights Reserved
+ * Authors: Jesus Tordesillas, et al.
+ * See LICENSE file for the license information
+ * -------------------------------------------------------------------------- */
+
+// Checks of CommittedPlan: the published states are never replaced, a commit doesn't hold the consumer unless it
+// replaces the very next state, and the worst-case latency of next() (what getNextGoal() waits for) while a producer
+// commits as fast as it can. Returns 0 if all the checks pass (run by ctest, see CMakeLists.txt)
+
+#include "committed_plan.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+
+namespace
+{
+const int TICK_US = 1000;  // Period of the consumer (setpoints at 1 kHz)
+const int TICKS = 2000;
+
+int failures = 0;
+
+void check(bool condition, const std::string& what)
+{
+  std::cout << (condition ? "[ OK ] " : "[FAIL] ") << what << std::endl;
+  failures += condition ? 0 : 1;
+}
+
+// The state of the absolute index i written by the commit number commit_id
+state stamp(int64_t i, int64_t commit_id)
+{
+  state s;
+  s.pos << i, commit_id, commit_id;
+  return s;
+}
+
+std::vector<state> stamps(int64_t a, int n, int64_t commit_id)
+{
+  std::vector<state> states;
+  for (int i = 0; i < n; i++)
+  {
+    states.push_back(stamp(a + i, commit_id));
+  }
+  return states;
+}
+
+void sequential()
+{
+  CommittedPlan plan;
+  state s;
+  check(plan.next(s) == CommittedPlan::EMPTY, "empty before the first commit");
+
+  plan.commit(-1, stamps(0, 10, 0));
+  for (int i = 0; i < 5; i++)
+  {
+    plan.next(s);  // Sends 0..4
+  }
+  check(plan.frontIndex() == 5 && plan.size() == 5, "front is past the states sent");
+
+  // Replacing the state 4 (sent) is rejected, replacing the state 5 (the next one) is accepted
+  check(plan.commit(plan.endIndex() - 1 - 4, stamps(4, 10, 1)) == false, "the state sent can't be replaced");
+  check(plan.commit(plan.endIndex() - 1 - 5, stamps(5, 10, 2)) == true, "the next state can be replaced");
+  check(plan.next(s) == CommittedPlan::NEXT && s.pos(0) == 5 && s.pos(1) == 2, "the next state is the new one");
+
+  // Up to the last state, without holding the one before it
+  int64_t previous = 5;
+  bool consecutive = true;
+  while (plan.size() > 0)
+  {
+    plan.next(s);
+    consecutive = consecutive && (s.pos(0) == previous + 1);
+    previous = s.pos(0);
+  }
+  check(consecutive && previous == 14, "all the states once, in order");
+  check(plan.next(s) == CommittedPlan::EXHAUSTED && s.pos(0) == 14, "exhausted: the last state again");
+  check(plan.commit(0, stamps(14, 5, 3)) == false, "the last state can't be replaced once sent");
+  check(plan.commit(-1, stamps(15, 5, 4)) == true, "appending after the last state sent");
+  check(plan.next(s) == CommittedPlan::NEXT && s.pos(0) == 15, "the appended states are sent");
+}
+
+// The consumer calls next() every tick (as the setpoint timer calls getNextGoal()) while the producer commits as fast
+// as it can, each commit replacing the states from deltaT ahead of the front (as Faster::replan() does). The plan
+// never runs out, so every tick must send the next state: none is held by a commit, and next() never takes a tick
+void concurrent()
+{
+  const int DELTA_T = 5;
+  const int STATES = 50;
+  CommittedPlan plan(1024);
+  plan.commit(-1, stamps(0, STATES, 0));
+
+  std::atomic<bool> done{ false };
+  std::vector<double> latencies_us;
+  latencies_us.reserve(TICKS);
+  std::map<int64_t, int64_t> sent;  // Index --> commit that wrote it, as read by the consumer
+  int held = 0;
+  bool torn = false;
+  std::thread consumer([&]() {
+    state s;
+    auto tick = std::chrono::steady_clock::now();
+    for (int i = 0; i < TICKS; i++)
+    {
+      tick += std::chrono::microseconds(TICK_US);
+      std::this_thread::sleep_until(tick);
+      auto start = std::chrono::steady_clock::now();
+      CommittedPlan::Read read = plan.next(s);
+      std::chrono::duration<double, std::micro> latency = std::chrono::steady_clock::now() - start;
+      latencies_us.push_back(latency.count());
+      if (read == CommittedPlan::NEXT)
+      {
+        torn = torn || (s.pos(1) != s.pos(2)) || sent.count((int64_t)s.pos(0)) > 0;
+        sent[(int64_t)s.pos(0)] = (int64_t)s.pos(1);
+      }
+      held += (read == CommittedPlan::NEXT) ? 0 : 1;
+    }
+    done = true;
+  });
+
+  std::map<int64_t, int64_t> written;  // Index --> last commit that wrote it
+  for (int64_t i = 0; i < STATES; i++)
+  {
+    written[i] = 0;
+  }
+  int accepted = 0, rejected = 0;
+  for (int c = 1; done == false; c++)
+  {
+    int k_end = (plan.size() > 0) ? std::max(plan.size() - DELTA_T, 0) : -1;
+    int64_t a = plan.endIndex() - 1 - k_end;
+    if (plan.commit(k_end, stamps(a, STATES, c)) == true)
+    {
+      accepted++;
+      for (int64_t i = a; i < a + STATES; i++)
+      {
+        written[i] = c;
+      }
+    }
+    else
+    {
+      rejected++;
+    }
+  }
+  consumer.join();
+
+  bool replaced = false;
+  for (auto& index_commit : sent)
+  {
+    replaced = replaced || (written[index_commit.first] != index_commit.second);
+  }
+  std::sort(latencies_us.begin(), latencies_us.end());
+  double p99 = latencies_us[latencies_us.size() * 99 / 100];
+  std::cout << "commits: " << accepted << " accepted, " << rejected << " rejected. next(): " << TICKS << " ticks, "
+            << held << " held, p99 " << p99 << " us, max " << latencies_us.back() << " us" << std::endl;
+  check(torn == false, "full-rate replans: every state sent once, never half-written");
+  check(replaced == false, "full-rate replans: no state sent was replaced afterwards");
+  check(held == 0, "full-rate replans: no setpoint held by a commit");
+  check(latencies_us.back() < TICK_US, "full-rate replans: worst-case latency of next() below one tick");
+}
+}  // namespace
+
+int main()
+{
+  sequential();
+  concurrent();
+  std::cout << (failures == 0 ? "All the checks passed" : "Some checks failed") << std::endl;
+  return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,529 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2020, Jesus Tordesillas Torres, Aerospace Controls Laboratory
+ * Massachusetts Institute of Technology
+ * All Rights Reserved
+ * Authors: Jesus Tordesillas, et al.
+ * See LICENSE file for the license information
+ * -------------------------------------------------------------------------- */
+
+#include "cubic_qp.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+const double INF = std::numeric_limits<double>::infinity();
+const double TOL_ROW = 1e-12;       // Rows with a smaller norm don't depend on the jerks
+const double TOL_FEASIBLE = 1e-9;   // Of the constraints, that are normalized
+const double TOL_DIRECTION = 1e-14;
+
+// Weights of An = A*dt^3, Bn = B*dt^2, Cn = C*dt and Dn = D in the Bezier control point k of an interval
+const double BEZIER[4][4] = { { 0, 0, 0, 1 }, { 0, 0, 1.0 / 3.0, 1 }, { 0, 1.0 / 3.0, 2.0 / 3.0, 1 }, { 1, 1, 1, 1 } };
+}  // namespace
+
+void CubicQP::resize(int N, int max_faces)
+{
+  if (N == N_ && max_faces <= max_faces_)
+  {
+    return;
+  }
+  N_ = N;
+  n_ = 3 * N;
+  max_faces_ = std::max(max_faces, max_faces_);
+  int max_mi = 6 * n_ + 4 * N * max_faces_;  // vel, accel and jerk (both sides), and the faces
+  int max_me = 9;
+
+  for (auto S : { &Sp_, &Sv_, &Sa_ })
+  {
+    S->setZero(N + 1, N);
+  }
+  for (auto S0 : { &Sp0_, &Sv0_, &Sa0_ })
+  {
+    S0->setZero(N + 1, 3);
+  }
+  Scp_.setZero(4 * N, N);
+  Scp0_.setZero(4 * N, 3);
+  row_.setZero(3, N);
+
+  CI_.setZero(n_, max_mi);
+  CE_.setZero(n_, max_me);
+  ci0_.setZero(max_mi);
+  ce0_.setZero(max_me);
+
+  J_.setZero(n_, n_);
+  R_.setZero(n_, n_);
+  for (auto v : { &x_, &x_old_, &d_, &z_, &r_ })
+  {
+    v->setZero(n_);
+  }
+  u_.setZero(n_ + 1);
+  u_old_.setZero(n_ + 1);
+  s_.setZero(max_mi);
+  A_.assign(n_ + 1, 0);
+  A_old_.assign(n_ + 1, 0);
+  iai_.assign(max_mi, 0);
+  excluded_.assign(max_mi, false);
+}
+
+bool CubicQP::addInequality(const Mat3X& coeffs, double constant, double upper)
+{
+  // In the variables x_ = jerks / j_max_, and normalized
+  double norm = coeffs.norm() * j_max_;
+  if (norm < TOL_ROW)
+  {
+    return constant <= upper + TOL_FEASIBLE;
+  }
+  // Column-major 3 x N is the order of the jerks: 3k + i
+  CI_.col(mi_) = -Eigen::Map<const Eigen::VectorXd>(coeffs.data(), n_) * (j_max_ / norm);
+  ci0_(mi_) = (upper - constant) / norm;
+  mi_++;
+  return true;
+}
+
+void CubicQP::addEquality(const Mat3X& coeffs, double constant, double value)
+{
+  double norm = coeffs.norm() * j_max_;
+  CE_.col(me_) = Eigen::Map<const Eigen::VectorXd>(coeffs.data(), n_) * (j_max_ / norm);
+  ce0_(me_) = (constant - value) / norm;
+  me_++;
+}
+
+void CubicQP::setProblem(const double x0[9], const double xf[9], bool force_final, double dt, double v_max,
+                         double a_max, double j_max)
+{
+  dt_ = dt;
+  j_max_ = j_max;
+
+  // Exact integration of a constant jerk during dt
+  Sp_.row(0).setZero();
+  Sv_.row(0).setZero();
+  Sa_.row(0).setZero();
+  for (int i = 0; i < 3; i++)
+  {
+    Sp0_(0, i) = x0[i];
+    Sv0_(0, i) = x0[3 + i];
+    Sa0_(0, i) = x0[6 + i];
+  }
+  for (int t = 0; t < N_; t++)
+  {
+    Sp_.row(t + 1) = Sp_.row(t) + dt * Sv_.row(t) + (dt * dt / 2.0) * Sa_.row(t);
+    Sv_.row(t + 1) = Sv_.row(t) + dt * Sa_.row(t);
+    Sa_.row(t + 1) = Sa_.row(t);
+    Sp_(t + 1, t) += dt * dt * dt / 6.0;
+    Sv_(t + 1, t) += dt * dt / 2.0;
+    Sa_(t + 1, t) += dt;
+    Sp0_.row(t + 1) = Sp0_.row(t) + dt * Sv0_.row(t) + (dt * dt / 2.0) * Sa0_.row(t);
+    Sv0_.row(t + 1) = Sv0_.row(t) + dt * Sa0_.row(t);
+    Sa0_.row(t + 1) = Sa0_.row(t);
+  }
+
+  // Control points from An = jerk*dt^3/6, Bn = accel*dt^2/2, Cn = vel*dt and Dn = pos
+  for (int t = 0; t < N_; t++)
+  {
+    for (int k = 0; k < 4; k++)
+    {
+      const double* w = BEZIER[k];
+      Scp_.row(4 * t + k) = (w[1] * dt * dt / 2.0) * Sa_.row(t) + (w[2] * dt) * Sv_.row(t) + w[3] * Sp_.row(t);
+      Scp_(4 * t + k, t) += w[0] * dt * dt * dt / 6.0;
+      Scp0_.row(4 * t + k) = (w[1] * dt * dt / 2.0) * Sa0_.row(t) + (w[2] * dt) * Sv0_.row(t) + w[3] * Sp0_.row(t);
+    }
+  }
+
+  // As in SolverGurobi::setMaxConstraints(), only at the start of each interval
+  mi_ = 0;
+  mi_fixed_ = 0;
+  fixed_infeasible_ = false;
+  auto addLimit = [&](int i, const Eigen::MatrixXd& S, const Eigen::MatrixXd& S0, int t, double limit) {
+    row_.setZero();
+    row_.row(i) = S.row(t);
+    bool feasible = addInequality(row_, S0(t, i), limit);
+    row_.row(i) = -S.row(t);
+    feasible = addInequality(row_, -S0(t, i), limit) && feasible;
+    fixed_infeasible_ = fixed_infeasible_ || !feasible;
+  };
+  for (int t = 0; t < N_; t++)
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      addLimit(i, Sv_, Sv0_, t, v_max);
+      addLimit(i, Sa_, Sa0_, t, a_max);
+      row_.setZero();
+      row_(i, t) = 1;
+      addInequality(row_, 0, j_max);
+      row_(i, t) = -1;
+      addInequality(row_, 0, j_max);
+    }
+  }
+  mi_fixed_ = mi_;
+
+  me_ = 0;
+  for (int i = 0; i < 3; i++)
+  {
+    row_.setZero();
+    row_.row(i) = Sv_.row(N_);
+    addEquality(row_, Sv0_(N_, i), xf[3 + i]);
+    row_.row(i) = Sa_.row(N_);
+    addEquality(row_, Sa0_(N_, i), xf[6 + i]);
+    if (force_final)
+    {
+      row_.row(i) = Sp_.row(N_);
+      addEquality(row_, Sp0_(N_, i), xf[i]);
+    }
+  }
+}
+
+void CubicQP::setPolytopes(const std::vector<LinearConstraint3D>& polytopes, const std::vector<int>& assignment)
+{
+  mi_ = mi_fixed_;
+  faces_infeasible_ = false;
+  for (int t = 0; t < N_; t++)
+  {
+    const LinearConstraint3D& polytope = polytopes[assignment[t]];
+    const auto& A = polytope.A();
+    const auto& b = polytope.b();
+    // The first control point of t is the last one of t-1
+    int k_first = (t > 0 && assignment[t] == assignment[t - 1]) ? 1 : 0;
+    for (int k = k_first; k < 4; k++)
+    {
+      for (int f = 0; f < A.rows(); f++)
+      {
+        Eigen::Vector3d normal = A.row(f).transpose();
+        row_.noalias() = normal * Scp_.row(4 * t + k);
+        if (addInequality(row_, normal.dot(Scp0_.row(4 * t + k).transpose()), b(f)) == false)
+        {
+          faces_infeasible_ = true;  // X0 is outside of the first polytope
+        }
+      }
+    }
+  }
+}
+
+// z = J2 * d2 (direction of the step in the primal space) and r = R^-1 * d1 (in the dual space)
+void CubicQP::updateZR(int iq)
+{
+  z_.noalias() = J_.rightCols(n_ - iq) * d_.tail(n_ - iq);
+  r_.head(iq) = d_.head(iq);
+  R_.topLeftCorner(iq, iq).triangularView<Eigen::Upper>().solveInPlace(r_.head(iq));
+}
+
+// Givens rotations so that d_ = J' * n has zeros after the position iq (and the new column of R_)
+bool CubicQP::addConstraint(int& iq, double& R_norm)
+{
+  for (int j = n_ - 1; j >= iq + 1; j--)
+  {
+    double cc = d_(j - 1);
+    double ss = d_(j);
+    double h = std::hypot(cc, ss);
+    if (h == 0.0)
+    {
+      continue;
+    }
+    d_(j) = 0.0;
+    ss = ss / h;
+    cc = cc / h;
+    if (cc < 0.0)
+    {
+      cc = -cc;
+      ss = -ss;
+      d_(j - 1) = -h;
+    }
+    else
+    {
+      d_(j - 1) = h;
+    }
+    double xny = ss / (1.0 + cc);
+    for (int k = 0; k < n_; k++)
+    {
+      double t1 = J_(k, j - 1);
+      double t2 = J_(k, j);
+      J_(k, j - 1) = t1 * cc + t2 * ss;
+      J_(k, j) = xny * (t1 + J_(k, j - 1)) - t2;
+    }
+  }
+  iq++;
+  R_.col(iq - 1).head(iq) = d_.head(iq);
+  if (fabs(d_(iq - 1)) <= std::numeric_limits<double>::epsilon() * R_norm)
+  {
+    return false;  // Linearly dependent on the active constraints
+  }
+  R_norm = std::max(R_norm, fabs(d_(iq - 1)));
+  return true;
+}
+
+void CubicQP::deleteConstraint(int& iq, int l)
+{
+  int qq = -1;
+  for (int i = me_; i < iq; i++)
+  {
+    if (A_[i] == l)
+    {
+      qq = i;
+      break;
+    }
+  }
+  for (int i = qq; i < iq - 1; i++)
+  {
+    A_[i] = A_[i + 1];
+    u_(i) = u_(i + 1);
+    R_.col(i) = R_.col(i + 1);
+  }
+  A_[iq - 1] = A_[iq];
+  u_(iq - 1) = u_(iq);
+  A_[iq] = 0;
+  u_(iq) = 0.0;
+  R_.col(iq - 1).head(iq).setZero();
+  iq--;
+
+  for (int j = qq; j < iq; j++)
+  {
+    double cc = R_(j, j);
+    double ss = R_(j + 1, j);
+    double h = std::hypot(cc, ss);
+    if (h == 0.0)
+    {
+      continue;
+    }
+    cc = cc / h;
+    ss = ss / h;
+    R_(j + 1, j) = 0.0;
+    if (cc < 0.0)
+    {
+      R_(j, j) = -h;
+      cc = -cc;
+      ss = -ss;
+    }
+    else
+    {
+      R_(j, j) = h;
+    }
+    double xny = ss / (1.0 + cc);
+    for (int k = j + 1; k < iq; k++)
+    {
+      double t1 = R_(j, k);
+      double t2 = R_(j + 1, k);
+      R_(j, k) = t1 * cc + t2 * ss;
+      R_(j + 1, k) = xny * (t1 + R_(j, k)) - t2;
+    }
+    for (int k = 0; k < n_; k++)
+    {
+      double t1 = J_(k, j);
+      double t2 = J_(k, j + 1);
+      J_(k, j) = t1 * cc + t2 * ss;
+      J_(k, j + 1) = xny * (J_(k, j) + t1) - t2;
+    }
+  }
+}
+
+// Goldfarb, D. and Idnani, A., "A numerically stable dual method for solving strictly convex quadratic programs",
+// 1983. Cost: 1/2 x' G x with G = 2I (the sum of the squared jerks / j_max^2), so the unconstrained optimum is 0
+CubicQP::Status CubicQP::solve(const std::atomic<bool>* stop, std::chrono::steady_clock::time_point deadline)
+{
+  iterations_ = 0;
+  if (fixed_infeasible_ || faces_infeasible_)
+  {
+    return INFEASIBLE;
+  }
+
+  J_.setIdentity();
+  J_ *= 1.0 / sqrt(2.0);  // L^-T, with L L' = G
+  R_.setZero();
+  x_.setZero();
+  double R_norm = 1.0;
+  int iq = 0;
+
+  for (int i = 0; i < me_; i++)
+  {
+    auto np = CE_.col(i);
+    d_.noalias() = J_.transpose() * np;
+    updateZR(iq);
+    double t2 = 0.0;
+    if (z_.squaredNorm() > TOL_DIRECTION)
+    {
+      t2 = (-np.dot(x_) - ce0_(i)) / z_.dot(np);
+    }
+    x_ += t2 * z_;
+    u_(iq) = t2;
+    u_.head(iq) -= t2 * r_.head(iq);
+    A_[iq] = -i - 1;
+    if (addConstraint(iq, R_norm) == false)
+    {
+      return INFEASIBLE;  // Xf can't be reached with N intervals
+    }
+  }
+
+  for (int i = 0; i < mi_; i++)
+  {
+    iai_[i] = i;
+  }
+
+  bool retry = false;  // After a degenerate step: scan again, without the inequality that caused it
+  while (true)
+  {
+    iterations_++;
+    if (iterations_ > max_iter)
+    {
+      return MAX_ITERATIONS;
+    }
+    if (iterations_ % 16 == 0 &&
+        ((stop != nullptr && *stop == true) || std::chrono::steady_clock::now() >= deadline))
+    {
+      return STOPPED;
+    }
+
+    // Most violated inequality. As in QuadProg++, the exclusions only last until a step succeeds
+    if (retry == false)
+    {
+      std::fill(excluded_.begin(), excluded_.begin() + mi_, false);
+    }
+    retry = false;
+    for (int i = me_; i < iq; i++)
+    {
+      iai_[A_[i]] = -1;
+    }
+    s_.head(mi_).noalias() = CI_.leftCols(mi_).transpose() * x_;
+    s_.head(mi_) += ci0_.head(mi_);
+    int ip = -1;
+    double ss = -TOL_FEASIBLE;
+    for (int i = 0; i < mi_; i++)
+    {
+      if (s_(i) < ss && iai_[i] != -1 && excluded_[i] == false)
+      {
+        ss = s_(i);
+        ip = i;
+      }
+    }
+    if (ip == -1)
+    {
+      return checkFeasible();  // The excluded inequalities may still be violated
+    }
+
+    x_old_ = x_;
+    for (int i = 0; i < iq; i++)
+    {
+      u_old_(i) = u_(i);
+      A_old_[i] = A_[i];
+    }
+    u_(iq) = 0.0;
+    A_[iq] = ip;
+
+    // Steps (partial if a constraint has to be dropped) until ip is active
+    while (true)
+    {
+      auto np = CI_.col(ip);
+      d_.noalias() = J_.transpose() * np;
+      updateZR(iq);
+
+      double t1 = INF;  // Dual step, limited by the multipliers of the active inequalities
+      int l = -1;
+      for (int k = me_; k < iq; k++)
+      {
+        if (r_(k) > 0.0 && u_(k) / r_(k) < t1)
+        {
+          t1 = u_(k) / r_(k);
+          l = A_[k];
+        }
+      }
+      double t2 = INF;  // Full step
+      if (z_.squaredNorm() > TOL_DIRECTION)
+      {
+        t2 = -s_(ip) / z_.dot(np);
+      }
+      double t = std::min(t1, t2);
+      if (t >= INF)
+      {
+        return INFEASIBLE;
+      }
+
+      if (t2 >= INF)
+      {
+        // Only in the dual space
+        u_.head(iq) -= t * r_.head(iq);
+        u_(iq) += t;
+        iai_[l] = l;
+        deleteConstraint(iq, l);
+        continue;
+      }
+
+      x_ += t * z_;
+      u_.head(iq) -= t * r_.head(iq);
+      u_(iq) += t;
+
+      if (t == t2)
+      {
+        if (addConstraint(iq, R_norm) == false)
+        {
+          // Degenerate: go back and don't try ip again in this scan
+          excluded_[ip] = true;
+          retry = true;
+          deleteConstraint(iq, ip);
+          for (int i = 0; i < mi_; i++)
+          {
+            iai_[i] = i;
+          }
+          for (int i = me_; i < iq; i++)
+          {
+            A_[i] = A_old_[i];
+            iai_[A_[i]] = -1;
+            u_(i) = u_old_(i);
+          }
+          x_ = x_old_;
+        }
+        else
+        {
+          iai_[ip] = -1;
+        }
+        break;
+      }
+
+      iai_[l] = l;
+      deleteConstraint(iq, l);
+      s_(ip) = np.dot(x_) + ci0_(ip);
+    }
+  }
+}
+
+// All the rows (also the excluded and the active ones) at x_
+CubicQP::Status CubicQP::checkFeasible()
+{
+  s_.head(mi_).noalias() = CI_.leftCols(mi_).transpose() * x_;
+  s_.head(mi_) += ci0_.head(mi_);
+  if (mi_ > 0 && s_.head(mi_).minCoeff() < -TOL_FEASIBLE)
+  {
+    return NUMERIC;
+  }
+  for (int i = 0; i < me_; i++)
+  {
+    if (fabs(CE_.col(i).dot(x_) + ce0_(i)) > TOL_FEASIBLE)
+    {
+      return NUMERIC;
+    }
+  }
+  return SOLVED;
+}
+
+void CubicQP::getCoefficients(std::vector<double>& coeffs) const
+{
+  coeffs.resize(12 * N_);
+  Eigen::VectorXd jerks(N_);
+  for (int i = 0; i < 3; i++)
+  {
+    for (int t = 0; t < N_; t++)
+    {
+      jerks(t) = j_max_ * x_(3 * t + i);
+    }
+    for (int t = 0; t < N_; t++)
+    {
+      double* c = &coeffs[12 * t];
+      c[0 + i] = jerks(t) / 6.0;
+      c[3 + i] = (Sa_.row(t).dot(jerks) + Sa0_(t, i)) / 2.0;
+      c[6 + i] = Sv_.row(t).dot(jerks) + Sv0_(t, i);
+      c[9 + i] = Sp_.row(t).dot(jerks) + Sp0_(t, i);
+    }
+  }
+}
+
+double CubicQP::cost() const
+{
+  return j_max_ * j_max_ * x_.squaredNorm();
+}
@@ -0,0 +1,191 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2020, Jesus Tordesillas Torres, Aerospace Controls Laboratory
+ * Massachusetts Institute of Technology
+ * All Rights Reserved
+ * Authors: Jesus Tordesillas, et al.
+ * See LICENSE file for the license information
+ * -------------------------------------------------------------------------- */
+
+// Checks of CubicQP that don't need Gurobi: small problems whose active faces and limits are known. Every solution
+// is checked against all the constraints (recomputed here from the coefficients), and the active ones must be at
+// their bound. Returns 0 if all the checks pass (run by ctest, see CMakeLists.txt)
+
+#include "cubic_qp.hpp"
+
+#include <iostream>
+#include <limits>
+
+namespace
+{
+const double TOL = 1e-6;
+const int N = 6;
+const double DT = 0.5;
+
+int failures = 0;
+
+void check(bool condition, const std::string& what)
+{
+  std::cout << (condition ? "[ OK ] " : "[FAIL] ") << what << std::endl;
+  failures += condition ? 0 : 1;
+}
+
+// Box [lower, upper], optionally with the face x <= upper(0) twice (degenerate: linearly dependent rows)
+LinearConstraint3D box(const Eigen::Vector3d& lower, const Eigen::Vector3d& upper, bool duplicated_face = false)
+{
+  int rows = duplicated_face ? 7 : 6;
+  MatDNf<3> A = MatDNf<3>::Zero(rows, 3);
+  VecDf b(rows);
+  for (int i = 0; i < 3; i++)
+  {
+    A(2 * i, i) = 1;
+    b(2 * i) = upper(i);
+    A(2 * i + 1, i) = -1;
+    b(2 * i + 1) = -lower(i);
+  }
+  if (duplicated_face)
+  {
+    A(6, 0) = 1;
+    b(6) = upper(0);
+  }
+  return LinearConstraint3D(A, b);
+}
+
+struct Limits
+{
+  double v_max = 10, a_max = 10, j_max = 100;
+};
+
+// Largest violation of the constraints of CubicQP (coefficients of TrajectorySolver::getCoefficients()), and the
+// largest vel, accel, jerk and x of the control points
+struct Result
+{
+  double violation = 0;
+  double max_vel = 0, max_accel = 0, max_jerk = 0, max_cp_x = -std::numeric_limits<double>::infinity();
+};
+
+Result evaluate(const std::vector<double>& coeffs, const double x0[9], const double xf[9], bool force_final,
+                const std::vector<LinearConstraint3D>& polytopes, const std::vector<int>& assignment,
+                const Limits& limits)
+{
+  Result result;
+  auto violated = [&](double value) { result.violation = std::max(result.violation, value); };
+  for (int t = 0; t < N; t++)
+  {
+    const double* c = &coeffs[12 * t];
+    Eigen::Matrix<double, 3, 4> cps;
+    for (int i = 0; i < 3; i++)
+    {
+      double a = c[i], b = c[3 + i], cc = c[6 + i], d = c[9 + i];
+      cps.row(i) << d, d + cc * DT / 3, d + 2 * cc * DT / 3 + b * DT * DT / 3,
+          d + cc * DT + b * DT * DT + a * DT * DT * DT;
+
+      // Limits at the start of the interval
+      result.max_vel = std::max(result.max_vel, fabs(cc));
+      result.max_accel = std::max(result.max_accel, fabs(2 * b));
+      result.max_jerk = std::max(result.max_jerk, fabs(6 * a));
+      violated(fabs(cc) - limits.v_max);
+      violated(fabs(2 * b) - limits.a_max);
+      violated(fabs(6 * a) - limits.j_max);
+
+      // X0, continuity and Xf
+      double end[3] = { cps(i, 3), 3 * a * DT * DT + 2 * b * DT + cc, 6 * a * DT + 2 * b };
+      if (t == 0)
+      {
+        violated(fabs(d - x0[i]) + fabs(cc - x0[3 + i]) + fabs(2 * b - x0[6 + i]));
+      }
+      if (t + 1 < N)
+      {
+        const double* next = &coeffs[12 * (t + 1)];
+        violated(fabs(end[0] - next[9 + i]) + fabs(end[1] - next[6 + i]) + fabs(end[2] - 2 * next[3 + i]));
+      }
+      else
+      {
+        violated(fabs(end[1] - xf[3 + i]) + fabs(end[2] - xf[6 + i]) + (force_final ? fabs(end[0] - xf[i]) : 0));
+      }
+    }
+    const LinearConstraint3D& polytope = polytopes[assignment[t]];
+    violated(((polytope.A_ * cps).colwise() - polytope.b_).maxCoeff());
+    result.max_cp_x = std::max(result.max_cp_x, cps.row(0).maxCoeff());
+  }
+  return result;
+}
+
+CubicQP::Status solve(CubicQP& qp, const double x0[9], const double xf[9], bool force_final,
+                      const std::vector<LinearConstraint3D>& polytopes, const std::vector<int>& assignment,
+                      const Limits& limits, std::vector<double>& coeffs)
+{
+  int max_faces = 0;
+  for (const LinearConstraint3D& polytope : polytopes)
+  {
+    max_faces = std::max(max_faces, (int)polytope.b_.rows());
+  }
+  qp.resize(N, max_faces);
+  qp.setProblem(x0, xf, force_final, DT, limits.v_max, limits.a_max, limits.j_max);
+  qp.setPolytopes(polytopes, assignment);
+  CubicQP::Status status = qp.solve(nullptr, std::chrono::steady_clock::time_point::max());
+  if (status == CubicQP::SOLVED)
+  {
+    qp.getCoefficients(coeffs);
+  }
+  return status;
+}
+}  // namespace
+
+int main()
+{
+  CubicQP qp;
+  std::vector<double> coeffs;
+  std::vector<int> one_polytope(N, 0);
+  std::vector<LinearConstraint3D> free_space = { box(Eigen::Vector3d(-100, -100, -100),
+                                                     Eigen::Vector3d(100, 100, 100)) };
+  const double rest[9] = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+  // 1. Moving at 1 m/s towards x, back to rest at the origin: the trajectory goes past x = 0.45 unless a face stops
+  // it (the third control point of the first interval is at x = 1/3 whatever the jerk, so the wall can't be closer)
+  double x0[9] = { 0, 0, 0, 1, 0, 0, 0, 0, 0 };
+  Limits limits;
+  CubicQP::Status status = solve(qp, x0, rest, true, free_space, one_polytope, limits, coeffs);
+  Result free = evaluate(coeffs, x0, rest, true, free_space, one_polytope, limits);
+  double cost_free = qp.cost();
+  check(status == CubicQP::SOLVED && free.violation < TOL, "free space: solved and feasible");
+  check(free.max_cp_x > 0.45 + 1e-3, "free space: goes past x = 0.45");
+
+  for (bool duplicated : { false, true })
+  {
+    std::string name = duplicated ? "wall x <= 0.45 (face twice)" : "wall x <= 0.45";
+    std::vector<LinearConstraint3D> wall = { box(Eigen::Vector3d(-1, -1, -1), Eigen::Vector3d(0.45, 1, 1),
+                                                 duplicated) };
+    status = solve(qp, x0, rest, true, wall, one_polytope, limits, coeffs);
+    Result result = evaluate(coeffs, x0, rest, true, wall, one_polytope, limits);
+    check(status == CubicQP::SOLVED && result.violation < TOL, name + ": solved and feasible");
+    check(fabs(result.max_cp_x - 0.45) < TOL, name + ": the face is active");
+    check(qp.cost() >= cost_free - TOL, name + ": costs more than in free space");
+  }
+
+  // 2. From rest to rest 3 m away in 3 s: without limits the peak speed is ~1.9 m/s, so v_max = 1.5 is active
+  double xf[9] = { 3, 0, 0, 0, 0, 0, 0, 0, 0 };
+  limits.v_max = 1.5;
+  limits.a_max = 3;
+  status = solve(qp, rest, xf, true, free_space, one_polytope, limits, coeffs);
+  Result result = evaluate(coeffs, rest, xf, true, free_space, one_polytope, limits);
+  check(status == CubicQP::SOLVED && result.violation < TOL, "v_max: solved and feasible");
+  check(fabs(result.max_vel - limits.v_max) < TOL, "v_max: the velocity limit is active");
+
+  // 3. Same, but 8 m away: impossible with v_max = 1.5 in 3 s
+  xf[0] = 8;
+  status = solve(qp, rest, xf, true, free_space, one_polytope, limits, coeffs);
+  check(status == CubicQP::INFEASIBLE, "v_max: infeasible if too far");
+
+  // 4. Two polytopes, the trajectory has to go through their intersection (x in [1, 1.5], y >= 1)
+  std::vector<LinearConstraint3D> corridor = { box(Eigen::Vector3d(-0.5, -0.5, -0.5), Eigen::Vector3d(1.5, 0.5, 0.5)),
+                                               box(Eigen::Vector3d(1, -0.5, -0.5), Eigen::Vector3d(1.5, 2, 0.5)) };
+  std::vector<int> assignment = { 0, 0, 0, 1, 1, 1 };
+  double corner[9] = { 1.25, 1.5, 0, 0, 0, 0, 0, 0, 0 };
+  limits = Limits();
+  status = solve(qp, rest, corner, true, corridor, assignment, limits, coeffs);
+  result = evaluate(coeffs, rest, corner, true, corridor, assignment, limits);
+  check(status == CubicQP::SOLVED && result.violation < TOL, "corridor: solved and feasible");
+
+  std::cout << (failures == 0 ? "All the checks passed" : "Some checks failed") << std::endl;
+  return (failures == 0) ? 0 : 1;
+}
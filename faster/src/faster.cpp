@@ -37,7 +37,7 @@ Faster::Faster(parameters par) : par_(par)
   mtx_initial_cond.unlock();
 
   // Setup of jps_manager
-  std::cout << "par_.wdx / par_.res =" << par_.wdx / par_.res << std::endl;
+  FASTER_DEBUG("par_.wdx / par_.res =" << par_.wdx / par_.res);
   jps_manager_.setNumCells((int)par_.wdx / par_.res, (int)par_.wdy / par_.res, (int)par_.wdz / par_.res);
   jps_manager_.setFactorJPS(par_.factor_jps);
   jps_manager_.setResolution(par_.res);
@@ -46,32 +46,65 @@ Faster::Faster(parameters par) : par_(par)
   // jps_manager_.setVisual(par_.visual);
   jps_manager_.setDroneRadius(par_.drone_radius);
 
-  double max_values[3] = { par_.v_max, par_.a_max, par_.j_max };
+  auto newSolver = [&]() {
+    TrajectorySolver* solver = (par_.adaptive_size == true) ? createAdaptiveSolver(par_.solver_backend) :
+                                                              createTrajectorySolver(par_.solver_backend);
+    if (solver == nullptr)
+    {
+      FASTER_ERROR(red << "Unknown solver_backend (or not in this build): " << par_.solver_backend << reset);
+      exit(1);
+    }
+    return (par_.solution_cache == true) ? createCachedSolver(solver) : solver;
+  };
 
   // Setup of sg_whole_
-  sg_whole_.setN(par_.N_whole);
-  sg_whole_.createVars();
-  sg_whole_.setDC(par_.dc);
-  sg_whole_.setBounds(max_values);
-  sg_whole_.setForceFinalConstraint(true);
-  sg_whole_.setFactorInitialAndFinalAndIncrement(1, 10, par_.increment_whole);
-  sg_whole_.setVerbose(par_.gurobi_verbose);
-  sg_whole_.setThreads(par_.gurobi_threads);
-  sg_whole_.setWMax(par_.w_max);
-
-  // Setup of sg_safe_
-  sg_safe_.setN(par_.N_safe);
-  sg_safe_.createVars();
-  sg_safe_.setDC(par_.dc);
-  sg_safe_.setBounds(max_values);
-  sg_safe_.setForceFinalConstraint(false);
-  sg_safe_.setFactorInitialAndFinalAndIncrement(1, 10, par_.increment_safe);
-  sg_safe_.setVerbose(par_.gurobi_verbose);
-  sg_safe_.setThreads(par_.gurobi_threads);
-  sg_safe_.setWMax(par_.w_max);
-
-  pclptr_unk_ = pcl::PointCloud<pcl::PointXYZ>::Ptr(new pcl::PointCloud<pcl::PointXYZ>);
-  pclptr_map_ = pcl::PointCloud<pcl::PointXYZ>::Ptr(new pcl::PointCloud<pcl::PointXYZ>);
+  solver_settings settings_whole;
+  settings_whole.N = par_.N_whole;
+  settings_whole.dc = par_.dc;
+  settings_whole.v_max = par_.v_max;
+  settings_whole.a_max = par_.a_max;
+  settings_whole.j_max = par_.j_max;
+  settings_whole.w_max = par_.w_max;
+  settings_whole.force_final_constraint = true;
+  settings_whole.factor_initial = 1;
+  settings_whole.factor_final = 10;
+  settings_whole.factor_increment = par_.increment_whole;
+  settings_whole.threads = par_.gurobi_threads;
+  settings_whole.verbose = par_.gurobi_verbose;
+  settings_whole.factor_bisection = par_.factor_bisection;
+  settings_whole.warm_start = par_.warm_start;
+  settings_whole.monotone_binaries = par_.monotone_binaries;
+  settings_whole.monotone_qp = par_.monotone_qp;
+  settings_whole.parallel_factors = par_.parallel_factors;
+  settings_whole.lazy_faces = par_.lazy_faces;
+  settings_whole.lazy_faces_margin = par_.lazy_faces_margin;
+  settings_whole.formulation = par_.gurobi_formulation;
+  settings_whole.N_min = par_.adaptive_N_min;
+  settings_whole.length_per_interval = par_.adaptive_length_per_interval;
+  settings_whole.cache_size = par_.solution_cache_size;
+  settings_whole.cache_resolution = par_.solution_cache_resolution;
+  sg_whole_.reset(newSolver());
+  sg_whole_->setup(settings_whole);
+
+  // Setup of sg_safe_ (and of the solvers of the other candidates R)
+  solver_settings settings_safe = settings_whole;
+  settings_safe.N = par_.N_safe;
+  settings_safe.force_final_constraint = false;
+  settings_safe.factor_increment = par_.increment_safe;
+  sg_safe_.reset(newSolver());
+  for (int i = 1; i < par_.safe_candidates; i++)
+  {
+    sg_safe_candidates_.push_back(std::unique_ptr<TrajectorySolver>(newSolver()));
+  }
+  safe_solvers_.push_back(sg_safe_.get());
+  for (auto& sg : sg_safe_candidates_)
+  {
+    safe_solvers_.push_back(sg.get());
+  }
+  for (TrajectorySolver* sg : safe_solvers_)
+  {
+    sg->setup(settings_safe);
+  }
 
   changeDroneStatus(DroneStatus::GOAL_REACHED);
   resetInitialization();
@@ -96,44 +129,105 @@ void Faster::createMoreVertexes(vec_Vecf<3>& path, double d)
   }
 }
 
+// Removes the vertexes where the path doesn't turn, as long as the segments stay shorter than d (see adaptive_size)
+void Faster::mergeStraightVertexes(vec_Vecf<3>& path, double d)
+{
+  for (int j = 1; j + 1 < path.size();)
+  {
+    if (isTurn(path[j - 1], path[j], path[j + 1]) == false && (path[j + 1] - path[j - 1]).norm() <= d)
+    {
+      path.erase(path.begin() + j);
+    }
+    else
+    {
+      j = j + 1;
+    }
+  }
+}
+
 void Faster::updateMap(pcl::PointCloud<pcl::PointXYZ>::Ptr pclptr_map, pcl::PointCloud<pcl::PointXYZ>::Ptr pclptr_unk)
 {
-  mtx_map.lock();
-  mtx_unk.lock();
+  // The new snapshot is built off to the side: the planner keeps using the one it pinned until it finishes
+  std::shared_ptr<const MapSnapshot> previous = std::atomic_load(&map_snapshot_);
+  std::shared_ptr<MapSnapshot> snapshot = std::make_shared<MapSnapshot>();
 
-  // TODO
-  pclptr_map_ = pclptr_map;
-  pclptr_unk_ = pclptr_unk;
+  snapshot->pclptr_map = pclptr_map;
+  snapshot->pclptr_unk = pclptr_unk;
 
-  jps_manager_.updateJPSMap(pclptr_map_, state_.pos);  // Update even where there are no points
+  Eigen::Vector3d center = state_.pos;
+  snapshot->map_util = jps_manager_.buildJPSMap(pclptr_map, center);  // Update even where there are no points
 
-  if (pclptr_map_->width != 0 && pclptr_map_->height != 0)  // Point Cloud is not empty
+  if (pclptr_map->width != 0 && pclptr_map->height != 0)  // Point Cloud is not empty
   {
-    kdtree_map_.setInputCloud(pclptr_map_);
-    kdtree_map_initialized_ = 1;
-    jps_manager_.vec_o_ = pclptr_to_vec(pclptr_map_);
+    std::shared_ptr<pcl::KdTreeFLANN<pcl::PointXYZ>> kdtree_map = std::make_shared<pcl::KdTreeFLANN<pcl::PointXYZ>>();
+    kdtree_map->setInputCloud(pclptr_map);
+    snapshot->kdtree_map = kdtree_map;
+    snapshot->vec_o = pclptr_to_vec(pclptr_map);
   }
   else
   {
-    std::cout << "Occupancy Grid received is empty, maybe map is too small?" << std::endl;
+    FASTER_WARN("Occupancy Grid received is empty, maybe map is too small?");
+    if (previous != nullptr)
+    {
+      snapshot->kdtree_map = previous->kdtree_map;
+      snapshot->vec_o = previous->vec_o;
+    }
   }
 
-  if (pclptr_unk_->points.size() == 0)
+  if (pclptr_unk->points.size() == 0)
   {
-    std::cout << "Unkown cloud has 0 points" << std::endl;
-    return;
+    FASTER_WARN("Unkown cloud has 0 points");
+    if (previous != nullptr)
+    {
+      snapshot->kdtree_unk = previous->kdtree_unk;
+      snapshot->vec_uo = previous->vec_uo;
+    }
   }
   else
   {
-    kdtree_unk_.setInputCloud(pclptr_unk_);
-    kdtree_unk_initialized_ = 1;
-    jps_manager_.vec_uo_ = pclptr_to_vec(pclptr_unk_);  // insert unknown space
-    jps_manager_.vec_uo_.insert(jps_manager_.vec_uo_.end(), jps_manager_.vec_o_.begin(),
-                                jps_manager_.vec_o_.end());  // append known space
+    std::shared_ptr<pcl::KdTreeFLANN<pcl::PointXYZ>> kdtree_unk = std::make_shared<pcl::KdTreeFLANN<pcl::PointXYZ>>();
+    kdtree_unk->setInputCloud(pclptr_unk);
+    snapshot->kdtree_unk = kdtree_unk;
+    snapshot->vec_uo = pclptr_to_vec(pclptr_unk);  // insert unknown space
+    snapshot->vec_uo.insert(snapshot->vec_uo.end(), snapshot->vec_o.begin(),
+                            snapshot->vec_o.end());  // append known space
+  }
+
+  if (par_.revalidate_plan == true)
+  {
+    if (pclptr_map->width != 0 && pclptr_map->height != 0)
+    {
+      std::shared_ptr<std::unordered_set<int64_t>> keys_map = std::make_shared<std::unordered_set<int64_t>>();
+      for (const auto& p : snapshot->vec_o)
+      {
+        keys_map->insert(voxelKey(p, par_.res));
+      }
+      snapshot->keys_map = keys_map;
+    }
+    else if (previous != nullptr)
+    {
+      snapshot->keys_map = previous->keys_map;
+    }
+
+    if (pclptr_unk->points.size() != 0)
+    {
+      std::shared_ptr<std::unordered_set<int64_t>> keys_unk = std::make_shared<std::unordered_set<int64_t>>();
+      for (const auto& p : pclptr_unk->points)
+      {
+        keys_unk->insert(voxelKey(Eigen::Vector3d(p.x, p.y, p.z), par_.res));
+      }
+      snapshot->keys_unk = keys_unk;
+    }
+    else if (previous != nullptr)
+    {
+      snapshot->keys_unk = previous->keys_unk;
+    }
   }
 
-  mtx_map.unlock();
-  mtx_unk.unlock();
+  std::atomic_store(&map_snapshot_, std::shared_ptr<const MapSnapshot>(snapshot));
+  kdtree_map_initialized_ = (snapshot->kdtree_map != nullptr);
+  kdtree_unk_initialized_ = (snapshot->kdtree_unk != nullptr);
+  map_generation_++;
 }
 
 void Faster::setTerminalGoal(state& term_goal)
@@ -151,6 +245,7 @@ void Faster::setTerminalGoal(state& term_goal)
     changeDroneStatus(DroneStatus::YAWING);  // not done when drone_status==traveling
   }
   terminal_goal_initialized_ = true;
+  goal_generation_++;
 
   mtx_state.unlock();
   mtx_G.unlock();
@@ -163,6 +258,37 @@ void Faster::getG(state& G)
   G = G_;
 }
 
+void Faster::startTelemetry(Telemetry::Sink sink)
+{
+  telemetry_.start(par_.telemetry_file, sink);
+}
+
+void Faster::warmUpSolvers()
+{
+  // Faces of the polytopes of cvxEllipsoidDecomp: the 6 of its local bounding box and a few of the obstacles (the
+  // solvers rebuild the structure if a polytope has more). Problems with fewer polytopes than max_poly_* use the same
+  // structure, padded
+  const int n_faces = 12;
+
+  MyTimer warm_up_t(true);
+  sg_whole_->warmUp(par_.max_poly_whole, n_faces);
+  for (TrajectorySolver* sg : safe_solvers_)
+  {
+    sg->warmUp(par_.max_poly_safe, n_faces);
+  }
+  FASTER_INFO("Solvers warmed up in " << warm_up_t.ElapsedMs() << " ms");
+}
+
+void Faster::getReplanTimes(replan_times& times)
+{
+  times = times_;
+}
+
+void Faster::getReplanRecord(replan_record& record)
+{
+  record = record_;
+}
+
 void Faster::getState(state& data)
 {
   mtx_state.lock();
@@ -175,16 +301,16 @@ int Faster::findIndexR(int indexH)
   // Ignore z to obtain this heuristics (if not it can become very conservative)
   // mtx_X_U_temp.lock();
   Eigen::Vector2d posHk;
-  posHk << sg_whole_.X_temp_[indexH].pos(0), sg_whole_.X_temp_[indexH].pos(1);
+  posHk << sg_whole_->X_temp_[indexH].pos(0), sg_whole_->X_temp_[indexH].pos(1);
   int indexR = indexH;
 
   for (int i = 0; i <= indexH; i = i + 1)  // Loop from A to H
   {
     Eigen::Vector2d vel;
-    vel << sg_whole_.X_temp_[i].vel(0), sg_whole_.X_temp_[i].vel(1);  //(i, 3), sg_whole_.X_temp_(i, 4);
+    vel << sg_whole_->X_temp_[i].vel(0), sg_whole_->X_temp_[i].vel(1);  //(i, 3), sg_whole_->X_temp_(i, 4);
 
     Eigen::Vector2d pos;
-    pos << sg_whole_.X_temp_[i].pos(0), sg_whole_.X_temp_[i].pos(1);
+    pos << sg_whole_->X_temp_[i].pos(0), sg_whole_->X_temp_[i].pos(1);
 
     Eigen::Vector2d braking_distance =
         (vel.array() * (posHk - pos).array()).sign() * vel.array().square() / (2 * par_.delta_a * par_.a_max);
@@ -202,20 +328,20 @@ int Faster::findIndexR(int indexH)
 
       if (indexR == 0)
       {
-        std::cout << bold << red << "R was taken in A" << reset << std::endl;
+        FASTER_DEBUG(bold << red << "R was taken in A" << reset);
       }
 
       break;
     }
   }
-  // std::cout << blue << "indexR=" << indexR << " /" << sg_whole_.X_temp_.size() - 1 << reset << std::endl;
-  // std::cout << red << bold << "indexH=" << indexH << " /" << sg_whole_.X_temp_.rows() - 1 << reset << std::endl;
+  // std::cout << blue << "indexR=" << indexR << " /" << sg_whole_->X_temp_.size() - 1 << reset << std::endl;
+  // std::cout << red << bold << "indexH=" << indexH << " /" << sg_whole_->X_temp_.rows() - 1 << reset << std::endl;
   // mtx_X_U_temp.unlock();
 
   return indexR;
 }
 
-int Faster::findIndexH(bool& needToComputeSafePath)
+int Faster::findIndexH(const MapSnapshot& map, bool& needToComputeSafePath)
 {
   int n = 1;  // find one neighbour
   std::vector<int> pointIdxNKNSearch(n);
@@ -223,17 +349,16 @@ int Faster::findIndexH(bool& needToComputeSafePath)
 
   needToComputeSafePath = false;
 
-  mtx_unk.lock();
   mtx_X_U_temp.lock();
-  int indexH = sg_whole_.X_temp_.size() - 1;
+  int indexH = sg_whole_->X_temp_.size() - 1;
 
-  for (int i = 0; i < sg_whole_.X_temp_.size(); i = i + 10)
+  for (int i = 0; i < sg_whole_->X_temp_.size(); i = i + 10)
   {  // Sample points along the trajectory
 
-    Eigen::Vector3d tmp = sg_whole_.X_temp_[i].pos;
+    Eigen::Vector3d tmp = sg_whole_->X_temp_[i].pos;
     pcl::PointXYZ searchPoint(tmp(0), tmp(1), tmp(2));
 
-    if (kdtree_unk_.nearestKSearch(searchPoint, n, pointIdxNKNSearch, pointNKNSquaredDistance) > 0)
+    if (map.kdtree_unk->nearestKSearch(searchPoint, n, pointIdxNKNSearch, pointNKNSquaredDistance) > 0)
     {
       if (sqrt(pointNKNSquaredDistance[0]) < par_.drone_radius)
       {
@@ -243,8 +368,7 @@ int Faster::findIndexH(bool& needToComputeSafePath)
       }
     }
   }
-  // std::cout << blue << "indexH=" << indexH << " /" << sg_whole_.X_temp_.size() - 1 << reset << std::endl;
-  mtx_unk.unlock();
+  // std::cout << blue << "indexH=" << indexH << " /" << sg_whole_->X_temp_.size() - 1 << reset << std::endl;
   mtx_X_U_temp.unlock();
 
   return indexH;
@@ -265,14 +389,39 @@ void Faster::updateState(state data)
   state_initialized_ = true;
 }
 
+bool Faster::replanNeeded()
+{
+  if (!last_replan_succeeded_ || goal_generation_ != goal_generation_replan_ || drone_status_ != drone_status_replan_)
+  {
+    return true;
+  }
+
+  if (map_generation_ != map_generation_replan_)
+  {
+    // A new map only needs a replan if it has new obstacles (or unknown space) in the corridor of the committed plan
+    uint64_t map_generation = map_generation_;
+    std::shared_ptr<const MapSnapshot> map = std::atomic_load(&map_snapshot_);
+    if (par_.revalidate_plan == false || par_.use_faster == false || map == nullptr || corridorIsFree(*map) == false)
+    {
+      return true;
+    }
+    map_generation_replan_ = map_generation;
+    map_validated_ = map;
+  }
+
+  // Nothing changed, but the drone is about to reach the end of the committed plan
+  bool horizon_low = (plan_.size() - deltaT_) * par_.dc < par_.replan_horizon_min;
+  return (drone_status_ == DroneStatus::TRAVELING && horizon_low);
+}
+
 bool Faster::initializedAllExceptPlanner()
 {
   if (!state_initialized_ || !kdtree_map_initialized_ || !kdtree_unk_initialized_ || !terminal_goal_initialized_)
   {
-    std::cout << "state_initialized_= " << state_initialized_ << std::endl;
-    std::cout << "kdtree_map_initialized_= " << kdtree_map_initialized_ << std::endl;
-    std::cout << "kdtree_unk_initialized_= " << kdtree_unk_initialized_ << std::endl;
-    std::cout << "terminal_goal_initialized_= " << terminal_goal_initialized_ << std::endl;
+    FASTER_DEBUG("state_initialized_= " << state_initialized_ << ", kdtree_map_initialized_= "
+                                        << kdtree_map_initialized_ << ", kdtree_unk_initialized_= "
+                                        << kdtree_unk_initialized_ << ", terminal_goal_initialized_= "
+                                        << terminal_goal_initialized_);
     return false;
   }
   return true;
@@ -283,28 +432,193 @@ bool Faster::initialized()
   if (!state_initialized_ || !kdtree_map_initialized_ || !kdtree_unk_initialized_ || !terminal_goal_initialized_ ||
       !planner_initialized_)
   {
-    std::cout << "state_initialized_= " << state_initialized_ << std::endl;
-    std::cout << "kdtree_map_initialized_= " << kdtree_map_initialized_ << std::endl;
-    std::cout << "kdtree_unk_initialized_= " << kdtree_unk_initialized_ << std::endl;
-    std::cout << "terminal_goal_initialized_= " << terminal_goal_initialized_ << std::endl;
-    std::cout << "planner_initialized_= " << planner_initialized_ << std::endl;
+    FASTER_DEBUG("state_initialized_= " << state_initialized_ << ", kdtree_map_initialized_= "
+                                        << kdtree_map_initialized_ << ", kdtree_unk_initialized_= "
+                                        << kdtree_unk_initialized_ << ", terminal_goal_initialized_= "
+                                        << terminal_goal_initialized_ << ", planner_initialized_= "
+                                        << planner_initialized_);
+    return false;
+  }
+  return true;
+}
+
+// JPS from A to G, part of it inside the sphere S (JPS_in) and convex decomposition around it (whole trajectory). It
+// only uses its arguments, jps_manager_ and par_, so it can run in another thread (see replan_pipeline)
+FrontEnd Faster::runFrontEnd(std::shared_ptr<const MapSnapshot> map, uint64_t goal_generation, state A, state G,
+                             double dist_to_goal, std::chrono::steady_clock::time_point deadline)
+{
+  FrontEnd front;
+  front.map = map;
+  front.goal_generation = goal_generation;
+  front.A = A;
+
+  //////////////////////////////////////////////////////////////////////////
+  ///////////////////////// Solve JPS //////////////////////////////////////
+  //////////////////////////////////////////////////////////////////////////
+
+  MyTimer timer_jps(true);
+  vec_Vecf<3> JPSk = jps_manager_.solveJPS3D(*map, A.pos, G.pos, &front.solved, 1, deadline);
+  front.jps_ms = timer_jps.ElapsedMs();
+
+  if (front.solved == false)
+  {
+    return front;
+  }
+  front.jps_length = normJPS(JPSk, 0);
+
+  //////////////////////////////////////////////////////////////////////////
+  ///////////////////////// Find JPS_in ////////////////////////////////////
+  //////////////////////////////////////////////////////////////////////////
+
+  double ra = std::min((dist_to_goal - 0.001), par_.Ra);  // radius of the sphere S
+  bool noPointsOutsideS;
+  int li1;  // last index inside the sphere of JPSk
+  front.E.pos = getFirstIntersectionWithSphere(JPSk, ra, JPSk[0], &li1, &noPointsOutsideS);
+  front.JPS_in = vec_Vecf<3>(JPSk.begin(), JPSk.begin() + li1 + 1);
+  if (noPointsOutsideS == false)
+  {
+    front.JPS_in.push_back(front.E.pos);
+  }
+  // createMoreVertexes in case dist between vertexes is too big
+  createMoreVertexes(front.JPS_in, par_.dist_max_vertexes);
+
+  //////////////////////////////////////////////////////////////////////////
+  ///////////////// Convex decomposition (whole trajectory) ////////////////
+  //////////////////////////////////////////////////////////////////////////
+
+  if (par_.use_faster == true)
+  {
+    front.JPS_whole = front.JPS_in;
+    if (par_.adaptive_size == true)
+    {
+      mergeStraightVertexes(front.JPS_whole, par_.adaptive_length_per_poly);
+    }
+    deleteVertexes(front.JPS_whole, par_.max_poly_whole);
+
+    // Convex Decomp around JPS_whole
+    MyTimer cvx_ellip_decomp_t(true);
+    jps_manager_.cvxEllipsoidDecomp(*map, front.JPS_whole, OCCUPIED_SPACE, front.l_constraints_whole,
+                                    front.poly_whole, deadline);
+    front.decomp_whole_ms = cvx_ellip_decomp_t.ElapsedMs();
+    front.E.pos = front.JPS_whole[front.JPS_whole.size() - 1];  // JPS_whole may have been truncated by the deadline
+  }
+
+  return front;
+}
+
+// The front end computed by the previous replan is used if it was computed with this map and goal, and this A is
+// inside its first polytope (JPS then starts at this A instead)
+bool Faster::canStitch(FrontEnd& front, const std::shared_ptr<const MapSnapshot>& map, const state& A)
+{
+  if (front.solved == false || front.map != map || front.goal_generation != goal_generation_replan_ ||
+      front.l_constraints_whole.size() == 0 || front.l_constraints_whole[0].inside(A.pos) == false)
+  {
     return false;
   }
+
+  front.A = A;
+  front.JPS_in[0] = A.pos;
+  front.JPS_whole[0] = A.pos;
   return true;
 }
 
+// Convex decomposition around JPS_safe (starting at R) and safe path from x0 (R, or stateA_ if !use_faster). It only
+// uses its arguments, jps_manager_ and par_, so the candidates R can be solved in parallel (each one with its own
+// solver)
+SafeCandidate Faster::solveSafe(TrajectorySolver& sg, const MapSnapshot& map, int k_safe, state x0, vec_Vecf<3> JPS_safe,
+                                state G, std::chrono::steady_clock::time_point deadline)
+{
+  SafeCandidate safe;
+  safe.k_safe = k_safe;
+
+  if (par_.use_faster == true)
+  {
+    JPS_safe[0] = x0.pos;  // R
+  }
+
+  // delete extra vertexes
+  if (par_.adaptive_size == true)
+  {
+    mergeStraightVertexes(JPS_safe, par_.adaptive_length_per_poly);
+  }
+  deleteVertexes(JPS_safe, par_.max_poly_safe);
+
+  // compute convex decomposition of JPS_safe
+  MyTimer cvx_safe_t(true);
+  jps_manager_.cvxEllipsoidDecomp(map, JPS_safe, UNKOWN_AND_OCCUPIED_SPACE, safe.l_constraints_safe, safe.poly_safe,
+                                  deadline);
+  safe.decomp_safe_ms = cvx_safe_t.ElapsedMs();
+  safe.M.pos = JPS_safe[JPS_safe.size() - 1];  // JPS_safe may have been truncated by the deadline
+  safe.JPS_safe = JPS_safe;
+
+  bool isGinside = safe.l_constraints_safe[safe.l_constraints_safe.size() - 1].inside(G.pos);
+  safe.M.pos = (isGinside == true) ? G.pos : safe.M.pos;
+
+  bool shouldForceFinalConstraint_for_Safe = (par_.use_faster == false) ? true : false;
+
+  if (safe.l_constraints_safe[0].inside(x0.pos) == false)
+  {
+    FASTER_WARN(red << "First point of safe traj is outside" << reset);
+  }
+
+  sg.setX0(x0);
+  sg.setXf(safe.M);  // only used to compute dt
+  sg.setPolytopes(safe.l_constraints_safe);
+  sg.setGuidePath(JPS_safe);
+  sg.setForceFinalConstraint(shouldForceFinalConstraint_for_Safe);
+  MyTimer safe_gurobi_t(true);
+  FASTER_DEBUG("Calling Gurobi");
+  safe.solved = sg.genNewTraj();
+  safe.gurobi_safe_ms = safe_gurobi_t.ElapsedMs();
+
+  return safe;
+}
+
 void Faster::replan(vec_Vecf<3>& JPS_safe_out, vec_Vecf<3>& JPS_whole_out, vec_E<Polyhedron<3>>& poly_safe_out,
                     vec_E<Polyhedron<3>>& poly_whole_out, std::vector<state>& X_safe_out,
                     std::vector<state>& X_whole_out)
+{
+  record_ = replan_record();
+  record_.stamp =
+      std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+  record_.outcome = replanStages(JPS_safe_out, JPS_whole_out, poly_safe_out, poly_whole_out, X_safe_out, X_whole_out);
+
+  record_.times = times_;
+  telemetry_.push(record_);
+}
+
+// The stages fill record_ as they run
+ReplanOutcome Faster::replanStages(vec_Vecf<3>& JPS_safe_out, vec_Vecf<3>& JPS_whole_out,
+                                   vec_E<Polyhedron<3>>& poly_safe_out, vec_E<Polyhedron<3>>& poly_whole_out,
+                                   std::vector<state>& X_safe_out, std::vector<state>& X_whole_out)
 {
   MyTimer replanCB_t(true);
+  times_ = replan_times();
+  last_replan_succeeded_ = false;
   if (initializedAllExceptPlanner() == false)
   {
-    return;
+    return REPLAN_NOT_INITIALIZED;
+  }
+
+  map_generation_replan_ = map_generation_;
+  goal_generation_replan_ = goal_generation_;
+  drone_status_replan_ = drone_status_;
+
+  // Map used during all this replan, even if a new one arrives in the meantime
+  std::shared_ptr<const MapSnapshot> map = std::atomic_load(&map_snapshot_);
+  if (map == nullptr || map->kdtree_map == nullptr || map->kdtree_unk == nullptr)
+  {
+    return REPLAN_NOT_INITIALIZED;  // resetInitialization() was called after the check above
   }
+  record_.n_points_map = map->pclptr_map->points.size();
+  record_.n_points_unk = map->pclptr_unk->points.size();
 
-  sg_whole_.ResetToNormalState();
-  sg_safe_.ResetToNormalState();
+  sg_whole_->ResetToNormalState();
+  for (TrajectorySolver* sg : safe_solvers_)
+  {
+    sg->ResetToNormalState();
+  }
 
   //////////////////////////////////////////////////////////////////////////
   ///////////////////////// G <-- Project GTerm ////////////////////////////
@@ -333,12 +647,12 @@ void Faster::replan(vec_Vecf<3>& JPS_safe_out, vec_Vecf<3>& JPS_whole_out, vec_E
   // Don't plan if drone is not traveling
   if (drone_status_ == DroneStatus::GOAL_REACHED || (drone_status_ == DroneStatus::YAWING))
   {
-    std::cout << "No replanning needed because" << std::endl;
-    print_status();
-    return;
+    FASTER_DEBUG("No replanning needed because " << bold << statusName(drone_status_) << reset);
+    last_replan_succeeded_ = true;  // Nothing to do until the status changes
+    return REPLAN_NOT_TRAVELING;
   }
 
-  std::cout << bold << on_red << "************IN REPLAN CB*********" << reset << std::endl;
+  FASTER_DEBUG(bold << on_red << "************IN REPLAN CB*********" << reset);
 
   //////////////////////////////////////////////////////////////////////////
   ///////////////////////// Select state A /////////////////////////////////
@@ -347,41 +661,73 @@ void Faster::replan(vec_Vecf<3>& JPS_safe_out, vec_Vecf<3>& JPS_whole_out, vec_E
   state A;
   int k_safe, k_end_whole;
 
-  // If k_end_whole=0, then A = plan_.back() = plan_[plan_.size() - 1]
-  k_end_whole = std::max((int)plan_.size() - deltaT_, 0);
-  A = plan_[plan_.size() - 1 - k_end_whole];
+  // If k_end_whole=0, then A = plan_.back(). If all the states have been published (the drone is holding the last one),
+  // k_end_whole=-1: the new trajectory starts at that state and is appended after it
+  k_end_whole = (plan_.size() > 0) ? std::max(plan_.size() - deltaT_, 0) : -1;
+  A = plan_.fromEnd(std::max(k_end_whole, 0));
+  record_.deltaT = k_end_whole;
+
+  // All the stages stop at the deadline. If the new trajectory is not ready by then, the committed plan is kept
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+  if (par_.replan_deadline > 0)
+  {
+    double time_available = par_.replan_deadline;
+    if (k_end_whole > 0)
+    {
+      time_available = std::min(time_available, (plan_.size() - k_end_whole - 1) * par_.dc);  // until A is published
+    }
+    deadline = std::chrono::steady_clock::now() +
+               std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                   std::chrono::duration<double>(std::max(time_available, 0.0) - replanCB_t.ElapsedMs() / 1000.0));
+  }
+  sg_whole_->setDeadline(deadline);
+  for (TrajectorySolver* sg : safe_solvers_)
+  {
+    sg->setDeadline(deadline);
+  }
 
   //////////////////////////////////////////////////////////////////////////
-  ///////////////////////// Solve JPS //////////////////////////////////////
+  ////////////////// Front end: JPS and cvx decomposition //////////////////
   //////////////////////////////////////////////////////////////////////////
 
-  bool solvedjps = false;
-  MyTimer timer_jps(true);
-
-  vec_Vecf<3> JPSk = jps_manager_.solveJPS3D(A.pos, G.pos, &solvedjps, 1);
-
-  if (solvedjps == false)
+  FrontEnd front;
+  bool stitched = false;
+  if (next_front_end_.valid())
   {
-    std::cout << bold << red << "JPS didn't find a solution" << std::endl;
-    return;
+    front = next_front_end_.get();  // Started by the previous replan, usually finished while its Gurobi was running
+    stitched = canStitch(front, map, A);
+  }
+  if (stitched == false)
+  {
+    front = runFrontEnd(map, goal_generation_replan_, A, G, dist_to_goal, deadline);
+    times_.jps = front.jps_ms;
+    times_.decomp_whole = front.decomp_whole_ms;
   }
+  record_.stitched = stitched;
+  record_.jps_length = front.jps_length;
 
-  //////////////////////////////////////////////////////////////////////////
-  ///////////////////////// Find JPS_in ////////////////////////////////////
-  //////////////////////////////////////////////////////////////////////////
+  if (par_.replan_pipeline == true && par_.use_faster == true)
+  {
+    // Front end of the next replan, on the newest map. It starts from this A: it will be used only if the next A falls
+    // inside its first polytope
+    std::chrono::steady_clock::time_point deadline_next = std::chrono::steady_clock::time_point::max();
+    if (par_.replan_deadline > 0)
+    {
+      deadline_next = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                             std::chrono::duration<double>(par_.replan_deadline));
+    }
+    next_front_end_ = std::async(std::launch::async, &Faster::runFrontEnd, this, std::atomic_load(&map_snapshot_),
+                                 goal_generation_replan_, A, G, dist_to_goal, deadline_next);
+  }
 
-  double ra = std::min((dist_to_goal - 0.001), par_.Ra);  // radius of the sphere S
-  bool noPointsOutsideS;
-  int li1;  // last index inside the sphere of JPSk
-  state E;
-  E.pos = getFirstIntersectionWithSphere(JPSk, ra, JPSk[0], &li1, &noPointsOutsideS);
-  vec_Vecf<3> JPS_in(JPSk.begin(), JPSk.begin() + li1 + 1);
-  if (noPointsOutsideS == false)
+  if (front.solved == false)
   {
-    JPS_in.push_back(E.pos);
+    FASTER_WARN(bold << red << "JPS didn't find a solution");
+    return REPLAN_JPS_FAILED;
   }
-  // createMoreVertexes in case dist between vertexes is too big
-  createMoreVertexes(JPS_in, par_.dist_max_vertexes);
+
+  vec_Vecf<3> JPS_in = front.JPS_in;
+  state E = front.E;
 
   //////////////////////////////////////////////////////////////////////////
   ///////////////// Solve with GUROBI Whole trajectory /////////////////////
@@ -389,13 +735,9 @@ void Faster::replan(vec_Vecf<3>& JPS_safe_out, vec_Vecf<3>& JPS_whole_out, vec_E
 
   if (par_.use_faster == true)
   {
-    vec_Vecf<3> JPS_whole = JPS_in;
-    deleteVertexes(JPS_whole, par_.max_poly_whole);
-    E.pos = JPS_whole[JPS_whole.size() - 1];
-
-    // Convex Decomp around JPS_whole
-    MyTimer cvx_ellip_decomp_t(true);
-    jps_manager_.cvxEllipsoidDecomp(JPS_whole, OCCUPIED_SPACE, l_constraints_whole_, poly_whole_out);
+    vec_Vecf<3> JPS_whole = front.JPS_whole;
+    l_constraints_whole_ = front.l_constraints_whole;
+    poly_whole_out = front.poly_whole;
     // std::cout << "poly_whole_out= " << poly_whole_out.size() << std::endl;
 
     // Check if G is inside poly_whole
@@ -403,9 +745,10 @@ void Faster::replan(vec_Vecf<3>& JPS_safe_out, vec_Vecf<3>& JPS_whole_out, vec_E
     E.pos = (isGinside_whole == true) ? G.pos : E.pos;
 
     // Set Initial cond, Final cond, and polytopes for the whole traj
-    sg_whole_.setX0(A);
-    sg_whole_.setXf(E);
-    sg_whole_.setPolytopes(l_constraints_whole_);
+    sg_whole_->setX0(A);
+    sg_whole_->setXf(E);
+    sg_whole_->setPolytopes(l_constraints_whole_);
+    sg_whole_->setGuidePath(JPS_whole);
 
     /*    std::cout << "Initial Position is inside= " << l_constraints_whole_[l_constraints_whole_.size() -
        1].inside(A.pos)
@@ -415,19 +758,33 @@ void Faster::replan(vec_Vecf<3>& JPS_safe_out, vec_Vecf<3>& JPS_whole_out, vec_E
     */
     // Solve with Gurobi
     MyTimer whole_gurobi_t(true);
-    bool solved_whole = sg_whole_.genNewTraj();
+    bool solved_whole = sg_whole_->genNewTraj();
+    times_.gurobi_whole = whole_gurobi_t.ElapsedMs();
+    times_.incumbent_whole = solved_whole ? sg_whole_->first_incumbent_ms_ : -1;
+    record_.trials_whole = sg_whole_->trials_;
+    record_.runtime_whole_ms = sg_whole_->runtime_ms_;
+    record_.nodes_whole = sg_whole_->node_count_;
+    record_.iterations_whole = sg_whole_->iterations_;
+    record_.numeric_whole = sg_whole_->numeric_issues_;
+    record_.n_intervals_whole = sg_whole_->intervals_;
+    record_.cache_hit_whole = sg_whole_->from_cache_;
+    record_.factor_whole = sg_whole_->factor_that_worked_;
+    record_.n_poly_whole = l_constraints_whole_.size();
+    record_.n_faces_whole = countFaces(l_constraints_whole_);
 
     if (solved_whole == false)
     {
-      std::cout << bold << red << "No solution found for the whole trajectory" << reset << std::endl;
-      return;
+      FASTER_WARN(bold << red << "No solution found for the whole trajectory" << reset);
+      return REPLAN_WHOLE_FAILED;
     }
 
     // Get Results
-    sg_whole_.fillX();
+    MyTimer fillX_whole_t(true);
+    sg_whole_->fillX();
+    times_.fillX = fillX_whole_t.ElapsedMs();
 
     // Copy for visualization
-    X_whole_out = sg_whole_.X_temp_;
+    X_whole_out = sg_whole_->X_temp_;
     JPS_whole_out = JPS_whole;
   }
   else
@@ -435,11 +792,11 @@ void Faster::replan(vec_Vecf<3>& JPS_safe_out, vec_Vecf<3>& JPS_whole_out, vec_E
     state dummy;
     std::vector<state> dummy_vector;
     dummy_vector.push_back(dummy);
-    sg_whole_.X_temp_ = dummy_vector;
+    sg_whole_->X_temp_ = dummy_vector;
   }
 
   /*  std::cout << "This is the WHOLE TRAJECTORY" << std::endl;
-    printStateVector(sg_whole_.X_temp_);
+    printStateVector(sg_whole_->X_temp_);
     std::cout << "===========================" << std::endl;*/
 
   //////////////////////////////////////////////////////////////////////////
@@ -449,30 +806,42 @@ void Faster::replan(vec_Vecf<3>& JPS_safe_out, vec_Vecf<3>& JPS_whole_out, vec_E
   vec_Vecf<3> JPSk_inside_sphere_tmp = JPS_in;
   bool thereIsIntersection2;
   // state M;
-  M_.pos = getFirstCollisionJPS(JPSk_inside_sphere_tmp, &thereIsIntersection2, UNKNOWN_MAP,
+  M_.pos = getFirstCollisionJPS(*map, JPSk_inside_sphere_tmp, &thereIsIntersection2, UNKNOWN_MAP,
                                 RETURN_INTERSECTION);  // results saved in JPSk_inside_sphere_tmp
 
   bool needToComputeSafePath;
-  int indexH = findIndexH(needToComputeSafePath);
+  int indexH = findIndexH(*map, needToComputeSafePath);
 
-  std::cout << "NeedToComputeSafePath=" << needToComputeSafePath << std::endl;
+  FASTER_DEBUG("NeedToComputeSafePath=" << needToComputeSafePath);
 
   if (par_.use_faster == false)
   {
     needToComputeSafePath = true;
   }
 
+  TrajectorySolver* sg_safe_chosen = sg_safe_.get();  // Solver of the safe path used
+
   if (needToComputeSafePath == false)
   {
     k_safe = indexH;
-    sg_safe_.X_temp_ = std::vector<state>();  // 0 elements
+    sg_safe_->X_temp_ = std::vector<state>();  // 0 elements
   }
   else
   {
     mtx_X_U_temp.lock();
 
-    k_safe = findIndexR(indexH);
-    state R = sg_whole_.X_temp_[k_safe];
+    // Candidates for R: the one of findIndexR and earlier ones, every safe_candidates_dt
+    std::vector<int> k_candidates = { findIndexR(indexH) };
+    int k_step = std::max((int)round(par_.safe_candidates_dt / par_.dc), 1);
+    while (k_candidates.size() < safe_solvers_.size() && k_candidates.back() - k_step >= 0)
+    {
+      k_candidates.push_back(k_candidates.back() - k_step);
+    }
+    std::vector<state> R_candidates;
+    for (int k : k_candidates)
+    {
+      R_candidates.push_back(sg_whole_->X_temp_[k]);
+    }
 
     mtx_X_U_temp.unlock();
 
@@ -482,72 +851,95 @@ void Faster::replan(vec_Vecf<3>& JPS_safe_out, vec_Vecf<3>& JPS_whole_out, vec_E
           return;
         }*/
 
-    JPSk_inside_sphere_tmp[0] = R.pos;
-
     if (par_.use_faster == false)
     {
       JPSk_inside_sphere_tmp[0] = A.pos;
     }
 
-    vec_Vecf<3> JPS_safe = JPSk_inside_sphere_tmp;
-
-    // delete extra vertexes
-    deleteVertexes(JPS_safe, par_.max_poly_safe);
-    M_.pos = JPS_safe[JPS_safe.size() - 1];
-
-    // compute convex decomposition of JPS_safe
-    jps_manager_.cvxEllipsoidDecomp(JPS_safe, UNKOWN_AND_OCCUPIED_SPACE, l_constraints_safe_, poly_safe_out);
-
-    JPS_safe_out = JPS_safe;
-
-    bool isGinside = l_constraints_safe_[l_constraints_safe_.size() - 1].inside(G.pos);
-    M_.pos = (isGinside == true) ? G.pos : M_.pos;
-
-    state x0_safe;
-    x0_safe = R;
-
-    if (par_.use_faster == false)
+    // The candidates (except the first one, solved in this thread) are solved in parallel, each one on its own solver
+    std::vector<std::future<SafeCandidate>> futures;
+    for (int i = 1; i < k_candidates.size(); i++)
     {
-      x0_safe = stateA_;
+      futures.push_back(std::async(std::launch::async, &Faster::solveSafe, this, std::ref(*safe_solvers_[i]),
+                                   std::cref(*map), k_candidates[i], R_candidates[i], JPSk_inside_sphere_tmp, G,
+                                   deadline));
     }
+    state x0_safe = (par_.use_faster == false) ? stateA_ : R_candidates[0];
+    SafeCandidate safe = solveSafe(*sg_safe_, *map, k_candidates[0], x0_safe, JPSk_inside_sphere_tmp, G, deadline);
 
-    bool shouldForceFinalConstraint_for_Safe = (par_.use_faster == false) ? true : false;
-
-    if (l_constraints_safe_[0].inside(x0_safe.pos) == false)
+    // The latest R with a feasible safe path is used, the solvers of the earlier ones are stopped
+    int chosen = safe.solved ? 0 : -1;
+    for (int i = 1; i < k_candidates.size(); i++)
     {
-      std::cout << red << "First point of safe traj is outside" << reset << std::endl;
+      if (chosen >= 0)
+      {
+        safe_solvers_[i]->StopExecution();
+        futures[i - 1].wait();
+      }
+      else
+      {
+        safe = futures[i - 1].get();
+        chosen = safe.solved ? i : -1;
+      }
     }
 
-    sg_safe_.setX0(x0_safe);
-    sg_safe_.setXf(M_);  // only used to compute dt
-    sg_safe_.setPolytopes(l_constraints_safe_);
-    sg_safe_.setForceFinalConstraint(shouldForceFinalConstraint_for_Safe);
-    MyTimer safe_gurobi_t(true);
-    std::cout << "Calling Gurobi" << std::endl;
-    bool solved_safe = sg_safe_.genNewTraj();
-
-    if (solved_safe == false)
+    k_safe = safe.k_safe;
+    M_ = safe.M;
+    l_constraints_safe_ = safe.l_constraints_safe;
+    poly_safe_out = safe.poly_safe;
+    JPS_safe_out = safe.JPS_safe;
+    times_.decomp_safe = safe.decomp_safe_ms;
+    times_.gurobi_safe = safe.gurobi_safe_ms;
+    TrajectorySolver* sg_last = safe_solvers_[(chosen >= 0) ? chosen : (int)k_candidates.size() - 1];  // Last one waited for
+    record_.safe_candidate = chosen;
+    times_.incumbent_safe = (chosen >= 0) ? sg_last->first_incumbent_ms_ : -1;
+    record_.trials_safe = sg_last->trials_;
+    record_.runtime_safe_ms = sg_last->runtime_ms_;
+    record_.nodes_safe = sg_last->node_count_;
+    record_.iterations_safe = sg_last->iterations_;
+    record_.numeric_safe = sg_last->numeric_issues_;
+    record_.n_intervals_safe = sg_last->intervals_;
+    record_.cache_hit_safe = sg_last->from_cache_;
+    record_.factor_safe = sg_last->factor_that_worked_;
+    record_.n_poly_safe = l_constraints_safe_.size();
+    record_.n_faces_safe = countFaces(l_constraints_safe_);
+
+    if (chosen < 0)
     {
-      std::cout << red << "No solution found for the safe path" << reset << std::endl;
-      return;
+      FASTER_WARN(red << "No solution found for the safe path" << reset);
+      return REPLAN_SAFE_FAILED;
+    }
+    if (chosen > 0)
+    {
+      FASTER_DEBUG("Safe path found from the candidate R number " << chosen);
     }
 
     // Get the solution
-    sg_safe_.fillX();
-    X_safe_out = sg_safe_.X_temp_;
+    sg_safe_chosen = safe_solvers_[chosen];
+    MyTimer fillX_safe_t(true);
+    sg_safe_chosen->fillX();
+    times_.fillX = std::max(times_.fillX, 0.0) + fillX_safe_t.ElapsedMs();
+    X_safe_out = sg_safe_chosen->X_temp_;
   }
 
   /*  std::cout << "This is the SAFE TRAJECTORY" << std::endl;
-    printStateVector(sg_safe_.X_temp_);
+    printStateVector(sg_safe_->X_temp_);
     std::cout << "===========================" << std::endl;*/
 
   ///////////////////////////////////////////////////////////
   ///////////////       Append RESULTS    ////////////////////
   ///////////////////////////////////////////////////////////
 
-  if (appendToPlan(k_end_whole, sg_whole_.X_temp_, k_safe, sg_safe_.X_temp_) != true)
+  MyTimer append_t(true);
+  bool appended = appendToPlan(k_end_whole, sg_whole_->X_temp_, k_safe, sg_safe_chosen->X_temp_);
+  times_.append = append_t.ElapsedMs();
+
+  // Number of states that would have been needed for this replan (also when A had already been published)
+  updateDeltaT(ceil(replanCB_t.ElapsedMs() / (par_.dc * 1000)));
+
+  if (appended != true)
   {
-    return;
+    return REPLAN_A_PUBLISHED;
   }
 
   /*  mtx_plan_.lock();
@@ -571,80 +963,169 @@ void Faster::replan(vec_Vecf<3>& JPS_safe_out, vec_Vecf<3>& JPS_whole_out, vec_E
     changeDroneStatus(DroneStatus::GOAL_SEEN);
   }
 
-  mtx_offsets.lock();
-
-  int states_last_replan = ceil(replanCB_t.ElapsedMs() / (par_.dc * 1000));  // Number of states that
-                                                                             // would have been needed for
-                                                                             // the last replan
-  mtx_offsets.unlock();
-
   // Time allocation
-  double new_init_whole = std::max(sg_whole_.factor_that_worked_ - par_.gamma_whole, 1.0);
-  double new_final_whole = sg_whole_.factor_that_worked_ + par_.gammap_whole;
-  sg_whole_.setFactorInitialAndFinalAndIncrement(new_init_whole, new_final_whole, par_.increment_whole);
+  double new_init_whole = std::max(sg_whole_->factor_that_worked_ - par_.gamma_whole, 1.0);
+  double new_final_whole = sg_whole_->factor_that_worked_ + par_.gammap_whole;
+  sg_whole_->setFactorInitialAndFinalAndIncrement(new_init_whole, new_final_whole, par_.increment_whole);
 
-  double new_init_safe = std::max(sg_safe_.factor_that_worked_ - par_.gamma_safe, 1.0);
-  double new_final_safe = sg_safe_.factor_that_worked_ + par_.gammap_safe;
-  sg_safe_.setFactorInitialAndFinalAndIncrement(new_init_safe, new_final_safe, par_.increment_safe);
+  double new_init_safe = std::max(sg_safe_chosen->factor_that_worked_ - par_.gamma_safe, 1.0);
+  double new_final_safe = sg_safe_chosen->factor_that_worked_ + par_.gammap_safe;
+  for (TrajectorySolver* sg : safe_solvers_)
+  {
+    sg->setFactorInitialAndFinalAndIncrement(new_init_safe, new_final_safe, par_.increment_safe);
+  }
 
   planner_initialized_ = true;
+  last_replan_succeeded_ = true;
+  map_validated_ = map;  // The new part of the corridor is free in this map
 
-  std::cout << bold << blue << "Replanning took " << replanCB_t.ElapsedMs() << " ms" << reset << std::endl;
+  times_.total = replanCB_t.ElapsedMs();
+  FASTER_INFO(bold << blue << "Replanning took " << times_.total << " ms" << reset);
 
-  return;
+  return REPLAN_OK;
 }
 
 void Faster::resetInitialization()
 {
   planner_initialized_ = false;
   state_initialized_ = false;
+  std::atomic_store(&map_snapshot_, std::shared_ptr<const MapSnapshot>());
   kdtree_map_initialized_ = false;
   kdtree_unk_initialized_ = false;
   terminal_goal_initialized_ = false;
+  last_replan_succeeded_ = false;
 }
 
 bool Faster::appendToPlan(int k_end_whole, const std::vector<state>& whole, int k_safe, const std::vector<state>& safe)
 {
-  mtx_plan_.lock();
+  std::vector<state> states(whole.begin(), whole.begin() + k_safe + 1);
+  states.insert(states.end(), safe.begin(), safe.end());
 
-  bool output;
-  int plan_size = plan_.size();
-  /*  std::cout << "plan_.size()= " << plan_.size() << std::endl;
-    std::cout << "plan_size - k_end_whole = " << plan_size - k_end_whole << std::endl;*/
-  if ((plan_size - 1 - k_end_whole) < 0)
+  // Replaces the states from A (the (k_end_whole+1)-th state counting from the end) onwards
+  int64_t a = plan_.endIndex() - 1 - k_end_whole;
+  if (plan_.commit(k_end_whole, states) == false)
   {
-    std::cout << bold << red << "Already publised the point A" << reset << std::endl;
-    output = false;
+    FASTER_WARN(bold << red << "Already publised the point A" << reset);
+    return false;
   }
-  else
+
+  if (par_.revalidate_plan == true)
+  {
+    updateCorridor(a, k_safe, states.size());
+  }
+  return true;
+}
+
+// The states [a, a+n_states-1] of plan_ are new: [a, a+k_safe] are inside the polytopes of the whole trajectory, and
+// the rest inside the ones of the safe path
+void Faster::updateCorridor(int64_t a, int k_safe, int n_states)
+{
+  for (auto it = corridor_.begin(); it != corridor_.end();)
+  {
+    if (it->first >= a)
+    {
+      it = corridor_.erase(it);  // Replaced
+    }
+    else
+    {
+      it->last = std::min(it->last, a - 1);
+      ++it;
+    }
+  }
+
+  corridor_.push_back({ a, a + k_safe, l_constraints_whole_ });
+  if (n_states > k_safe + 1)
   {
-    /*    std::cout << "(plan_.size() - k_end_whole)= " << (plan_.size() - k_end_whole) << std::endl;
-        std::cout << "plan_.size()= " << plan_.size() << std::endl;
-        std::cout << "k_end_whole)= " << k_end_whole << std::endl;*/
+    corridor_.push_back({ a + k_safe + 1, a + n_states - 1, l_constraints_safe_ });
+  }
+}
+
+// Checks the occupied and unknown points that are not in map_validated_ against the polytopes of the states not
+// published yet. A point collides if it is closer than drone_radius to a polytope
+bool Faster::corridorIsFree(const MapSnapshot& map)
+{
+  if (map_validated_ == nullptr || map_validated_->keys_map == nullptr || map_validated_->keys_unk == nullptr ||
+      map.pclptr_unk == nullptr)
+  {
+    return false;
+  }
 
-    plan_.erase(plan_.end() - k_end_whole - 1, plan_.end());
+  int64_t front = plan_.frontIndex();
+  corridor_.erase(std::remove_if(corridor_.begin(), corridor_.end(),
+                                 [front](const CorridorPiece& piece) { return piece.last < front; }),
+                  corridor_.end());
 
-    /*    std::cout << "Erased" << std::endl;
-        std::cout << "k_safe = " << k_safe << std::endl;
-        std::cout << "whole.size() = " << whole.size() << std::endl;*/
-    for (int i = 0; i <= k_safe; i++)
+  auto collides = [this](const Eigen::Vector3d& p) {
+    for (auto& piece : corridor_)
     {
-      plan_.push_back(whole[i]);
+      for (auto& poly : piece.polytopes)
+      {
+        Eigen::VectorXd d = poly.A_ * p - poly.b_;
+        bool inside = true;
+        for (int i = 0; i < d.rows() && inside; i++)
+        {
+          inside = (d(i) <= par_.drone_radius * poly.A_.row(i).norm());
+        }
+        if (inside)
+        {
+          return true;
+        }
+      }
     }
+    return false;
+  };
 
-    /*    std::cout << "k_safe = " << k_safe << std::endl;
-        std::cout << "whole.size() = " << whole.size() << std::endl;*/
-    for (int i = 0; i < safe.size(); i++)
+  for (const auto& p : map.vec_o)
+  {
+    if (map_validated_->keys_map->count(voxelKey(p, par_.res)) == 0 && collides(p))
+    {
+      FASTER_INFO("New obstacle in the corridor of the committed plan");
+      return false;
+    }
+  }
+  for (const auto& pcl_p : map.pclptr_unk->points)
+  {
+    Eigen::Vector3d p(pcl_p.x, pcl_p.y, pcl_p.z);
+    if (map_validated_->keys_unk->count(voxelKey(p, par_.res)) == 0 && collides(p))
     {
-      plan_.push_back(safe[i]);
+      FASTER_INFO("New unknown space in the corridor of the committed plan");
+      return false;
     }
-    // std::cout << "Pushed everything back" << std::endl;
+  }
+  return true;
+}
+
+// Faces of all the polytopes (for the replan record)
+int Faster::countFaces(const std::vector<LinearConstraint3D>& constraints)
+{
+  int n_faces = 0;
+  for (const LinearConstraint3D& constraint : constraints)
+  {
+    n_faces += constraint.A_.rows();
+  }
+  return n_faces;
+}
+
+// deltaT_ is the given percentile of the states published during the last replans, so that (almost always) A has not
+// been published yet when the new trajectory is committed
+void Faster::updateDeltaT(int states_last_replan)
+{
+  mtx_offsets.lock();
 
-    output = true;
+  states_replans_.push_back(states_last_replan);
+  while (states_replans_.size() > (size_t)std::max(par_.replan_latency_window, 1))
+  {
+    states_replans_.pop_front();
   }
 
-  mtx_plan_.unlock();
-  return output;
+  std::vector<int> sorted(states_replans_.begin(), states_replans_.end());
+  int rank = std::ceil(par_.replan_latency_percentile / 100.0 * sorted.size()) - 1;
+  rank = std::min(std::max(rank, 0), (int)sorted.size() - 1);
+  std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+
+  deltaT_ = std::max(sorted[rank], deltaT_min_);
+
+  mtx_offsets.unlock();
 }
 
 void Faster::yaw(double diff, state& next_goal)
@@ -700,29 +1181,29 @@ bool Faster::getNextGoal(state& next_goal)
 {
   if (initializedAllExceptPlanner() == false)
   {
-    std::cout << "Not publishing new goal!!" << std::endl;
+    FASTER_WARN("Not publishing new goal!!");
     return false;
   }
 
-  mtx_goals.lock();
-  mtx_plan_.lock();
-
+  // No locks here: a replan committing a new trajectory doesn't delay the setpoint
   next_goal.setZero();
-  next_goal = plan_.front();
-  if (plan_.size() > 1)
+  CommittedPlan::Read read = plan_.next(next_goal);
+  if (read == CommittedPlan::EMPTY)
   {
-    plan_.pop_front();
+    return false;
+  }
+  if (read == CommittedPlan::COMMITTING)
+  {
+    FASTER_DEBUG("Setpoint held: a commit is replacing the next state");
   }
   getDesiredYaw(next_goal);
 
   previous_yaw_ = next_goal.yaw;
 
-  mtx_goals.unlock();
-  mtx_plan_.unlock();
   return true;
 }
 
-bool Faster::ARisInFreeSpace(int index)
+bool Faster::ARisInFreeSpace(const MapSnapshot& map, int index)
 {  // We have to check only against the unkown space (A-R won't intersect the obstacles for sure)
 
   // std::cout << "In ARisInFreeSpace, radius_drone= " << par_.drone_radius << std::endl;
@@ -733,29 +1214,25 @@ bool Faster::ARisInFreeSpace(int index)
 
   bool isFree = true;
 
-  // std::cout << "Before mtx_unk" << std::endl;
-  mtx_unk.lock();
   mtx_X_U_temp.lock();
-  // std::cout << "After mtx_unk. index=" << index << std::endl;
   for (int i = 0; i < index; i = i + 10)
   {  // Sample points along the trajectory
      // std::cout << "i=" << i << std::endl;
-    Eigen::Vector3d tmp = sg_whole_.X_temp_[i].pos;
+    Eigen::Vector3d tmp = sg_whole_->X_temp_[i].pos;
     pcl::PointXYZ searchPoint(tmp(0), tmp(1), tmp(2));
 
-    if (kdtree_unk_.nearestKSearch(searchPoint, n, pointIdxNKNSearch, pointNKNSquaredDistance) > 0)
+    if (map.kdtree_unk->nearestKSearch(searchPoint, n, pointIdxNKNSearch, pointNKNSquaredDistance) > 0)
     {
       if (sqrt(pointNKNSquaredDistance[0]) < 0.2)
       {  // TODO: 0.2 is the radius of the drone.
-        std::cout << "A->R collides, with d=" << sqrt(pointNKNSquaredDistance[0])
-                  << ", radius_drone=" << par_.drone_radius << std::endl;
+        FASTER_DEBUG("A->R collides, with d=" << sqrt(pointNKNSquaredDistance[0])
+                                              << ", radius_drone=" << par_.drone_radius);
         isFree = false;
         break;
       }
     }
   }
 
-  mtx_unk.unlock();
   mtx_X_U_temp.unlock();
 
   return isFree;
@@ -764,7 +1241,8 @@ bool Faster::ARisInFreeSpace(int index)
 // Returns the first collision of JPS with the map (i.e. with the known obstacles). Note that JPS will collide with a
 // map B if JPS was computed using an older map A
 // If type_return==Intersection, it returns the last point in the JPS path that is at least par_.inflation_jps from map
-Eigen::Vector3d Faster::getFirstCollisionJPS(vec_Vecf<3>& path, bool* thereIsIntersection, int map, int type_return)
+Eigen::Vector3d Faster::getFirstCollisionJPS(const MapSnapshot& map, vec_Vecf<3>& path, bool* thereIsIntersection,
+                                             int map_type, int type_return)
 {
   vec_Vecf<3> original = path;
 
@@ -783,9 +1261,6 @@ Eigen::Vector3d Faster::getFirstCollisionJPS(vec_Vecf<3>& path, bool* thereIsInt
   // printElementsOfJPS(path);
   // printf("In 2\n");
 
-  mtx_map.lock();
-  mtx_unk.lock();
-
   // Find the next eig_search_point
   int last_id = -1;  // this is the last index inside the sphere
   int iteration = 0;
@@ -797,13 +1272,13 @@ Eigen::Vector3d Faster::getFirstCollisionJPS(vec_Vecf<3>& path, bool* thereIsInt
 
     int number_of_neigh;
 
-    if (map == MAP)
+    if (map_type == MAP)
     {
-      number_of_neigh = kdtree_map_.nearestKSearch(pcl_search_point, n, id_map, dist2_map);
+      number_of_neigh = map.kdtree_map->nearestKSearch(pcl_search_point, n, id_map, dist2_map);
     }
-    else  // map == UNKNOWN_MAP
+    else  // map_type == UNKNOWN_MAP
     {
-      number_of_neigh = kdtree_unk_.nearestKSearch(pcl_search_point, n, id_map, dist2_map);
+      number_of_neigh = map.kdtree_unk->nearestKSearch(pcl_search_point, n, id_map, dist2_map);
       // std::cout << "In unknown_map, number of neig=" << number_of_neigh << std::endl;
     }
     // printf("************NearestSearch: TotalTime= %0.2f ms\n", 1000 * (ros::Time::now().toSec() - before));
@@ -906,7 +1381,7 @@ Eigen::Vector3d Faster::getFirstCollisionJPS(vec_Vecf<3>& path, bool* thereIsInt
     else
     {  // There is no neighbours
       *thereIsIntersection = false;
-      ROS_INFO("JPS provided doesn't intersect any obstacles, returning the first element of the path you gave me\n");
+      FASTER_DEBUG("JPS provided doesn't intersect any obstacles, returning the first element of the path you gave me");
       result = first_element;
 
       if (type_return == RETURN_INTERSECTION)
@@ -919,8 +1394,6 @@ Eigen::Vector3d Faster::getFirstCollisionJPS(vec_Vecf<3>& path, bool* thereIsInt
     }
     iteration = iteration + 1;
   }
-  mtx_map.unlock();
-  mtx_unk.unlock();
 
   return result;
 }
@@ -933,60 +1406,29 @@ void Faster::changeDroneStatus(int new_status)
     return;
   }
 
-  std::cout << "Changing DroneStatus from ";
-  switch (drone_status_)
-  {
-    case DroneStatus::YAWING:
-      std::cout << bold << "status_=YAWING" << reset;
-      break;
-    case DroneStatus::TRAVELING:
-      std::cout << bold << "status_=TRAVELING" << reset;
-      break;
-    case DroneStatus::GOAL_SEEN:
-      std::cout << bold << "status_=GOAL_SEEN" << reset;
-      break;
-    case DroneStatus::GOAL_REACHED:
-      std::cout << bold << "status_=GOAL_REACHED" << reset;
-      break;
-  }
-  std::cout << " to ";
-
-  switch (new_status)
-  {
-    case DroneStatus::YAWING:
-      std::cout << bold << "status_=YAWING" << reset;
-      break;
-    case DroneStatus::TRAVELING:
-      std::cout << bold << "status_=TRAVELING" << reset;
-      break;
-    case DroneStatus::GOAL_SEEN:
-      std::cout << bold << "status_=GOAL_SEEN" << reset;
-      break;
-    case DroneStatus::GOAL_REACHED:
-      std::cout << bold << "status_=GOAL_REACHED" << reset;
-      break;
-  }
-
-  std::cout << std::endl;
+  FASTER_INFO("Changing DroneStatus from " << bold << statusName(drone_status_) << reset << " to " << bold
+                                           << statusName(new_status) << reset);
 
   drone_status_ = new_status;
 }
 
 void Faster::print_status()
 {
-  switch (drone_status_)
+  FASTER_INFO(bold << statusName(drone_status_) << reset);
+}
+
+const char* Faster::statusName(int status)
+{
+  switch (status)
   {
     case DroneStatus::YAWING:
-      std::cout << bold << "status_=YAWING" << reset << std::endl;
-      break;
+      return "status_=YAWING";
     case DroneStatus::TRAVELING:
-      std::cout << bold << "status_=TRAVELING" << reset << std::endl;
-      break;
+      return "status_=TRAVELING";
     case DroneStatus::GOAL_SEEN:
-      std::cout << bold << "status_=GOAL_SEEN" << reset << std::endl;
-      break;
+      return "status_=GOAL_SEEN";
     case DroneStatus::GOAL_REACHED:
-      std::cout << bold << "status_=GOAL_REACHED" << reset << std::endl;
-      break;
+      return "status_=GOAL_REACHED";
   }
+  return "status_=UNKNOWN";
 }
\ No newline at end of file
@@ -0,0 +1,553 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2020, Jesus Tordesillas Torres, Aerospace Controls Laboratory
+ * Massachusetts Institute of Technology
+ * All Rights Reserved
+ * Authors: Jesus Tordesillas, et al.
+ * See LICENSE file for the license information
+ * -------------------------------------------------------------------------- */
+
+// Headless benchmark of Faster::replan(). It replays a recorded sequence of maps, states and goals (no ROS needed)
+// and reports the latency percentiles of every stage of the replanning. See the Readme for the format of the sequence.
+//
+// Usage: faster_bench <faster.yaml> <sequence.txt> [repetitions] [--publisher]
+//                    [--warm-start-ab | --monotone-ab | --lazy-ab | --adaptive-ab | --cache-ab | --formulation-ab]
+//
+// With --publisher, getNextGoal() is called from its own thread at 1/dc Hz (as pubCB does), every "step n" lasts n*dc
+// seconds during which replanCB is emulated (replan every dc seconds if replanNeeded()), and the latency of
+// getNextGoal() is reported too.
+//
+// With --warm-start-ab (--monotone-ab, --lazy-ab, --adaptive-ab, --cache-ab), the sequence is run with warm_start
+// (monotone_binaries, lazy_faces, adaptive_size, solution_cache) false and then true, and the tables of both are
+// printed (compare the incumbent_*, gurobi_*, nodes_* and N_* rows). With --formulation-ab, it's run with each
+// gurobi_formulation ("coefficients", "bezier", "minvo" and "normalized").
+
+#include "faster.hpp"
+
+#include <pcl/io/pcd_io.h>
+#include <yaml-cpp/yaml.h>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <map>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+
+struct BenchEvent
+{
+  enum Type
+  {
+    UPDATE_MAP,
+    UPDATE_STATE,
+    SET_GOAL,
+    STEP,
+    REPLAN
+  };
+
+  Type type;
+  state data;  // UPDATE_STATE and SET_GOAL
+  int steps = 0;
+  pcl::PointCloud<pcl::PointXYZ>::Ptr pclptr_map;
+  pcl::PointCloud<pcl::PointXYZ>::Ptr pclptr_unk;
+};
+
+template <typename T>
+void getParam(const YAML::Node& node, const std::string& name, T& value)
+{
+  if (!node[name])
+  {
+    std::cout << bold << red << "Failed to find parameter: " << name << reset << std::endl;
+    exit(1);
+  }
+  value = node[name].as<T>();
+}
+
+// Same parameters FasterRos reads from the parameter server. The ones of the mapper are set from the sequence file
+parameters loadParameters(const std::string& file)
+{
+  YAML::Node node = YAML::LoadFile(file);
+  parameters par;
+
+  getParam(node, "use_ff", par.use_ff);
+  getParam(node, "visual", par.visual);
+
+  getParam(node, "dc", par.dc);
+  getParam(node, "goal_radius", par.goal_radius);
+  getParam(node, "drone_radius", par.drone_radius);
+  getParam(node, "force_goal_height", par.force_goal_height);
+  getParam(node, "goal_height", par.goal_height);
+
+  getParam(node, "N_safe", par.N_safe);
+  getParam(node, "N_whole", par.N_whole);
+
+  getParam(node, "Ra", par.Ra);
+  getParam(node, "w_max", par.w_max);
+  getParam(node, "alpha_filter_dyaw", par.alpha_filter_dyaw);
+
+  getParam(node, "z_ground", par.z_ground);
+  getParam(node, "z_max", par.z_max);
+  getParam(node, "inflation_jps", par.inflation_jps);
+  getParam(node, "factor_jps", par.factor_jps);
+
+  getParam(node, "v_max", par.v_max);
+  getParam(node, "a_max", par.a_max);
+  getParam(node, "j_max", par.j_max);
+
+  getParam(node, "gamma_whole", par.gamma_whole);
+  getParam(node, "gammap_whole", par.gammap_whole);
+  getParam(node, "increment_whole", par.increment_whole);
+  getParam(node, "gamma_safe", par.gamma_safe);
+  getParam(node, "gammap_safe", par.gammap_safe);
+  getParam(node, "increment_safe", par.increment_safe);
+
+  getParam(node, "delta_a", par.delta_a);
+  getParam(node, "delta_H", par.delta_H);
+
+  getParam(node, "max_poly_whole", par.max_poly_whole);
+  getParam(node, "max_poly_safe", par.max_poly_safe);
+  getParam(node, "dist_max_vertexes", par.dist_max_vertexes);
+
+  getParam(node, "adaptive_size", par.adaptive_size);
+  getParam(node, "adaptive_N_min", par.adaptive_N_min);
+  getParam(node, "adaptive_length_per_interval", par.adaptive_length_per_interval);
+  getParam(node, "adaptive_length_per_poly", par.adaptive_length_per_poly);
+
+  getParam(node, "solution_cache", par.solution_cache);
+  getParam(node, "solution_cache_size", par.solution_cache_size);
+  getParam(node, "solution_cache_resolution", par.solution_cache_resolution);
+
+  getParam(node, "gurobi_threads", par.gurobi_threads);
+  getParam(node, "parallel_factors", par.parallel_factors);
+  getParam(node, "factor_bisection", par.factor_bisection);
+  getParam(node, "warm_start", par.warm_start);
+  getParam(node, "monotone_qp", par.monotone_qp);
+  getParam(node, "monotone_binaries", par.monotone_binaries);
+  getParam(node, "lazy_faces", par.lazy_faces);
+  getParam(node, "lazy_faces_margin", par.lazy_faces_margin);
+  getParam(node, "gurobi_formulation", par.gurobi_formulation);
+  getParam(node, "solver_backend", par.solver_backend);
+  getParam(node, "gurobi_verbose", par.gurobi_verbose);
+
+  getParam(node, "use_faster", par.use_faster);
+
+  getParam(node, "replan_horizon_min", par.replan_horizon_min);
+  getParam(node, "replan_latency_window", par.replan_latency_window);
+  getParam(node, "replan_latency_percentile", par.replan_latency_percentile);
+  getParam(node, "replan_deadline", par.replan_deadline);
+  getParam(node, "replan_pipeline", par.replan_pipeline);
+
+  getParam(node, "revalidate_plan", par.revalidate_plan);
+
+  getParam(node, "safe_candidates", par.safe_candidates);
+  getParam(node, "safe_candidates_dt", par.safe_candidates_dt);
+
+  getParam(node, "telemetry_file", par.telemetry_file);
+
+  getParam(node, "is_ground_robot", par.is_ground_robot);
+
+  return par;
+}
+
+pcl::PointCloud<pcl::PointXYZ>::Ptr loadCloud(const std::string& file,
+                                              std::map<std::string, pcl::PointCloud<pcl::PointXYZ>::Ptr>& cache)
+{
+  auto it = cache.find(file);
+  if (it != cache.end())
+  {
+    return it->second;
+  }
+  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>);
+  if (pcl::io::loadPCDFile<pcl::PointXYZ>(file, *cloud) == -1)
+  {
+    std::cout << bold << red << "Couldn't read " << file << reset << std::endl;
+    exit(1);
+  }
+  cache[file] = cloud;
+  return cloud;
+}
+
+// Reads the sequence file. The point clouds are loaded here, so that the disk is not touched while replaying it
+std::vector<BenchEvent> loadSequence(const std::string& file, parameters& par)
+{
+  std::ifstream in(file);
+  if (!in.is_open())
+  {
+    std::cout << bold << red << "Couldn't open " << file << reset << std::endl;
+    exit(1);
+  }
+
+  // Paths of the clouds are relative to the folder of the sequence file
+  std::string folder = (file.find_last_of('/') == std::string::npos) ? "" : file.substr(0, file.find_last_of('/') + 1);
+
+  std::map<std::string, pcl::PointCloud<pcl::PointXYZ>::Ptr> cache;
+  std::vector<BenchEvent> events;
+  bool mapper_found = false;
+  std::string line;
+  int line_number = 0;
+
+  while (std::getline(in, line))
+  {
+    line_number++;
+    line = line.substr(0, line.find('#'));
+    std::istringstream ss(line);
+    std::string keyword;
+    if (!(ss >> keyword))
+    {
+      continue;  // Empty line or comment
+    }
+
+    BenchEvent event;
+    bool ok = true;
+    if (keyword == "mapper")
+    {
+      ok = static_cast<bool>(ss >> par.wdx >> par.wdy >> par.wdz >> par.res);
+      mapper_found = true;
+    }
+    else if (keyword == "state")
+    {
+      double px, py, pz, vx, vy, vz, yaw;
+      ok = static_cast<bool>(ss >> px >> py >> pz >> vx >> vy >> vz >> yaw);
+      event.type = BenchEvent::UPDATE_STATE;
+      event.data.setPos(px, py, pz);
+      event.data.setVel(vx, vy, vz);
+      event.data.setYaw(yaw);
+    }
+    else if (keyword == "goal")
+    {
+      double x, y, z;
+      ok = static_cast<bool>(ss >> x >> y >> z);
+      event.type = BenchEvent::SET_GOAL;
+      event.data.setPos(x, y, z);
+    }
+    else if (keyword == "map")
+    {
+      std::string map_file, unk_file;
+      ok = static_cast<bool>(ss >> map_file >> unk_file);
+      event.type = BenchEvent::UPDATE_MAP;
+      if (ok)
+      {
+        event.pclptr_map = loadCloud((map_file[0] == '/') ? map_file : folder + map_file, cache);
+        event.pclptr_unk = loadCloud((unk_file[0] == '/') ? unk_file : folder + unk_file, cache);
+      }
+    }
+    else if (keyword == "step")
+    {
+      ok = static_cast<bool>(ss >> event.steps);
+      event.type = BenchEvent::STEP;
+    }
+    else if (keyword == "replan")
+    {
+      event.type = BenchEvent::REPLAN;
+    }
+    else
+    {
+      ok = false;
+    }
+
+    if (!ok)
+    {
+      std::cout << bold << red << file << ":" << line_number << ": can't parse \"" << line << "\"" << reset
+                << std::endl;
+      exit(1);
+    }
+    if (keyword != "mapper")
+    {
+      events.push_back(event);
+    }
+  }
+
+  if (mapper_found == false)
+  {
+    std::cout << bold << red << "The sequence needs a \"mapper wdx wdy wdz res\" line" << reset << std::endl;
+    exit(1);
+  }
+
+  return events;
+}
+
+// Nearest-rank percentile
+double percentile(std::vector<double> samples, double p)
+{
+  std::sort(samples.begin(), samples.end());
+  int index = std::ceil(p / 100.0 * samples.size()) - 1;
+  return samples[std::max(index, 0)];
+}
+
+void printRow(const std::string& name, std::vector<double>& samples)
+{
+  std::cout << std::left << std::setw(16) << name << std::right << std::setw(8) << samples.size();
+  if (samples.size() > 0)
+  {
+    std::cout << std::setw(12) << percentile(samples, 50) << std::setw(12) << percentile(samples, 95) << std::setw(12)
+              << percentile(samples, 99) << std::setw(12) << *std::max_element(samples.begin(), samples.end());
+  }
+  std::cout << std::endl;
+}
+
+// Runs the sequence repetitions times (a new planner each time) and prints the latency percentiles of each stage
+void runBench(parameters par, std::vector<BenchEvent>& events, int repetitions, bool publisher_thread)
+{
+  const std::vector<std::pair<std::string, double replan_times::*>> stages = {
+    { "jps", &replan_times::jps },
+    { "decomp_whole", &replan_times::decomp_whole },
+    { "gurobi_whole", &replan_times::gurobi_whole },
+    { "decomp_safe", &replan_times::decomp_safe },
+    { "gurobi_safe", &replan_times::gurobi_safe },
+    { "incumbent_whole", &replan_times::incumbent_whole },
+    { "incumbent_safe", &replan_times::incumbent_safe },
+    { "fillX", &replan_times::fillX },
+    { "append", &replan_times::append },
+    { "total", &replan_times::total },
+  };
+  std::vector<std::vector<double>> samples(stages.size());
+  std::vector<double> nodes_whole_samples, nodes_safe_samples;  // Branch-and-bound nodes
+  std::vector<double> iterations_whole_samples, iterations_safe_samples;  // Simplex and barrier iterations
+  std::vector<double> intervals_whole_samples, intervals_safe_samples;    // N of the problems
+  int n_numeric = 0;  // Solves that ended with numerical trouble
+  int n_cache_hits = 0;  // Solutions (whole or safe) that came from the solution_cache
+  std::vector<double> next_goal_samples;  // Latency of getNextGoal() (only with --publisher)
+  int n_replans = 0;
+  int n_already_published = 0;  // The new trajectory was discarded because A had already been published
+  int n_skipped = 0;            // replanNeeded() was false (only with --publisher)
+
+  const std::string telemetry_file = par.telemetry_file;
+
+  for (int r = 0; r < repetitions; r++)
+  {
+    // One telemetry file per repetition: <telemetry_file>.<r>
+    if (telemetry_file != "" && repetitions > 1)
+    {
+      par.telemetry_file = telemetry_file + "." + std::to_string(r);
+    }
+
+    // A new planner per repetition, so that all of them start from the same state
+    Faster faster(par);
+    faster.warmUpSolvers();  // As FasterRos does
+    if (par.telemetry_file != "")
+    {
+      faster.startTelemetry();
+    }
+
+    auto replan = [&]() {
+      vec_Vecf<3> JPS_safe, JPS_whole;
+      vec_E<Polyhedron<3>> poly_safe, poly_whole;
+      std::vector<state> X_safe, X_whole;
+      faster.replan(JPS_safe, JPS_whole, poly_safe, poly_whole, X_safe, X_whole);
+
+      replan_times times;
+      faster.getReplanTimes(times);
+      if (times.append >= 0 && times.total < 0)
+      {
+        n_already_published++;
+      }
+      for (int i = 0; i < stages.size(); i++)
+      {
+        if (times.*(stages[i].second) >= 0)
+        {
+          samples[i].push_back(times.*(stages[i].second));
+        }
+      }
+      replan_record record;
+      faster.getReplanRecord(record);
+      if (record.nodes_whole >= 0)
+      {
+        nodes_whole_samples.push_back(record.nodes_whole);
+      }
+      if (record.nodes_safe >= 0)
+      {
+        nodes_safe_samples.push_back(record.nodes_safe);
+      }
+      if (record.iterations_whole >= 0)
+      {
+        iterations_whole_samples.push_back(record.iterations_whole);
+      }
+      if (record.iterations_safe >= 0)
+      {
+        iterations_safe_samples.push_back(record.iterations_safe);
+      }
+      n_numeric += std::max(record.numeric_whole, 0) + std::max(record.numeric_safe, 0);
+      n_cache_hits += std::max(record.cache_hit_whole, 0) + std::max(record.cache_hit_safe, 0);
+      if (record.n_intervals_whole >= 0)
+      {
+        intervals_whole_samples.push_back(record.n_intervals_whole);
+      }
+      if (record.n_intervals_safe >= 0)
+      {
+        intervals_safe_samples.push_back(record.n_intervals_safe);
+      }
+      n_replans++;
+    };
+
+    // Same as pubCB, the drone tracks perfectly the goals published
+    std::atomic<bool> publishing(publisher_thread);
+    std::thread publisher([&]() {
+      std::chrono::steady_clock::time_point next_tick = std::chrono::steady_clock::now();
+      while (publishing)
+      {
+        next_tick += std::chrono::microseconds((int64_t)(par.dc * 1e6));
+        std::this_thread::sleep_until(next_tick);
+        state next_goal;
+        JPS::Timer next_goal_t(true);
+        bool published = faster.getNextGoal(next_goal);
+        double elapsed = next_goal_t.ElapsedMs();
+        if (published)
+        {
+          next_goal_samples.push_back(elapsed);
+          faster.updateState(next_goal);
+        }
+      }
+    });
+
+    for (auto& event : events)
+    {
+      switch (event.type)
+      {
+        case BenchEvent::UPDATE_MAP:
+          faster.updateMap(event.pclptr_map, event.pclptr_unk);
+          break;
+        case BenchEvent::UPDATE_STATE:
+          faster.updateState(event.data);
+          break;
+        case BenchEvent::SET_GOAL:
+          faster.setTerminalGoal(event.data);
+          break;
+        case BenchEvent::STEP:
+          if (publisher_thread)
+          {
+            // Same as replanCB, while the publisher thread consumes the plan
+            JPS::Timer step_t(true);
+            while (step_t.ElapsedMs() < event.steps * par.dc * 1000)
+            {
+              if (faster.replanNeeded())
+              {
+                replan();
+              }
+              else
+              {
+                n_skipped++;
+                std::this_thread::sleep_for(std::chrono::microseconds((int64_t)(par.dc * 1e6)));
+              }
+            }
+          }
+          else
+          {
+            // The drone tracks perfectly the goals published at 1/dc Hz
+            for (int i = 0; i < event.steps; i++)
+            {
+              state next_goal;
+              if (faster.getNextGoal(next_goal))
+              {
+                faster.updateState(next_goal);
+              }
+            }
+          }
+          break;
+        case BenchEvent::REPLAN:
+          replan();
+          break;
+      }
+    }
+
+    publishing = false;
+    publisher.join();
+  }
+
+  std::cout << std::endl << bold << "Replans: " << n_replans << ", succeeded: " << samples.back().size()
+            << ", A already published: " << n_already_published << ", skipped: " << n_skipped << reset << std::endl;
+  std::cout << std::left << std::setw(16) << "stage" << std::right << std::setw(8) << "n" << std::setw(12) << "p50[ms]"
+            << std::setw(12) << "p95[ms]" << std::setw(12) << "p99[ms]" << std::setw(12) << "max[ms]" << std::endl;
+  std::cout << std::fixed << std::setprecision(3);
+  for (int i = 0; i < stages.size(); i++)
+  {
+    printRow(stages[i].first, samples[i]);
+  }
+  if (publisher_thread)
+  {
+    printRow("getNextGoal", next_goal_samples);
+  }
+  std::cout << std::left << std::setw(16) << "B&B nodes" << std::right << std::setw(8) << "n" << std::setw(12) << "p50"
+            << std::setw(12) << "p95" << std::setw(12) << "p99" << std::setw(12) << "max" << std::endl;
+  printRow("nodes_whole", nodes_whole_samples);
+  printRow("nodes_safe", nodes_safe_samples);
+  printRow("iterations_whole", iterations_whole_samples);
+  printRow("iterations_safe", iterations_safe_samples);
+  printRow("N_whole", intervals_whole_samples);
+  printRow("N_safe", intervals_safe_samples);
+  std::cout << "Solves with numerical trouble: " << n_numeric << std::endl;
+  std::cout << "Solutions from the solution_cache: " << n_cache_hits << std::endl;
+
+}
+
+int main(int argc, char** argv)
+{
+  std::vector<std::string> args;
+  bool publisher_thread = false;
+  // Options that run the sequence twice, with the parameter false and true
+  const std::map<std::string, std::pair<std::string, bool parameters::*>> ab_options = {
+    { "--warm-start-ab", { "warm_start", &parameters::warm_start } },
+    { "--monotone-ab", { "monotone_binaries", &parameters::monotone_binaries } },
+    { "--lazy-ab", { "lazy_faces", &parameters::lazy_faces } },
+    { "--adaptive-ab", { "adaptive_size", &parameters::adaptive_size } },
+    { "--cache-ab", { "solution_cache", &parameters::solution_cache } },
+  };
+  std::string ab_option = "";
+  bool formulation_ab = false;  // Runs the sequence with each gurobi_formulation
+  for (int i = 1; i < argc; i++)
+  {
+    if (std::string(argv[i]) == "--publisher")
+    {
+      publisher_thread = true;
+    }
+    else if (std::string(argv[i]) == "--formulation-ab")
+    {
+      formulation_ab = true;
+    }
+    else if (ab_options.count(argv[i]) > 0)
+    {
+      ab_option = argv[i];
+    }
+    else
+    {
+      args.push_back(argv[i]);
+    }
+  }
+
+  if (args.size() < 2)
+  {
+    std::cout << "Usage: " << argv[0]
+              << " <faster.yaml> <sequence.txt> [repetitions] [--publisher]"
+                 " [--warm-start-ab | --monotone-ab | --lazy-ab | --adaptive-ab | --cache-ab | --formulation-ab]"
+              << std::endl;
+    return 1;
+  }
+
+  parameters par = loadParameters(args[0]);
+  std::vector<BenchEvent> events = loadSequence(args[1], par);
+  int repetitions = (args.size() > 2) ? std::max(atoi(args[2].c_str()), 1) : 1;
+
+  if (formulation_ab == true)
+  {
+    for (std::string formulation : { "coefficients", "bezier", "minvo", "normalized" })
+    {
+      std::cout << std::endl << bold << "gurobi_formulation: " << formulation << reset;
+      par.gurobi_formulation = formulation;
+      runBench(par, events, repetitions, publisher_thread);
+    }
+  }
+  else if (ab_option != "")
+  {
+    const std::pair<std::string, bool parameters::*>& option = ab_options.at(ab_option);
+    for (bool value : { false, true })
+    {
+      std::cout << std::endl << bold << option.first << ": " << (value ? "true" : "false") << reset;
+      par.*(option.second) = value;
+      runBench(par, events, repetitions, publisher_thread);
+    }
+  }
+  else
+  {
+    runBench(par, events, repetitions, publisher_thread);
+  }
+
+  return 0;
+}
@@ -51,11 +51,43 @@ FasterRos::FasterRos(ros::NodeHandle nh) : nh_(nh)
   safeGetParam(nh_, "max_poly_safe", par_.max_poly_safe);
   safeGetParam(nh_, "dist_max_vertexes", par_.dist_max_vertexes);
 
+  safeGetParam(nh_, "adaptive_size", par_.adaptive_size);
+  safeGetParam(nh_, "adaptive_N_min", par_.adaptive_N_min);
+  safeGetParam(nh_, "adaptive_length_per_interval", par_.adaptive_length_per_interval);
+  safeGetParam(nh_, "adaptive_length_per_poly", par_.adaptive_length_per_poly);
+
+  safeGetParam(nh_, "solution_cache", par_.solution_cache);
+  safeGetParam(nh_, "solution_cache_size", par_.solution_cache_size);
+  safeGetParam(nh_, "solution_cache_resolution", par_.solution_cache_resolution);
+
   safeGetParam(nh_, "gurobi_threads", par_.gurobi_threads);
+  safeGetParam(nh_, "parallel_factors", par_.parallel_factors);
+  safeGetParam(nh_, "factor_bisection", par_.factor_bisection);
+  safeGetParam(nh_, "warm_start", par_.warm_start);
+  safeGetParam(nh_, "monotone_qp", par_.monotone_qp);
+  safeGetParam(nh_, "monotone_binaries", par_.monotone_binaries);
+  safeGetParam(nh_, "lazy_faces", par_.lazy_faces);
+  safeGetParam(nh_, "lazy_faces_margin", par_.lazy_faces_margin);
+  safeGetParam(nh_, "gurobi_formulation", par_.gurobi_formulation);
+  safeGetParam(nh_, "solver_backend", par_.solver_backend);
   safeGetParam(nh_, "gurobi_verbose", par_.gurobi_verbose);
 
   safeGetParam(nh_, "use_faster", par_.use_faster);
 
+  safeGetParam(nh_, "replan_horizon_min", par_.replan_horizon_min);
+  safeGetParam(nh_, "replan_latency_window", par_.replan_latency_window);
+  safeGetParam(nh_, "replan_latency_percentile", par_.replan_latency_percentile);
+  safeGetParam(nh_, "replan_deadline", par_.replan_deadline);
+  safeGetParam(nh_, "replan_pipeline", par_.replan_pipeline);
+
+  safeGetParam(nh_, "revalidate_plan", par_.revalidate_plan);
+
+  safeGetParam(nh_, "safe_candidates", par_.safe_candidates);
+  safeGetParam(nh_, "safe_candidates_dt", par_.safe_candidates_dt);
+
+  safeGetParam(nh_, "telemetry_file", par_.telemetry_file);
+  safeGetParam(nh_, "telemetry_topic", par_.telemetry_topic);
+
   safeGetParam(nh_, "is_ground_robot", par_.is_ground_robot);
 
   // And now obtain the parameters from the mapper
@@ -116,6 +148,7 @@ FasterRos::FasterRos(ros::NodeHandle nh) : nh_(nh)
 
   // Initialize FASTER
   faster_ptr_ = std::unique_ptr<Faster>(new Faster(par_));
+  faster_ptr_->warmUpSolvers();
   ROS_INFO("Planner initialized");
 
   // Publishers
@@ -144,6 +177,17 @@ FasterRos::FasterRos(ros::NodeHandle nh) : nh_(nh)
   pub_traj_committed_colored_ = nh_.advertise<visualization_msgs::MarkerArray>("traj_committed_colored", 1);
   pub_traj_whole_colored_ = nh_.advertise<visualization_msgs::MarkerArray>("traj_whole_colored", 1);
   pub_traj_safe_colored_ = nh_.advertise<visualization_msgs::MarkerArray>("traj_safe_colored", 1);
+  pub_replan_record_ = nh_.advertise<faster_msgs::ReplanRecord>("replan_record", 100);
+
+  // Telemetry
+  if (par_.telemetry_topic == true)
+  {
+    faster_ptr_->startTelemetry(boost::bind(&FasterRos::pubReplanRecord, this, _1));
+  }
+  else if (par_.telemetry_file != "")
+  {
+    faster_ptr_->startTelemetry();
+  }
 
   // Subscribers
   occup_grid_sub_.subscribe(nh_, "occup_grid", 1);
@@ -183,7 +227,7 @@ FasterRos::FasterRos(ros::NodeHandle nh) : nh_(nh)
 
 void FasterRos::replanCB(const ros::TimerEvent& e)
 {
-  if (ros::ok())
+  if (ros::ok() && faster_ptr_->replanNeeded())
   {
     vec_Vecf<3> JPS_safe;
     vec_Vecf<3> JPS_whole;
@@ -221,6 +265,56 @@ void FasterRos::publishPoly(const vec_E<Polyhedron<3>>& poly, int type)
   }
 }
 
+void FasterRos::pubReplanRecord(const replan_record& record)
+{
+  faster_msgs::ReplanRecord msg;
+  msg.header.stamp = ros::Time(record.stamp);
+  msg.header.frame_id = world_name_;
+  msg.outcome = record.outcome;
+
+  msg.jps_ms = record.times.jps;
+  msg.decomp_whole_ms = record.times.decomp_whole;
+  msg.gurobi_whole_ms = record.times.gurobi_whole;
+  msg.decomp_safe_ms = record.times.decomp_safe;
+  msg.gurobi_safe_ms = record.times.gurobi_safe;
+  msg.incumbent_whole_ms = record.times.incumbent_whole;
+  msg.incumbent_safe_ms = record.times.incumbent_safe;
+  msg.fillX_ms = record.times.fillX;
+  msg.append_ms = record.times.append;
+  msg.total_ms = record.times.total;
+
+  msg.trials_whole = record.trials_whole;
+  msg.trials_safe = record.trials_safe;
+  msg.runtime_whole_ms = record.runtime_whole_ms;
+  msg.runtime_safe_ms = record.runtime_safe_ms;
+  msg.factor_whole = record.factor_whole;
+  msg.factor_safe = record.factor_safe;
+
+  msg.n_poly_whole = record.n_poly_whole;
+  msg.n_poly_safe = record.n_poly_safe;
+  msg.n_faces_whole = record.n_faces_whole;
+  msg.n_faces_safe = record.n_faces_safe;
+  msg.safe_candidate = record.safe_candidate;
+
+  msg.jps_length = record.jps_length;
+  msg.nodes_whole = record.nodes_whole;
+  msg.nodes_safe = record.nodes_safe;
+  msg.iterations_whole = record.iterations_whole;
+  msg.iterations_safe = record.iterations_safe;
+  msg.numeric_whole = record.numeric_whole;
+  msg.numeric_safe = record.numeric_safe;
+  msg.n_intervals_whole = record.n_intervals_whole;
+  msg.n_intervals_safe = record.n_intervals_safe;
+  msg.cache_hit_whole = record.cache_hit_whole;
+  msg.cache_hit_safe = record.cache_hit_safe;
+  msg.n_points_map = record.n_points_map;
+  msg.n_points_unk = record.n_points_unk;
+  msg.deltaT = record.deltaT;
+  msg.stitched = record.stitched;
+
+  pub_replan_record_.publish(msg);
+}
+
 void FasterRos::stateCB(const snapstack_msgs::State& msg)
 {
   state state_tmp;
@@ -7,19 +7,9 @@
  * -------------------------------------------------------------------------- */
 
 #include "jps_manager.hpp"
-#include "geometry_msgs/PointStamped.h"
-#include "geometry_msgs/Twist.h"
-#include "nav_msgs/Path.h"
-#include "visualization_msgs/MarkerArray.h"
-#include <pcl_conversions/pcl_conversions.h>
 #include <pcl/kdtree/kdtree.h>
-#include <pcl/filters/filter.h>
-#include <pcl/filters/crop_box.h>
-#include <pcl/filters/passthrough.h>
 #include <Eigen/StdVector>
 
-#include <tf2_sensor_msgs/tf2_sensor_msgs.h>
-
 #include <stdio.h>
 #include <math.h>
 #include <algorithm>
@@ -27,8 +17,6 @@
 #include <assert.h>
 #include <stdlib.h>
 
-#include <sensor_msgs/point_cloud_conversion.h>
-
 #include "termcolor.hpp"
 
 // using namespace JPS;
@@ -77,8 +65,9 @@ void JPS_Manager::setDroneRadius(double drone_radius)
   drone_radius_ = drone_radius;
 }
 
-void JPS_Manager::cvxEllipsoidDecomp(vec_Vecf<3>& path, int type_space, std::vector<LinearConstraint3D>& l_constraints,
-                                     vec_E<Polyhedron<3>>& poly_out)
+void JPS_Manager::cvxEllipsoidDecomp(const MapSnapshot& map, vec_Vecf<3>& path, int type_space,
+                                     std::vector<LinearConstraint3D>& l_constraints, vec_E<Polyhedron<3>>& poly_out,
+                                     std::chrono::steady_clock::time_point deadline)
 {
   /*  if (takeoff_done_ == false)
     {
@@ -88,25 +77,32 @@ void JPS_Manager::cvxEllipsoidDecomp(vec_Vecf<3>& path, int type_space, std::vec
     }
     else
     {*/
+  EllipsoidDecomp3D ellip_decomp_util;  // Local: the decompositions of several replans may run at the same time
   if (type_space == UNKOWN_AND_OCCUPIED_SPACE)
   {
-    ellip_decomp_util_.set_obs(vec_uo_);
+    ellip_decomp_util.set_obs(map.vec_uo);
   }
   else
   {
-    ellip_decomp_util_.set_obs(vec_o_);
+    ellip_decomp_util.set_obs(map.vec_o);
   }
   //}
-  ellip_decomp_util_.set_local_bbox(Vec3f(2, 2, 1));  // Only try to find cvx decomp in the Mikowsski sum of JPS and
-                                                      // this box (I think) par_.drone_radius
-  ellip_decomp_util_.set_inflate_distance(drone_radius_);  // The obstacles are inflated by this distance
-  ellip_decomp_util_.dilate(path);                         // Find convex polyhedra
+  ellip_decomp_util.set_local_bbox(Vec3f(2, 2, 1));  // Only try to find cvx decomp in the Mikowsski sum of JPS and
+                                                     // this box (I think) par_.drone_radius
+  ellip_decomp_util.set_inflate_distance(drone_radius_);  // The obstacles are inflated by this distance
+  ellip_decomp_util.dilate(path, 0, deadline);            // Find convex polyhedra
+  if (ellip_decomp_util.get_path().size() < path.size())
+  {
+    FASTER_DEBUG("Deadline reached, decomposed " << ellip_decomp_util.get_path().size() - 1 << "/" << path.size() - 1
+                                                 << " segments");
+    path = ellip_decomp_util.get_path();
+  }
   // decomp_util.shrink_polyhedrons(par_.drone_radius);  // Shrink polyhedra by the drone radius. NOT RECOMMENDED (leads
   // to lack of continuity in path sometimes)
 
   // Convert to inequality constraints Ax < b
   // std::vector<polytope> polytopes;
-  auto polys = ellip_decomp_util_.get_polyhedrons();
+  auto polys = ellip_decomp_util.get_polyhedrons();
 
   l_constraints.clear();
 
@@ -123,22 +119,24 @@ void JPS_Manager::cvxEllipsoidDecomp(vec_Vecf<3>& path, int type_space, std::vec
 
     l_constraints.push_back(cs);
   }
-  poly_out = ellip_decomp_util_.get_polyhedrons();
+  poly_out = ellip_decomp_util.get_polyhedrons();
 }
 
-void JPS_Manager::updateJPSMap(pcl::PointCloud<pcl::PointXYZ>::Ptr pclptr, Eigen::Vector3d& center)
+// Builds a new voxel map (it doesn't touch the one JPS is using)
+std::shared_ptr<const JPS::VoxelMapUtil> JPS_Manager::buildJPSMap(pcl::PointCloud<pcl::PointXYZ>::Ptr pclptr,
+                                                                  Eigen::Vector3d& center)
 {
   Vec3f center_map = center;  // state_.pos;
 
-  mtx_jps_map_util.lock();
-
-  map_util_->readMap(pclptr, cells_x_, cells_y_, cells_z_, factor_jps_ * res_, center_map, z_ground_, z_max_,
-                     inflation_jps_);  // Map read
+  std::shared_ptr<JPS::VoxelMapUtil> map_util = std::make_shared<JPS::VoxelMapUtil>();
+  map_util->readMap(pclptr, cells_x_, cells_y_, cells_z_, factor_jps_ * res_, center_map, z_ground_, z_max_,
+                    inflation_jps_);  // Map read
 
-  mtx_jps_map_util.unlock();
+  return map_util;
 }
 
-vec_Vecf<3> JPS_Manager::solveJPS3D(Vec3f& start_sent, Vec3f& goal_sent, bool* solved, int i)
+vec_Vecf<3> JPS_Manager::solveJPS3D(const MapSnapshot& map, Vec3f& start_sent, Vec3f& goal_sent, bool* solved, int i,
+                                    std::chrono::steady_clock::time_point deadline)
 {
   Eigen::Vector3d start(start_sent(0), start_sent(1), std::max(start_sent(2), 0.0));
   Eigen::Vector3d goal(goal_sent(0), goal_sent(1), std::max(goal_sent(2), 0.0));
@@ -154,6 +152,13 @@ vec_Vecf<3> JPS_Manager::solveJPS3D(Vec3f& start_sent, Vec3f& goal_sent, bool* s
 
   mtx_jps_map_util.lock();
 
+  // The snapshot is shared (and immutable), so JPS works on a copy of its voxel map, made only when the map changes
+  if (map.map_util != map_util_source_)
+  {
+    *map_util_ = *map.map_util;
+    map_util_source_ = map.map_util;
+  }
+
   // Set start and goal free
   const Veci<3> start_int = map_util_->floatToInt(start);
   const Veci<3> goal_int = map_util_->floatToInt(goal);
@@ -162,6 +167,7 @@ vec_Vecf<3> JPS_Manager::solveJPS3D(Vec3f& start_sent, Vec3f& goal_sent, bool* s
   map_util_->setFreeVoxelAndSurroundings(goal_int, inflation_jps_);
 
   planner_ptr_->setMapUtil(map_util_);  // Set collision checking function
+  planner_ptr_->setDeadline(deadline);
 
   bool valid_jps = planner_ptr_->plan(start, goal, 1, true);  // Plan from start to goal with heuristic weight=1, and
                                                               // using JPS (if false --> use A*)
@@ -187,7 +193,7 @@ vec_Vecf<3> JPS_Manager::solveJPS3D(Vec3f& start_sent, Vec3f& goal_sent, bool* s
   }
   else
   {
-    std::cout << "JPS didn't find a solution from" << start.transpose() << " to " << goal.transpose() << std::endl;
+    FASTER_WARN("JPS didn't find a solution from" << start.transpose() << " to " << goal.transpose());
   }
   mtx_jps_map_util.unlock();
 
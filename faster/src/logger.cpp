@@ -0,0 +1,123 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2020, Jesus Tordesillas Torres, Aerospace Controls Laboratory
+ * Massachusetts Institute of Technology
+ * All Rights Reserved
+ * Authors: Jesus Tordesillas, et al.
+ * See LICENSE file for the license information
+ * -------------------------------------------------------------------------- */
+
+#include "logger.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <unistd.h>
+
+namespace
+{
+// Marks the ring of a thread as finished when the thread exits (std::async creates a new thread each time)
+struct ThreadRingOwner
+{
+  ~ThreadRingOwner()
+  {
+    if (finished != nullptr)
+    {
+      *finished = true;
+    }
+  }
+  std::atomic<bool>* finished = nullptr;
+};
+}  // namespace
+
+Logger& Logger::instance()
+{
+  static Logger logger;
+  return logger;
+}
+
+Logger::Logger()
+{
+  colorized_ = isatty(fileno(stdout));
+  thread_ = std::thread(&Logger::drain, this);
+}
+
+Logger::~Logger()
+{
+  running_ = false;
+  thread_.join();
+  flush();
+}
+
+std::shared_ptr<Logger::ThreadRing> Logger::registerThread()
+{
+  std::shared_ptr<ThreadRing> ring = std::make_shared<ThreadRing>();
+  std::lock_guard<std::mutex> lock(mtx_rings_);
+  rings_.push_back(ring);
+  return ring;
+}
+
+void Logger::push(std::string&& line)
+{
+  // The Logger keeps the ring alive until the thread has finished and the ring has been drained
+  thread_local std::shared_ptr<ThreadRing> ring;
+  thread_local ThreadRingOwner owner;
+  if (ring == nullptr)
+  {
+    ring = registerThread();
+    owner.finished = &ring->thread_finished;
+  }
+
+  if (ring->ring.push(line) == false)
+  {
+    dropped_++;
+  }
+}
+
+void Logger::flush()
+{
+  std::lock_guard<std::mutex> lock_flush(mtx_flush_);
+
+  std::vector<std::shared_ptr<ThreadRing>> rings;
+  {
+    std::lock_guard<std::mutex> lock(mtx_rings_);
+    rings = rings_;
+  }
+
+  bool written = false;
+  std::string line;
+  for (std::shared_ptr<ThreadRing>& ring : rings)
+  {
+    bool finished = ring->thread_finished;  // Read before draining: nothing can be pushed after it's true
+    while (ring->ring.pop(line))
+    {
+      fwrite(line.data(), 1, line.size(), stdout);
+      fputc('\n', stdout);
+      written = true;
+    }
+    if (finished)
+    {
+      std::lock_guard<std::mutex> lock(mtx_rings_);
+      rings_.erase(std::remove(rings_.begin(), rings_.end(), ring), rings_.end());
+    }
+  }
+
+  uint64_t dropped = dropped_.exchange(0);
+  if (dropped > 0)
+  {
+    fprintf(stdout, "[%llu log lines dropped]\n", (unsigned long long)dropped);
+    written = true;
+  }
+  if (written)
+  {
+    fflush(stdout);
+  }
+}
+
+void Logger::drain()
+{
+  while (running_)
+  {
+    flush();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+}
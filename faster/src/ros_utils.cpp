@@ -0,0 +1,326 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2020, Jesus Tordesillas Torres, Aerospace Controls Laboratory
+ * Massachusetts Institute of Technology
+ * All Rights Reserved
+ * Authors: Jesus Tordesillas, et al.
+ * See LICENSE file for the license information
+ * -------------------------------------------------------------------------- */
+
+#include "ros_utils.hpp"
+
+void vectorOfVectors2MarkerArray(vec_Vecf<3> traj, visualization_msgs::MarkerArray* m_array, std_msgs::ColorRGBA color,
+                                 int type, std::vector<double> radii)
+{
+  if (traj.size() == 0)
+  {
+    return;
+  }
+
+  // printf("In vectorOfVectors2MarkerArray\n");
+  geometry_msgs::Point p_last = eigen2point(traj[0]);
+
+  bool first_element = true;
+  int i = 50000;  // large enough to prevent conflict with other markers
+  int j = 0;
+
+  for (const auto& it : traj)
+  {
+    i++;
+    if (first_element and type == visualization_msgs::Marker::ARROW)  // skip the first element
+    {
+      first_element = false;
+      continue;
+    }
+
+    visualization_msgs::Marker m;
+    m.type = type;
+    m.action = visualization_msgs::Marker::ADD;
+    m.id = i;
+    m.color = color;
+    // m.scale.z = 1;
+
+    m.header.frame_id = "world";
+    m.header.stamp = ros::Time::now();
+    geometry_msgs::Point p = eigen2point(it);
+    if (type == visualization_msgs::Marker::ARROW)
+    {
+      m.scale.x = 0.02;
+      m.scale.y = 0.04;
+      m.points.push_back(p_last);
+      m.points.push_back(p);
+      // std::cout << "pushing marker\n" << m << std::endl;
+      p_last = p;
+    }
+    else
+    {
+      double scale = 0.1;  // Scale is the diameter of the sphere
+      if (radii.size() != 0)
+      {  // If argument provided
+        scale = 2 * radii[j];
+      }
+      m.scale.x = scale;
+      m.scale.y = scale;
+      m.scale.z = scale;
+      m.pose.position = p;
+    }
+    (*m_array).markers.push_back(m);
+    j = j + 1;
+  }
+}
+
+std_msgs::ColorRGBA getColorJet(double v, double vmin, double vmax)
+{
+  std_msgs::ColorRGBA c;
+  c.r = 1;
+  c.g = 1;
+  c.b = 1;
+  c.a = 1;
+  // white
+  double dv;
+
+  if (v < vmin)
+    v = vmin;
+  if (v > vmax)
+    v = vmax;
+  dv = vmax - vmin;
+
+  if (v < (vmin + 0.25 * dv))
+  {
+    c.r = 0;
+    c.g = 4 * (v - vmin) / dv;
+  }
+  else if (v < (vmin + 0.5 * dv))
+  {
+    c.r = 0;
+    c.b = 1 + 4 * (vmin + 0.25 * dv - v) / dv;
+  }
+  else if (v < (vmin + 0.75 * dv))
+  {
+    c.r = 4 * (v - vmin - 0.5 * dv) / dv;
+    c.b = 0;
+  }
+  else
+  {
+    c.g = 1 + 4 * (vmin + 0.75 * dv - v) / dv;
+    c.b = 0;
+  }
+
+  return (c);
+}
+
+std_msgs::ColorRGBA color(int id)
+{
+  std_msgs::ColorRGBA red;
+  red.r = 1;
+  red.g = 0;
+  red.b = 0;
+  red.a = 1;
+  std_msgs::ColorRGBA red_trans;
+  red_trans.r = 1;
+  red_trans.g = 0;
+  red_trans.b = 0;
+  red_trans.a = 0.7;
+  std_msgs::ColorRGBA red_trans_trans;
+  red_trans_trans.r = 1;
+  red_trans_trans.g = 0;
+  red_trans_trans.b = 0;
+  red_trans_trans.a = 0.4;
+  std_msgs::ColorRGBA blue;
+  blue.r = 0;
+  blue.g = 0;
+  blue.b = 1;
+  blue.a = 1;
+  std_msgs::ColorRGBA blue_trans;
+  blue_trans.r = 0;
+  blue_trans.g = 0;
+  blue_trans.b = 1;
+  blue_trans.a = 0.7;
+  std_msgs::ColorRGBA blue_trans_trans;
+  blue_trans_trans.r = 0;
+  blue_trans_trans.g = 0;
+  blue_trans_trans.b = 1;
+  blue_trans_trans.a = 0.4;
+  std_msgs::ColorRGBA blue_light;
+  blue_light.r = 0.5;
+  blue_light.g = 0.7;
+  blue_light.b = 1;
+  blue_light.a = 1;
+  std_msgs::ColorRGBA green;
+  green.r = 0;
+  green.g = 1;
+  green.b = 0;
+  green.a = 1;
+  std_msgs::ColorRGBA yellow;
+  yellow.r = 1;
+  yellow.g = 1;
+  yellow.b = 0;
+  yellow.a = 1;
+  std_msgs::ColorRGBA orange_trans;  // orange transparent
+  orange_trans.r = 1;
+  orange_trans.g = 0.5;
+  orange_trans.b = 0;
+  orange_trans.a = 0.7;
+  switch (id)
+  {
+    case RED:
+      return red;
+      break;
+    case RED_TRANS:
+      return red_trans;
+      break;
+    case RED_TRANS_TRANS:
+      return red_trans_trans;
+      break;
+    case BLUE:
+      return blue;
+      break;
+    case BLUE_TRANS:
+      return blue_trans;
+      break;
+    case BLUE_TRANS_TRANS:
+      return blue_trans_trans;
+      break;
+    case BLUE_LIGHT:
+      return blue_light;
+      break;
+    case GREEN:
+      return green;
+      break;
+    case YELLOW:
+      return yellow;
+      break;
+    case ORANGE_TRANS:
+      return orange_trans;
+      break;
+    default:
+      ROS_ERROR("COLOR NOT DEFINED");
+  }
+}
+
+//## From Wikipedia - http://en.wikipedia.org/wiki/Conversion_between_quaternions_and_Euler_angles
+void quaternion2Euler(tf2::Quaternion q, double& roll, double& pitch, double& yaw)
+{
+  tf2::Matrix3x3(q).getRPY(roll, pitch, yaw);
+}
+
+void quaternion2Euler(Eigen::Quaterniond q, double& roll, double& pitch, double& yaw)
+{
+  tf2::Quaternion tf_q(q.x(), q.y(), q.z(), q.w());
+  quaternion2Euler(tf_q, roll, pitch, yaw);
+}
+
+void quaternion2Euler(geometry_msgs::Quaternion q, double& roll, double& pitch, double& yaw)
+{
+  tf2::Quaternion tf_q(q.x, q.y, q.z, q.w);
+  quaternion2Euler(tf_q, roll, pitch, yaw);
+}
+
+visualization_msgs::Marker getMarkerSphere(double scale, int my_color)
+{
+  visualization_msgs::Marker marker;
+
+  marker.header.frame_id = "world";
+  marker.id = 0;
+  marker.type = visualization_msgs::Marker::SPHERE;
+  marker.scale.x = scale;
+  marker.scale.y = scale;
+  marker.scale.z = scale;
+  marker.color = color(my_color);
+
+  return marker;
+}
+
+geometry_msgs::Point pointOrigin()
+{
+  geometry_msgs::Point tmp;
+  tmp.x = 0;
+  tmp.y = 0;
+  tmp.z = 0;
+  return tmp;
+}
+
+Eigen::Vector3d vec2eigen(geometry_msgs::Vector3 vector)
+{
+  Eigen::Vector3d tmp;
+  tmp << vector.x, vector.y, vector.z;
+  return tmp;
+}
+
+geometry_msgs::Vector3 eigen2rosvector(Eigen::Vector3d vector)
+{
+  geometry_msgs::Vector3 tmp;
+  tmp.x = vector(0, 0);
+  tmp.y = vector(1, 0);
+  tmp.z = vector(2, 0);
+  return tmp;
+}
+
+geometry_msgs::Point eigen2point(Eigen::Vector3d vector)
+{
+  geometry_msgs::Point tmp;
+  tmp.x = vector[0];
+  tmp.y = vector[1];
+  tmp.z = vector[2];
+  return tmp;
+}
+
+geometry_msgs::Vector3 vectorNull()
+{
+  geometry_msgs::Vector3 tmp;
+  tmp.x = 0;
+  tmp.y = 0;
+  tmp.z = 0;
+  return tmp;
+}
+
+geometry_msgs::Vector3 vectorUniform(double a)
+{
+  geometry_msgs::Vector3 tmp;
+  tmp.x = a;
+  tmp.y = a;
+  tmp.z = a;
+  return tmp;
+}
+
+visualization_msgs::MarkerArray stateVector2ColoredMarkerArray(const std::vector<state>& data, int type,
+                                                               double max_value)
+{
+  visualization_msgs::MarkerArray marker_array;
+
+  if (data.size() == 0)
+  {
+    return marker_array;
+  }
+  geometry_msgs::Point p_last;
+  p_last.x = data[0].pos(0);
+  p_last.y = data[0].pos(1);
+  p_last.z = data[0].pos(2);
+
+  int j = type * 9000;
+  for (int i = 0; i < data.size(); i = i + 1)
+  {
+    j = j + 1;
+    double vel = data[i].vel.norm();
+    visualization_msgs::Marker m;
+    m.type = visualization_msgs::Marker::ARROW;
+    m.header.frame_id = "world";
+    m.header.stamp = ros::Time::now();
+    m.action = visualization_msgs::Marker::ADD;
+    m.id = j;
+    m.color = getColorJet(vel, 0, max_value);  // note that par_.v_max is per axis!
+    m.scale.x = 0.15;
+    m.scale.y = 0;
+    m.scale.z = 0;
+    // std::cout << "Mandando bloque" << X.block(i, 0, 1, 3) << std::endl;
+    geometry_msgs::Point p;
+    p.x = data[i].pos(0);
+    p.y = data[i].pos(1);
+    p.z = data[i].pos(2);
+    m.points.push_back(p_last);
+    m.points.push_back(p);
+    // std::cout << "pushing marker\n" << m << std::endl;
+    p_last = p;
+    marker_array.markers.push_back(m);
+  }
+  return marker_array;
+}
@@ -9,18 +9,38 @@
 #include "solverGurobi.hpp"
 #include "solverGurobi_utils.hpp"
 #include <chrono>
+#include <future>
 #include <unistd.h>
-#include <ros/package.h>
+
+// Names of the variables and constraints, to debug the model with m.write(). Only with FASTER_GUROBI_NAMES (see
+// CMakeLists.txt): building the strings is a good part of the time spent building the model
+#ifdef FASTER_GUROBI_NAMES
+#define GRB_NAME(name) (name)
+#else
+#define GRB_NAME(name) std::string()
+#endif
 
 mycallback::mycallback()
 {
   should_terminate_ = false;
+  cancel_trial_ = false;
+  got_incumbent_ = false;
 }
 
 void mycallback::callback()
 {  // This function is called periodically along the optimization process.
   //  It is called several times more after terminating the program
-  if (should_terminate_ == true)
+  if (where == GRB_CB_MIPSOL)
+  {
+    // With lazy faces, Gurobi rejects the incumbents that violate faces that are not in the model
+    bool rejected = (lazy_solver_ != nullptr && lazy_solver_->separateFaces(*this) == true);
+    if (rejected == false && got_incumbent_ == false)
+    {
+      got_incumbent_ = true;
+      first_incumbent_ = std::chrono::steady_clock::now();
+    }
+  }
+  if (should_terminate_ == true || cancel_trial_ == true)
   {
     GRBCallback::abort();  // This function only does effect when inside the function callback() of this class
     // terminated_ = true;
@@ -30,17 +50,50 @@ void mycallback::callback()
 void SolverGurobi::StopExecution()
 {
   cb_.should_terminate_ = true;
-  std::cout << "Activated flag to stop execution" << std::endl;
+  for (auto& worker : factor_workers_)
+  {
+    worker->cb_.should_terminate_ = true;
+  }
+  for (auto& worker : qp_workers_)
+  {
+    worker->cb_.should_terminate_ = true;
+  }
+  FASTER_DEBUG("Activated flag to stop execution");
 }
 
 void SolverGurobi::ResetToNormalState()
 {
   cb_.should_terminate_ = false;
+  for (auto& worker : factor_workers_)
+  {
+    worker->cb_.should_terminate_ = false;
+  }
+  for (auto& worker : qp_workers_)
+  {
+    worker->cb_.should_terminate_ = false;
+  }
+}
+
+void SolverGurobi::setDeadline(std::chrono::steady_clock::time_point deadline)
+{
+  deadline_ = deadline;
+}
+
+// Gurobi environments aren't thread-safe, and models that are optimized at the same time need different environments.
+// Every solver can run concurrently with another one (the front end solves the whole trajectory while the back end
+// solves the safe one, the safe candidates and the factor and QP workers run in parallel), so each one starts its own
+// environment when it's constructed (at startup, with the rest of the setup) and frees it with the model
+GRBEnv* SolverGurobi::startEnv()
+{
+  GRBEnv* env = new GRBEnv(true);        // Empty: the parameters are set before the license check
+  env->set(GRB_IntParam_OutputFlag, 0);  // No banner (setVerbose() sets it in the model)
+  env->start();
+  return env;
 }
 
 SolverGurobi::SolverGurobi()
 {
-  std::cout << "In the Gurobi Constructor\n";
+  FASTER_DEBUG("In the Gurobi Constructor");
 
   v_max_ = 5;
   a_max_ = 3;
@@ -48,15 +101,33 @@ SolverGurobi::SolverGurobi()
   // N_ = 10;  // Segments: 0,1,...,N_-1
 
   // Model
-  /*  env = new GRBEnv();
-    m = GRBModel(*env);*/
   m.set(GRB_StringAttr_ModelName, "planning");
 
-  cb_ = mycallback();
-
   m.setCallback(&cb_);  // The callback will be called periodically along the optimization
 }
 
+void SolverGurobi::setup(const solver_settings& settings)
+{
+  double max_values[3] = { settings.v_max, settings.a_max, settings.j_max };
+  setN(settings.N);
+  intervals_ = N_;
+  setFormulation(settings.formulation);
+  createVars();
+  setDC(settings.dc);
+  setBounds(max_values);
+  setForceFinalConstraint(settings.force_final_constraint);
+  setFactorInitialAndFinalAndIncrement(settings.factor_initial, settings.factor_final, settings.factor_increment);
+  setVerbose(settings.verbose);
+  setThreads(settings.threads);
+  setWMax(settings.w_max);
+  setFactorBisection(settings.factor_bisection);
+  setWarmStart(settings.warm_start);
+  setMonotoneBinaries(settings.monotone_binaries);
+  setMonotoneQP(settings.monotone_qp);
+  setLazyFaces(settings.lazy_faces, settings.lazy_faces_margin);
+  setParallelFactors(settings.parallel_factors);  // Last, the factor workers copy the rest of the setup
+}
+
 void SolverGurobi::setN(int N)
 {
   N_ = N;
@@ -67,24 +138,116 @@ void SolverGurobi::setMode(int mode)
   mode_ = mode;
 }
 
+void SolverGurobi::ConstrBatch::add(const double* coeffs, const GRBVar* vars, int count, char sense, double rhs_value,
+                                    const std::string& name)
+{
+  exprs.emplace_back();
+  exprs.back().addTerms(coeffs, vars, count);
+  senses.push_back(sense);
+  rhs.push_back(rhs_value);
+#ifdef FASTER_GUROBI_NAMES
+  names.push_back(name);
+#endif
+}
+
+void SolverGurobi::ConstrBatch::add(std::initializer_list<double> coeffs, std::initializer_list<GRBVar> vars,
+                                    char sense, double rhs_value, const std::string& name)
+{
+  add(coeffs.begin(), vars.begin(), coeffs.size(), sense, rhs_value, name);
+}
+
+std::vector<GRBConstr> SolverGurobi::addBatch(const ConstrBatch& batch)
+{
+  int count = batch.exprs.size();
+  if (count == 0)
+  {
+    return std::vector<GRBConstr>();
+  }
+  const std::string* names = (batch.names.size() == count) ? batch.names.data() : nullptr;
+  GRBConstr* added = m.addConstrs(batch.exprs.data(), batch.senses.data(), batch.rhs.data(), names, count);
+  std::vector<GRBConstr> constrs(added, added + count);
+  delete[] added;
+  return constrs;
+}
+
+std::vector<GRBVar> SolverGurobi::addVarsBatch(int count, double lb, double ub, char type,
+                                               const std::function<std::string(int)>& name)
+{
+  std::vector<double> lbs(count, lb);
+  std::vector<double> ubs(count, ub);
+  std::vector<char> types(count, type);
+  std::vector<std::string> names;
+#ifdef FASTER_GUROBI_NAMES
+  for (int i = 0; i < count; i++)
+  {
+    names.push_back(name(i));
+  }
+#endif
+  const std::string* var_names = names.empty() ? nullptr : names.data();
+  GRBVar* added = m.addVars(lbs.data(), ubs.data(), nullptr, types.data(), var_names, count);
+  std::vector<GRBVar> vars(added, added + count);
+  delete[] added;
+  return vars;
+}
+
+void SolverGurobi::setFormulation(const std::string& formulation)
+{
+  if (formulation == "bezier")
+  {
+    formulation_ = BEZIER;
+  }
+  else if (formulation == "minvo")
+  {
+    formulation_ = MINVO;
+  }
+  else if (formulation == "normalized")
+  {
+    formulation_ = NORMALIZED;
+  }
+  else
+  {
+    if (formulation != "coefficients")
+    {
+      FASTER_ERROR("Unknown gurobi_formulation: " << formulation << ", using coefficients");
+    }
+    formulation_ = COEFFICIENTS;
+  }
+}
+
 void SolverGurobi::createVars()
 {
-  std::vector<std::string> coeff = { "ax", "ay", "az", "bx", "by", "bz", "cx", "cy", "cz", "dx", "dy", "dz" };
+  if (controlPoints() == true)
+  {
+    // Variables: Bezier control points, 3 * N_ + 1 per axis (the intervals share their first and last ones)
+    std::vector<GRBVar> vars = addVarsBatch(3 * (3 * N_ + 1), -GRB_INFINITY, GRB_INFINITY, GRB_CONTINUOUS, [](int i) {
+      return "P" + std::to_string(i / 3) + "_axis" + std::to_string(i % 3);
+    });
+    for (int t = 0; t < N_; t++)
+    {
+      p.push_back(std::vector<GRBVar>(vars.begin() + 9 * t, vars.begin() + 9 * t + 12));
+    }
+    return;
+  }
 
   // Variables: Coefficients of the polynomials
+  std::vector<GRBVar> vars = addVarsBatch(12 * N_, -GRB_INFINITY, GRB_INFINITY, GRB_CONTINUOUS, [](int i) {
+    const char* coeff[12] = { "ax", "ay", "az", "bx", "by", "bz", "cx", "cy", "cz", "dx", "dy", "dz" };
+    return coeff[i % 12] + std::to_string(i / 12);
+  });
   for (int t = 0; t < N_; t++)
   {
-    std::vector<GRBVar> row_t;
-    for (int i = 0; i < 12; i++)
-    {
-      row_t.push_back(m.addVar(-GRB_INFINITY, GRB_INFINITY, 0, GRB_CONTINUOUS, coeff[i] + std::to_string(t)));
-    }
-    x.push_back(row_t);
+    x.push_back(std::vector<GRBVar>(vars.begin() + 12 * t, vars.begin() + 12 * (t + 1)));
   }
 }
 
-void SolverGurobi::setObjective()  // I need to set it every time, because the objective depends on the xFinal
+void SolverGurobi::setObjective()  // It depends only on the jerk (not on dt nor on xf) --> set only once
 {
+  if (objective_set_ == true)
+  {
+    return;
+  }
+  objective_set_ = true;
+
   GRBQuadExpr control_cost = 0;
   /*  GRBQuadExpr final_state_cost = 0;
     // GRBQuadExpr distance_to_JPS_cost = 0;
@@ -110,417 +273,1647 @@ void SolverGurobi::setObjective()  // I need to set it every time, because the o
       distance_to_JPS_cost = distance_to_JPS_cost + GetNorm2(sample_i - pos_i);
     }*/
 
+  if (controlPoints() == true)
+  {
+    // Sum of the squared (dt^3 * a) = P3 - 3 P2 + 3 P1 - P0: same minimizer as (6a)^2 for a given dt, and doesn't
+    // depend on it
+    const double c[4] = { -1, 3, -3, 1 };
+    std::vector<double> coeffs;
+    std::vector<GRBVar> vars1, vars2;
+    for (int t = 0; t < N_; t++)
+    {
+      for (int i = 0; i < 3; i++)
+      {
+        for (int k1 = 0; k1 < 4; k1++)
+        {
+          for (int k2 = 0; k2 < 4; k2++)
+          {
+            coeffs.push_back(c[k1] * c[k2]);
+            vars1.push_back(p[t][3 * k1 + i]);
+            vars2.push_back(p[t][3 * k2 + i]);
+          }
+        }
+      }
+    }
+    control_cost.addTerms(coeffs.data(), vars1.data(), vars2.data(), coeffs.size());
+    m.setObjective(control_cost, GRB_MINIMIZE);
+    return;
+  }
+
+  // Sum of the squared jerks, (6a)^2 (NORMALIZED: (6 a dt^3)^2, same minimizer for a given dt)
+  std::vector<GRBVar> a;
   for (int t = 0; t < N_; t++)
   {
-    std::vector<GRBLinExpr> ut = { getJerk(t, 0, 0), getJerk(t, 0, 1), getJerk(t, 0, 2) };
-    control_cost = control_cost + GetNorm2(ut);
+    a.insert(a.end(), x[t].begin(), x[t].begin() + 3);
   }
+  std::vector<double> coeffs(a.size(), 36.0);
+  control_cost.addTerms(coeffs.data(), a.data(), a.data(), a.size());
   // m.setObjective(control_cost + final_state_cost + distance_to_JPS_cost, GRB_MINIMIZE);
   m.setObjective(control_cost, GRB_MINIMIZE);
 }
 
 void SolverGurobi::fillX()
 {
-  double t = 0;
-  int interval = 0;
-  //#pragma omp parallel for
-  //  {
+  // The solution saved by the trial that worked (it may have been solved in a factor worker, or in this model before
+  // other trials)
+  dt_ = dt_sol_;
+  sampleSolution(x_sol_, dt_sol_, DC, X_temp_);
+}
+
+void SolverGurobi::getCoefficients(std::vector<double>& coeffs, double& dt)
+{
+  coeffs = x_sol_;
+  dt = dt_sol_;
+}
+
+void SolverGurobi::setForceFinalConstraint(bool forceFinalConstraint)
+{
+  forceFinalConstraint_ = forceFinalConstraint;
+}
+
+void SolverGurobi::setPolytopes(std::vector<LinearConstraint3D> polytopes)
+{
+  polytopes_ = polytopes;
+}
+
+void SolverGurobi::setGuidePath(const vec_Vecf<3>& path)
+{
+  guide_path_ = path;
+}
+
+// Control point k (0..3) of the interval t. Control point 0 is the initial position of the interval
+GRBVar SolverGurobi::getCPVar(int t, int k, int axis)
+{
+  if (formulation_ == BEZIER)
+  {
+    return p[t][3 * k + axis];
+  }
+  if (formulation_ == MINVO)
+  {
+    return v[t][3 * k + axis];
+  }
+  return (k == 0) ? x[t][9 + axis] : q[t][3 * (k - 1) + axis];
+}
+
+// In convex_ mode there is only one polytope per interval (poly=0)
+int SolverGurobi::faceIndex(int t, int k, int poly, int face)
+{
+  int n_polytopes = (convex_ == true) ? 1 : built_polytopes_;
+  return ((t * 4 + k) * n_polytopes + poly) * built_faces_ + face;
+}
+
+// Each control point k of each interval t must be inside the polytope poly if b[t][poly]==1. For each face:
+//   A_face * cp - s <= b_face,  s >= 0,  b[t][poly]==1 --> s <= 0
+// so the indicator constraints only involve s, and the polytopes only appear in coefficients and right-hand sides
+// that can be changed in place. The polytopes with less than built_faces_ faces are padded with 0 * cp - s <= 0
+void SolverGurobi::setPolytopesStructure(int n_polytopes, int n_faces)
+{
+  for (GRBGenConstr& constr : polytopes_cons)
+  {
+    m.remove(constr);
+  }
+  polytopes_cons.clear();
+  for (GRBConstr& constr : face_cons)
+  {
+    m.remove(constr);
+  }
+  face_cons.clear();
+  for (GRBVar& var : s)
+  {
+    m.remove(var);
+  }
+  s.clear();
+  for (GRBConstr& constr : at_least_1_pol_cons)
+  {
+    m.remove(constr);
+  }
+  at_least_1_pol_cons.clear();
+  for (GRBConstr& constr : order_cons)
+  {
+    m.remove(constr);
+  }
+  order_cons.clear();
+  for (std::vector<GRBVar>& row : b)
+  {
+    for (GRBVar& var : row)
+    {
+      m.remove(var);
+    }
+  }
+  b.clear();
+
+  built_polytopes_ = n_polytopes;
+  built_faces_ = n_faces;
+  used_polytopes_ = n_polytopes;
+
+  if (n_polytopes == 0)
+  {
+    return;
+  }
+
+  if (convex_ == true)
+  {
+    // A_face * cp <= b_face for the faces of the polytope of each interval (see assignment_), in faceIndex() order
+    ConstrBatch batch;
+    for (int t = 0; t < N_; t++)
+    {
+      for (int k = 0; k < 4; k++)
+      {
+        for (int face = 0; face < n_faces; face++)
+        {
+          batch.add({ 1, 1, 1 }, { getCPVar(t, k, 0), getCPVar(t, k, 1), getCPVar(t, k, 2) }, GRB_LESS_EQUAL, 0,
+                    GRB_NAME("Face" + std::to_string(face) + "_cp" + std::to_string(k) + "_t" + std::to_string(t)));
+        }
+      }
+    }
+    face_cons = addBatch(batch);
+    return;
+  }
+
+  // Binary variables: b[t][poly]==1 --> interval t inside polytope poly
+  std::vector<GRBVar> binaries = addVarsBatch(N_ * n_polytopes, 0, 1, GRB_BINARY, [n_polytopes](int i) {
+    return "s" + std::to_string(i % n_polytopes) + "_" + std::to_string(i / n_polytopes);
+  });
+  ConstrBatch batch;
+  std::vector<double> ones(n_polytopes, 1.0);
+  for (int t = 0; t < N_; t++)
+  {
+    b.push_back(std::vector<GRBVar>(binaries.begin() + t * n_polytopes, binaries.begin() + (t + 1) * n_polytopes));
+    batch.add(ones.data(), b[t].data(), n_polytopes, GRB_EQUAL, 1, GRB_NAME("At_least_1_pol_t_" + std::to_string(t)));
+  }
+  at_least_1_pol_cons = addBatch(batch);
+
+  if (monotone_binaries_ == true)
+  {
+    // The index of the polytope, sum(poly * b[t][poly]), starts at 0, grows by 0 or 1 each interval and ends at the
+    // last polytope: no going back to a polytope, no skipping one. The right-hand side of Last_pol (order_cons[1]) is
+    // the last polytope used (see setPolytopesConstraints())
+    ConstrBatch order;
+    order.add({ 1 }, { b[0][0] }, GRB_EQUAL, 1, GRB_NAME("First_pol"));
+    std::vector<double> coeffs;
+    std::vector<GRBVar> vars;
+    for (int poly = 1; poly < n_polytopes; poly++)
+    {
+      coeffs.push_back(poly);
+      vars.push_back(b[N_ - 1][poly]);
+    }
+    order.add(coeffs.data(), vars.data(), vars.size(), GRB_EQUAL, n_polytopes - 1, GRB_NAME("Last_pol"));
+    for (int t = 0; t < N_ - 1; t++)
+    {
+      coeffs.clear();
+      vars.clear();
+      for (int poly = 1; poly < n_polytopes; poly++)
+      {
+        coeffs.push_back(poly);
+        vars.push_back(b[t + 1][poly]);
+        coeffs.push_back(-poly);
+        vars.push_back(b[t][poly]);
+      }
+      order.add(coeffs.data(), vars.data(), vars.size(), GRB_GREATER_EQUAL, 0,
+                GRB_NAME("Pol_order_t_" + std::to_string(t)));
+      order.add(coeffs.data(), vars.data(), vars.size(), GRB_LESS_EQUAL, 1,
+                GRB_NAME("Pol_no_skip_t_" + std::to_string(t)));
+    }
+    order_cons = addBatch(order);
+  }
+
+  if (lazy_faces_ == true)
+  {
+    // One slack per control point and polytope, shared by its faces: A_face * cp - s <= b_face for the faces in the
+    // model and b[t][poly]==1 --> s <= 0. The face rows are added in setLazyFaceConstraints() and separateFaces()
+    s = addVarsBatch(N_ * 4 * n_polytopes, 0, GRB_INFINITY, GRB_CONTINUOUS,
+                     [](int i) { return "slack" + std::to_string(i); });
+    separation_vars_.clear();
+    for (int t = 0; t < N_; t++)
+    {
+      for (int k = 0; k < 4; k++)
+      {
+        for (int axis = 0; axis < 3; axis++)
+        {
+          separation_vars_.push_back(getCPVar(t, k, axis));
+        }
+        for (int poly = 0; poly < n_polytopes; poly++)
+        {
+          GRBLinExpr slack = s[(t * 4 + k) * n_polytopes + poly];
+          polytopes_cons.push_back(m.addGenConstrIndicator(b[t][poly], 1, slack, GRB_LESS_EQUAL, 0));
+        }
+      }
+    }
+    separation_vars_.insert(separation_vars_.end(), binaries.begin(), binaries.end());
+    return;
+  }
+
+  // Face constraints (the coefficients 1 are placeholders, see setPolytopesConstraints()), in faceIndex() order
+  s = addVarsBatch(N_ * 4 * n_polytopes * n_faces, 0, GRB_INFINITY, GRB_CONTINUOUS,
+                   [](int i) { return "slack" + std::to_string(i); });
+  ConstrBatch faces;
+  for (int t = 0; t < N_; t++)
+  {
+    for (int k = 0; k < 4; k++)
+    {
+      for (int poly = 0; poly < n_polytopes; poly++)
+      {
+        for (int face = 0; face < n_faces; face++)
+        {
+          int index = faceIndex(t, k, poly, face);
+          faces.add({ 1, 1, 1, -1 }, { getCPVar(t, k, 0), getCPVar(t, k, 1), getCPVar(t, k, 2), s[index] },
+                    GRB_LESS_EQUAL, 0, GRB_NAME("Face_" + std::to_string(index)));
+        }
+      }
+    }
+  }
+  face_cons = addBatch(faces);
 
-  for (int i = 0; i < X_temp_.size(); i++)
+  // There is no batch version of the indicators in the C++ API
+  polytopes_cons.reserve(s.size());
+  for (int t = 0; t < N_; t++)
   {
-    t = t + DC;
-    if (t > dt_ * (interval + 1))
+    for (int k = 0; k < 4; k++)
     {
-      interval = std::min(interval + 1, N_ - 1);
+      for (int poly = 0; poly < n_polytopes; poly++)
+      {
+        for (int face = 0; face < n_faces; face++)
+        {
+          int index = faceIndex(t, k, poly, face);
+          polytopes_cons.push_back(m.addGenConstrIndicator(b[t][poly], 1, GRBLinExpr(s[index]), GRB_LESS_EQUAL, 0));
+        }
+      }
     }
+  }
+}
+
+void SolverGurobi::warmUp(int n_polytopes, int n_faces)
+{
+  if (qp_workers_.empty() == true)  // Otherwise the MIQP is not used, see prepareModel()
+  {
+    setPolytopesStructure(n_polytopes, n_faces);
+    m.update();
+  }
+  for (auto& worker : factor_workers_)
+  {
+    worker->warmUp(n_polytopes, n_faces);
+  }
+  for (auto& worker : qp_workers_)
+  {
+    worker->warmUp(n_polytopes, n_faces);
+  }
+}
+
+// The structure is rebuilt only if the number of polytopes changes or if a polytope has more faces than the ones built.
+// Otherwise only the normals (coefficients) and the offsets (right-hand sides) of the faces are changed
+void SolverGurobi::setPolytopesConstraints()
+{
+  int n_polytopes = polytopes_.size();
+  int n_faces = 0;
+  for (const LinearConstraint3D& polytope : polytopes_)
+  {
+    n_faces = std::max(n_faces, (int)polytope.b_.rows());
+  }
+
+  bool lazy = (lazy_faces_ == true && convex_ == false);
+  if (n_polytopes > built_polytopes_ || (n_faces > built_faces_ && lazy == false))
+  {
+    setPolytopesStructure(n_polytopes, n_faces);
+  }
+  if (convex_ == false && n_polytopes != used_polytopes_)
+  {
+    setUsedPolytopes(n_polytopes);
+  }
+  if (lazy == true)
+  {
+    built_faces_ = n_faces;  // Only used by faceIndex(): the structure doesn't depend on the faces
+    setLazyFaceConstraints();
+    return;
+  }
+  if (convex_ == true && assignment_.size() != N_)
+  {
+    assignment_ = std::vector<int>(N_, 0);
+  }
 
-    double posx = getPos(interval, t - interval * dt_, 0).getValue();
-    double posy = getPos(interval, t - interval * dt_, 1).getValue();
-    double posz = getPos(interval, t - interval * dt_, 2).getValue();
+  std::vector<GRBConstr> constrs;
+  std::vector<GRBVar> vars;
+  std::vector<double> coeffs;
+  std::vector<double> rhs(face_cons.size());
+  constrs.reserve(3 * face_cons.size());
+  vars.reserve(3 * face_cons.size());
+  coeffs.reserve(3 * face_cons.size());
 
-    double velx = getVel(interval, t - interval * dt_, 0).getValue();
-    double vely = getVel(interval, t - interval * dt_, 1).getValue();
-    double velz = getVel(interval, t - interval * dt_, 2).getValue();
+  for (int t = 0; t < N_; t++)
+  {
+    for (int k = 0; k < 4; k++)
+    {
+      for (int poly = 0; poly < built_polytopes_; poly++)
+      {
+        if (convex_ == true && poly != assignment_[t])
+        {
+          continue;
+        }
+        const LinearConstraint3D* polytope = (poly < n_polytopes) ? &polytopes_[poly] : nullptr;
+        for (int face = 0; face < built_faces_; face++)
+        {
+          int index = faceIndex(t, k, (convex_ == true) ? 0 : poly, face);
+          bool padding = (polytope == nullptr || face >= polytope->b_.rows());
+          for (int axis = 0; axis < 3; axis++)
+          {
+            constrs.push_back(face_cons[index]);
+            vars.push_back(getCPVar(t, k, axis));
+            coeffs.push_back(padding ? 0.0 : polytope->A_(face, axis));
+          }
+          rhs[index] = padding ? 0.0 : polytope->b_(face);
+        }
+      }
+    }
+  }
 
-    double accelx = getAccel(interval, t - interval * dt_, 0).getValue();
-    double accely = getAccel(interval, t - interval * dt_, 1).getValue();
-    double accelz = getAccel(interval, t - interval * dt_, 2).getValue();
+  if (constrs.size() > 0)
+  {
+    m.chgCoeffs(constrs.data(), vars.data(), coeffs.data(), constrs.size());
+    m.set(GRB_DoubleAttr_RHS, face_cons.data(), rhs.data(), face_cons.size());
+  }
+}
 
-    double jerkx = getJerk(interval, t - interval * dt_, 0).getValue();
-    double jerky = getJerk(interval, t - interval * dt_, 1).getValue();
-    double jerkz = getJerk(interval, t - interval * dt_, 2).getValue();
+// The binaries of the polytopes after the first n_polytopes are fixed to 0 (the faces of those polytopes are padding),
+// so a model built for more polytopes solves the problem of n_polytopes without being rebuilt
+void SolverGurobi::setUsedPolytopes(int n_polytopes)
+{
+  std::vector<GRBVar> vars;
+  std::vector<double> ubs;
+  for (int t = 0; t < N_; t++)
+  {
+    for (int poly = 0; poly < built_polytopes_; poly++)
+    {
+      vars.push_back(b[t][poly]);
+      ubs.push_back((poly < n_polytopes) ? 1.0 : 0.0);
+    }
+  }
+  m.set(GRB_DoubleAttr_UB, vars.data(), ubs.data(), vars.size());
+  if (monotone_binaries_ == true)
+  {
+    order_cons[1].set(GRB_DoubleAttr_RHS, n_polytopes - 1);  // Last_pol
+  }
+  used_polytopes_ = n_polytopes;
+}
 
-    state state_i;
-    state_i.setPos(posx, posy, posz);
-    state_i.setVel(velx, vely, velz);
-    state_i.setAccel(accelx, accely, accelz);
-    state_i.setJerk(jerkx, jerky, jerkz);
-    X_temp_[i] = (state_i);
+// Instead of all the faces of all the polytopes for all the control points, the model starts with the faces of each
+// polytope closer than lazy_faces_margin_ to its segment of guide_path_ (all the faces if there is no guide path for
+// these polytopes). When an incumbent violates a face that is not in the model, separateFaces() adds it as a lazy
+// constraint. The faces found in one optimization don't depend on dt, so they are added to the model for the next
+// trials (see callOptimizer())
+void SolverGurobi::setLazyFaceConstraints()
+{
+  for (GRBConstr& constr : face_cons)
+  {
+    m.remove(constr);
   }
+  face_cons.clear();
+  lazy_faces_found_.clear();
+  face_in_model_.assign(N_ * 4 * built_polytopes_ * built_faces_, 0);
 
-  // }  // End pragma parallel
+  bool has_path = (guide_path_.size() == polytopes_.size() + 1);
+  std::vector<int> faces;
+  for (int poly = 0; poly < polytopes_.size(); poly++)  // The rest are padding (see setUsedPolytopes())
+  {
+    const LinearConstraint3D& polytope = polytopes_[poly];
+    for (int face = 0; face < polytope.b_.rows(); face++)
+    {
+      if (has_path == true)
+      {
+        // The segment is inside the polytope: its distance to the plane of the face is the one of its closest end
+        double norm = polytope.A_.row(face).norm();
+        double distance = std::min(polytope.b_(face) - polytope.A_.row(face).dot(guide_path_[poly]),
+                                   polytope.b_(face) - polytope.A_.row(face).dot(guide_path_[poly + 1]));
+        if (distance > lazy_faces_margin_ * norm)
+        {
+          continue;
+        }
+      }
+      for (int t = 0; t < N_; t++)
+      {
+        for (int k = 0; k < 4; k++)
+        {
+          faces.push_back(faceIndex(t, k, poly, face));
+        }
+      }
+    }
+  }
+  addFaceRows(faces);
+}
 
-  // Force the final input to be 0 (I'll keep applying this input if when I arrive to the final state I still
-  // haven't planned again).
-  X_temp_[X_temp_.size() - 1].vel = Eigen::Vector3d::Zero().transpose();
-  X_temp_[X_temp_.size() - 1].accel = Eigen::Vector3d::Zero().transpose();
-  X_temp_[X_temp_.size() - 1].jerk = Eigen::Vector3d::Zero().transpose();
+void SolverGurobi::addFaceRows(const std::vector<int>& faces)
+{
+  ConstrBatch batch;
+  for (int index : faces)
+  {
+    int face = index % built_faces_;
+    int slack = index / built_faces_;  // (t * 4 + k) * built_polytopes_ + poly
+    int poly = slack % built_polytopes_;
+    int t = slack / built_polytopes_ / 4;
+    int k = (slack / built_polytopes_) % 4;
+    const LinearConstraint3D& polytope = polytopes_[poly];
+    batch.add({ polytope.A_(face, 0), polytope.A_(face, 1), polytope.A_(face, 2), -1 },
+              { getCPVar(t, k, 0), getCPVar(t, k, 1), getCPVar(t, k, 2), s[slack] }, GRB_LESS_EQUAL, polytope.b_(face),
+              GRB_NAME("Face_" + std::to_string(index)));
+    face_in_model_[index] = 1;
+  }
+  std::vector<GRBConstr> added = addBatch(batch);
+  face_cons.insert(face_cons.end(), added.begin(), added.end());
 }
 
-void SolverGurobi::setForceFinalConstraint(bool forceFinalConstraint)
+bool SolverGurobi::separateFaces(mycallback& cb)
 {
-  forceFinalConstraint_ = forceFinalConstraint;
+  double* values = cb.getSolution(separation_vars_.data(), separation_vars_.size());
+  const double* b_values = values + N_ * 4 * 3;
+  bool added = false;
+  for (int t = 0; t < N_; t++)
+  {
+    for (int poly = 0; poly < polytopes_.size(); poly++)
+    {
+      if (b_values[t * built_polytopes_ + poly] < 0.5)
+      {
+        continue;
+      }
+      const LinearConstraint3D& polytope = polytopes_[poly];
+      for (int k = 0; k < 4; k++)
+      {
+        Eigen::Vector3d cp(values + (t * 4 + k) * 3);
+        for (int face = 0; face < polytope.b_.rows(); face++)
+        {
+          int index = faceIndex(t, k, poly, face);
+          if (face_in_model_[index] == 1 || polytope.A_.row(face).dot(cp) - polytope.b_(face) <= 1e-6)
+          {
+            continue;
+          }
+          double coeffs[4] = { polytope.A_(face, 0), polytope.A_(face, 1), polytope.A_(face, 2), -1 };
+          GRBVar vars[4] = { getCPVar(t, k, 0), getCPVar(t, k, 1), getCPVar(t, k, 2),
+                             s[(t * 4 + k) * built_polytopes_ + poly] };
+          GRBLinExpr expr;
+          expr.addTerms(coeffs, vars, 4);
+          cb.addLazy(expr, GRB_LESS_EQUAL, polytope.b_(face));
+          face_in_model_[index] = 1;
+          lazy_faces_found_.push_back(index);
+          added = true;
+        }
+      }
+    }
+  }
+  delete[] values;
+  return added;
 }
 
-void SolverGurobi::setPolytopes(std::vector<LinearConstraint3D> polytopes)
-{
-  polytopes_ = polytopes;
+void SolverGurobi::setLazyFaces(bool lazy_faces, double margin)
+{
+  lazy_faces_ = lazy_faces;
+  lazy_faces_margin_ = margin;
+  cb_.lazy_solver_ = (lazy_faces == true) ? this : nullptr;
+  m.set(GRB_IntParam_LazyConstraints, (lazy_faces == true) ? 1 : 0);
+  built_polytopes_ = -1;  // Rebuilt in the next setPolytopesConstraints()
+}
+
+void SolverGurobi::setDC(double dc)
+{
+  DC = dc;
+}
+
+void SolverGurobi::setX0(state& data)
+{
+  Eigen::Vector3d pos = data.pos;
+  Eigen::Vector3d vel = data.vel;
+  Eigen::Vector3d accel = data.accel;
+
+  x0_[0] = data.pos.x();
+  x0_[1] = data.pos.y();
+  x0_[2] = data.pos.z();
+  x0_[3] = data.vel.x();
+  x0_[4] = data.vel.y();
+  x0_[5] = data.vel.z();
+  x0_[6] = data.accel.x();
+  x0_[7] = data.accel.y();
+  x0_[8] = data.accel.z();
+}
+
+void SolverGurobi::setXf(state& data)
+{
+  Eigen::Vector3d pos = data.pos;
+  Eigen::Vector3d vel = data.vel;
+  Eigen::Vector3d accel = data.accel;
+
+  xf_[0] = data.pos.x();
+  xf_[1] = data.pos.y();
+  xf_[2] = data.pos.z();
+  xf_[3] = data.vel.x();
+  xf_[4] = data.vel.y();
+  xf_[5] = data.vel.z();
+  xf_[6] = data.accel.x();
+  xf_[7] = data.accel.y();
+  xf_[8] = data.accel.z();
+}
+
+// Structure built once (and again if forceFinalConstraint_ changes). Only the right-hand sides are changed here, the
+// coefficients (that depend on dt) are changed in setDTCoefficients()
+void SolverGurobi::setConstraintsXf()
+{
+  if (final_cons.size() == 0 || built_final_pos_ != forceFinalConstraint_)
+  {
+    for (GRBConstr& constr : final_cons)
+    {
+      m.remove(constr);
+    }
+    final_cons.clear();
+    built_final_pos_ = forceFinalConstraint_;
+
+    ConstrBatch batch;
+    if (controlPoints() == true)
+    {
+      // Pos P3, vel 3 (P3 - P2) / dt and accel 6 (P3 - 2 P2 + P1) / dt^2 (right-hand sides in setDTRightHandSides())
+      const std::vector<GRBVar>& pN = p[N_ - 1];
+      for (int i = 0; i < 3; i++)
+      {
+        if (forceFinalConstraint_ == true)
+        {
+          batch.add({ 1 }, { pN[9 + i] }, GRB_EQUAL, 0, GRB_NAME("FinalPosAxis_" + std::to_string(i)));
+        }
+        batch.add({ 1, -1 }, { pN[9 + i], pN[6 + i] }, GRB_EQUAL, 0, GRB_NAME("FinalVelAxis_" + std::to_string(i)));
+        batch.add({ 1, -2, 1 }, { pN[9 + i], pN[6 + i], pN[3 + i] }, GRB_EQUAL, 0,
+                  GRB_NAME("FinalAccel_" + std::to_string(i)));
+      }
+      final_cons = addBatch(batch);
+      return;
+    }
+
+    // Constraint xT==x_final (the coefficients 1 are placeholders, see setDTCoefficients())
+    const std::vector<GRBVar>& xN = x[N_ - 1];
+    for (int i = 0; i < 3; i++)
+    {
+      if (forceFinalConstraint_ == true)
+      {
+        batch.add({ 1, 1, 1, 1 }, { xN[i], xN[3 + i], xN[6 + i], xN[9 + i] }, GRB_EQUAL, 0,
+                  GRB_NAME("FinalPosAxis_" + std::to_string(i)));  // Final position
+      }
+      batch.add({ 1, 1, 1 }, { xN[i], xN[3 + i], xN[6 + i] }, GRB_EQUAL, 0,
+                GRB_NAME("FinalVelAxis_" + std::to_string(i)));  // Final velocity
+      batch.add({ 1, 2 }, { xN[i], xN[3 + i] }, GRB_EQUAL, 0,
+                GRB_NAME("FinalAccel_" + std::to_string(i)));  // Final acceleration
+    }
+    final_cons = addBatch(batch);
+  }
+
+  if (formulation_ != COEFFICIENTS)
+  {
+    return;  // See setDTRightHandSides()
+  }
+
+  std::vector<double> rhs;
+  for (int i = 0; i < 3; i++)
+  {
+    if (forceFinalConstraint_ == true)
+    {
+      rhs.push_back(xf_[i]);
+    }
+    rhs.push_back(xf_[i + 3]);
+    rhs.push_back(xf_[i + 6]);
+  }
+  m.set(GRB_DoubleAttr_RHS, final_cons.data(), rhs.data(), final_cons.size());
+}
+
+// x0 only appears in the right-hand sides: the constraints are built once
+void SolverGurobi::setConstraintsX0()
+{
+  if (init_cons.size() == 0)
+  {
+    // Constraint x0==x_initial (BEZIER and MINVO: pos P0, vel 3 (P1 - P0) / dt and accel 6 (P2 - 2 P1 + P0) / dt^2)
+    ConstrBatch batch;
+    for (int i = 0; i < 3; i++)
+    {
+      std::string axis = GRB_NAME("Axis_" + std::to_string(i));
+      if (controlPoints() == true)
+      {
+        batch.add({ 1 }, { p[0][i] }, GRB_EQUAL, 0, GRB_NAME("InitialPos" + axis));
+        batch.add({ -1, 1 }, { p[0][i], p[0][3 + i] }, GRB_EQUAL, 0, GRB_NAME("InitialVel" + axis));
+        batch.add({ 1, -2, 1 }, { p[0][i], p[0][3 + i], p[0][6 + i] }, GRB_EQUAL, 0, GRB_NAME("InitialAccel" + axis));
+        continue;
+      }
+      batch.add({ 1 }, { x[0][9 + i] }, GRB_EQUAL, 0, GRB_NAME("InitialPos" + axis));
+      batch.add({ 1 }, { x[0][6 + i] }, GRB_EQUAL, 0, GRB_NAME("InitialVel" + axis));
+      batch.add({ 2 }, { x[0][3 + i] }, GRB_EQUAL, 0, GRB_NAME("InitialAccel" + axis));
+    }
+    init_cons = addBatch(batch);
+  }
+  if (formulation_ != COEFFICIENTS)
+  {
+    return;  // See setDTRightHandSides()
+  }
+
+  std::vector<double> rhs;
+  for (int i = 0; i < 3; i++)
+  {
+    rhs.push_back(x0_[i]);
+    rhs.push_back(x0_[i + 3]);
+    rhs.push_back(x0_[i + 6]);
+  }
+  m.set(GRB_DoubleAttr_RHS, init_cons.data(), rhs.data(), init_cons.size());
+}
+
+void SolverGurobi::resetX()
+{
+  int size = (int)(N_)*dt_ / DC;
+  size = (size < 2) ? 2 : size;  // force size to be at least 2
+  std::vector<state> tmp(size);
+  X_temp_ = tmp;
+}
+
+void SolverGurobi::setMaxConstraints()
+{
+  if (controlPoints() == true)
+  {
+    // Same limits with the control points: 3 (P1 - P0) / dt, 6 (P2 - 2 P1 + P0) / dt^2 and 6 (P3 - 3 P2 + 3 P1 - P0) /
+    // dt^3 (right-hand sides in setDTRightHandSides())
+    ConstrBatch batch;
+    for (int t = 0; t < N_; t++)
+    {
+      const std::vector<GRBVar>& pt = p[t];
+      for (int i = 0; i < 3; i++)
+      {
+        std::string suffix = GRB_NAME("_t" + std::to_string(t) + "_axis_" + std::to_string(i));
+        batch.add({ -1, 1 }, { pt[i], pt[3 + i] }, GRB_LESS_EQUAL, 0, GRB_NAME("MaxVel" + suffix));
+        batch.add({ -1, 1 }, { pt[i], pt[3 + i] }, GRB_GREATER_EQUAL, 0, GRB_NAME("MinVel" + suffix));
+
+        batch.add({ 1, -2, 1 }, { pt[i], pt[3 + i], pt[6 + i] }, GRB_LESS_EQUAL, 0, GRB_NAME("MaxAccel" + suffix));
+        batch.add({ 1, -2, 1 }, { pt[i], pt[3 + i], pt[6 + i] }, GRB_GREATER_EQUAL, 0, GRB_NAME("MinAccel" + suffix));
+
+        batch.add({ -1, 3, -3, 1 }, { pt[i], pt[3 + i], pt[6 + i], pt[9 + i] }, GRB_LESS_EQUAL, 0,
+                  GRB_NAME("MaxJerk" + suffix));
+        batch.add({ -1, 3, -3, 1 }, { pt[i], pt[3 + i], pt[6 + i], pt[9 + i] }, GRB_GREATER_EQUAL, 0,
+                  GRB_NAME("MinJerk" + suffix));
+      }
+    }
+    max_cons = addBatch(batch);
+    return;
+  }
+
+  // Constraint v<=vmax, a<=amax, u<=umax at the start of each interval: c, 2b and 6a (NORMALIZED: c <= vmax * dt,
+  // 2b <= amax * dt^2 and 6a <= umax * dt^3, right-hand sides in setDTRightHandSides())
+  ConstrBatch batch;
+  for (int t = 0; t < N_; t++)
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      std::string suffix = GRB_NAME("_t" + std::to_string(t) + "_axis_" + std::to_string(i));
+      batch.add({ 1 }, { x[t][6 + i] }, GRB_LESS_EQUAL, v_max_, GRB_NAME("MaxVel" + suffix));
+      batch.add({ 1 }, { x[t][6 + i] }, GRB_GREATER_EQUAL, -v_max_, GRB_NAME("MinVel" + suffix));
+
+      batch.add({ 2 }, { x[t][3 + i] }, GRB_LESS_EQUAL, a_max_, GRB_NAME("MaxAccel" + suffix));
+      batch.add({ 2 }, { x[t][3 + i] }, GRB_GREATER_EQUAL, -a_max_, GRB_NAME("MinAccel" + suffix));
+
+      batch.add({ 6 }, { x[t][i] }, GRB_LESS_EQUAL, j_max_, GRB_NAME("MaxJerk" + suffix));
+      batch.add({ 6 }, { x[t][i] }, GRB_GREATER_EQUAL, -j_max_, GRB_NAME("MinJerk" + suffix));
+    }
+  }
+  max_cons = addBatch(batch);
+}
+
+void SolverGurobi::setBounds(double max_values[3])
+{
+  v_max_ = max_values[0];
+  a_max_ = max_values[1];
+  j_max_ = max_values[2];
+
+  setMaxConstraints();
+}
+
+void SolverGurobi::setMonotoneBinaries(bool monotone_binaries)
+{
+  monotone_binaries_ = monotone_binaries;
+  built_polytopes_ = -1;  // Rebuilt in the next setPolytopesConstraints()
+}
+
+void SolverGurobi::setWarmStart(bool warm_start)
+{
+  warm_start_ = warm_start;
+}
+
+void SolverGurobi::setFactorBisection(bool factor_bisection)
+{
+  factor_bisection_ = factor_bisection;
+}
+
+void SolverGurobi::setFactorInitialAndFinalAndIncrement(double factor_initial, double factor_final,
+                                                        double factor_increment)
+{
+  factor_initial_ = factor_initial;
+  factor_final_ = factor_final;
+  factor_increment_ = factor_increment;
+}
+
+// The factors factor_initial_, factor_initial_ + factor_increment_, ... <= factor_final_ are tried in this solver and
+// its factor workers (see setParallelFactors()), and the smallest factor that is feasible is used. With
+// factor_bisection_=false they are distributed round robin and each solver tries its factors in ascending order (see
+// tryFactors()). With factor_bisection_=true the smallest feasible factor is bracketed with bisection (see
+// bisectFactors())
+bool SolverGurobi::genNewTraj()
+{
+  /*  std::cout << "A is\n";
+    std::cout << polytopes_[0].A() << std::endl;
+    std::cout << "B es esto:\n";
+    std::cout << polytopes_[0].b().transpose() << std::endl;
+    std::cout << "Number of rows= " << bb.rows() << std::endl;*/
+
+  if (factor_initial_ < 1)
+  {
+    FASTER_WARN("factor_initial_ is less than one, it doesn't make sense");
+  }
+
+  std::vector<double> factors;
+  for (double i = factor_initial_; i <= factor_final_; i = i + factor_increment_)
+  {
+    factors.push_back(i);
+  }
+
+  gen_start_ = std::chrono::steady_clock::now();
+  first_incumbent_ms_ = -1;
+  if (warm_start_ == true && warm_x_sol_.empty() == false)
+  {
+    warm_shift_ = closestTime(warm_x_sol_, warm_dt_sol_, Eigen::Vector3d(x0_[0], x0_[1], x0_[2]));
+  }
+
+  std::vector<SolverGurobi*> solvers = { this };
+  for (auto& worker : factor_workers_)
+  {
+    // Same problem
+    std::copy(std::begin(x0_), std::end(x0_), std::begin(worker->x0_));
+    std::copy(std::begin(xf_), std::end(xf_), std::begin(worker->xf_));
+    worker->polytopes_ = polytopes_;
+    worker->guide_path_ = guide_path_;
+    worker->forceFinalConstraint_ = forceFinalConstraint_;
+    worker->deadline_ = deadline_;
+    worker->gen_start_ = gen_start_;
+    worker->warm_start_ = warm_start_;
+    worker->warm_x_sol_ = warm_x_sol_;
+    worker->warm_dt_sol_ = warm_dt_sol_;
+    worker->warm_shift_ = warm_shift_;
+    solvers.push_back(worker.get());
+  }
+  for (SolverGurobi* solver : solvers)
+  {
+    solver->current_factor_ = -1;
+    solver->cb_.cancel_trial_ = false;
+    solver->trials_ = 0;
+    solver->runtime_ms_ = 0;
+    solver->node_count_ = 0;
+    solver->iterations_ = 0;
+    solver->numeric_issues_ = 0;
+  }
+
+  int best = factors.size();  // Index of the smallest factor that worked
+  if (factor_bisection_ == true)
+  {
+    best = bisectFactors(factors, solvers);
+  }
+  else
+  {
+    std::atomic<int> best_sweep(factors.size());
+    std::vector<std::future<void>> futures;
+    for (int j = 1; j < solvers.size(); j++)
+    {
+      futures.push_back(std::async(std::launch::async, &SolverGurobi::tryFactors, solvers[j], std::cref(factors), j,
+                                   std::ref(best_sweep), std::cref(solvers)));
+    }
+    tryFactors(factors, 0, best_sweep, solvers);
+    for (std::future<void>& future : futures)
+    {
+      future.wait();
+    }
+    best = best_sweep;
+    if (best < factors.size() && solvers[best % solvers.size()] != this)
+    {
+      SolverGurobi* winner = solvers[best % solvers.size()];
+      x_sol_ = winner->x_sol_;
+      dt_sol_ = winner->dt_sol_;
+      first_incumbent_ms_ = winner->first_incumbent_ms_;
+    }
+  }
+
+  for (auto& worker : factor_workers_)
+  {
+    trials_ = trials_ + worker->trials_;
+    runtime_ms_ = runtime_ms_ + worker->runtime_ms_;
+    node_count_ = node_count_ + worker->node_count_;
+    iterations_ = iterations_ + worker->iterations_;
+    numeric_issues_ = numeric_issues_ + worker->numeric_issues_;
+  }
+
+  bool solved = (best < factors.size());
+  if (solved == true)
+  {
+    factor_that_worked_ = factors[best];
+    dt_ = dt_sol_;
+    // Warm start of the next genNewTraj() (if this one fails, the drone keeps following the last solution, so that one
+    // is kept)
+    warm_x_sol_ = x_sol_;
+    warm_dt_sol_ = dt_sol_;
+  }
+
+  for (SolverGurobi* solver : solvers)
+  {
+    solver->cb_.should_terminate_ = false;  // Should be at the end of genNewTaj, not at the beginning
+  }
+
+  return solved;
+}
+
+// The model is updated in place: X0, Xf and the polytopes are set once per genNewTraj(), and each trial only changes
+// the coefficients that depend on dt
+void SolverGurobi::prepareModel()
+{
+  if (qp_workers_.empty() == false)
+  {
+    return;  // The MIQP is not used, see solveAssignments()
+  }
+  setDynamicConstraints();
+  setPolytopesConstraints();
+  setConstraintsX0();
+  setConstraintsXf();
+  setObjective();
+}
+
+// Seconds until deadline_ (1e100, the default TimeLimit of Gurobi, if there is no deadline)
+double SolverGurobi::timeLeft()
+{
+  if (deadline_ == std::chrono::steady_clock::time_point::max())
+  {
+    return 1e100;
+  }
+  return std::chrono::duration<double>(deadline_ - std::chrono::steady_clock::now()).count();
+}
+
+// One MIQP with the dt given by factor. If it's solved, the solution is saved in x_sol_ and dt_sol_ (later trials of
+// this model don't overwrite it)
+bool SolverGurobi::tryFactor(double factor)
+{
+  // The deadline may have passed since the caller checked it, and a negative TimeLimit throws
+  m.set("TimeLimit", std::to_string(std::max(0.0, timeLeft())));
+
+  trials_ = trials_ + 1;
+  findDT(factor);
+  // std::cout << "Going to try with dt_= " << dt_ << ", should_terminate_=" << cb_.should_terminate_ << std::endl;
+  if (qp_workers_.empty() == false)
+  {
+    return solveAssignments();
+  }
+  setDTCoefficients();
+  setWarmStartValues();
+
+  cb_.got_incumbent_ = false;
+  bool solved = callOptimizer();
+  /*    if (solved == true)
+      {
+        solved = isWmaxSatisfied();
+      }*/
+  if (solved == false || cb_.cancel_trial_ == true)
+  {
+    return false;
+  }
+
+  readSolution(x_sol_);
+  dt_sol_ = dt_;
+  std::chrono::steady_clock::time_point incumbent =
+      (cb_.got_incumbent_ == true) ? cb_.first_incumbent_ : std::chrono::steady_clock::now();
+  first_incumbent_ms_ = std::chrono::duration<double, std::milli>(incumbent - gen_start_).count();
+  return true;
+}
+
+// Instead of the MIQP, each monotone assignment (see monotoneAssignments()) is solved as a convex QP (the polytope of
+// each interval is fixed, no binaries nor indicators) in the qp_workers_, that solve their share of the assignments
+// concurrently. The feasible one with the lowest cost is saved in x_sol_
+bool SolverGurobi::solveAssignments()
+{
+  std::vector<std::vector<int>> assignments = monotoneAssignments(N_, polytopes_.size());
+
+  std::vector<SolverGurobi*> workers;
+  for (auto& worker : qp_workers_)
+  {
+    std::copy(std::begin(x0_), std::end(x0_), std::begin(worker->x0_));
+    std::copy(std::begin(xf_), std::end(xf_), std::begin(worker->xf_));
+    worker->polytopes_ = polytopes_;
+    worker->forceFinalConstraint_ = forceFinalConstraint_;
+    worker->dt_ = dt_;
+    worker->runtime_ms_ = 0;
+    worker->iterations_ = 0;
+    worker->numeric_issues_ = 0;
+    worker->qp_cost_ = std::numeric_limits<double>::max();
+    workers.push_back(worker.get());
+  }
+
+  auto solveShare = [&](int first) {
+    SolverGurobi* worker = workers[first];
+    worker->prepareModel();
+    worker->setDTCoefficients();
+    for (int i = first; i < assignments.size(); i = i + workers.size())
+    {
+      if (cb_.should_terminate_ == true || cb_.cancel_trial_ == true || timeLeft() <= 0)
+      {
+        break;
+      }
+      worker->m.set("TimeLimit", std::to_string(std::max(0.0, timeLeft())));  // Negative if the deadline just passed
+      worker->assignment_ = assignments[i];
+      worker->setPolytopesConstraints();
+      if (worker->callOptimizer() == true)
+      {
+        double cost = worker->m.get(GRB_DoubleAttr_ObjVal);
+        if (cost < worker->qp_cost_)
+        {
+          worker->qp_cost_ = cost;
+          worker->readSolution(worker->x_sol_);
+          worker->first_incumbent_ms_ =
+              std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - gen_start_).count();
+        }
+      }
+    }
+  };
+
+  std::vector<std::future<void>> futures;
+  for (int j = 1; j < workers.size(); j++)
+  {
+    futures.push_back(std::async(std::launch::async, solveShare, j));
+  }
+  solveShare(0);
+  for (std::future<void>& future : futures)
+  {
+    future.wait();
+  }
+
+  SolverGurobi* best = nullptr;
+  for (SolverGurobi* worker : workers)
+  {
+    runtime_ms_ = runtime_ms_ + worker->runtime_ms_;
+    iterations_ = iterations_ + worker->iterations_;
+    numeric_issues_ = numeric_issues_ + worker->numeric_issues_;
+    if (worker->qp_cost_ < std::numeric_limits<double>::max() && (best == nullptr || worker->qp_cost_ < best->qp_cost_))
+    {
+      best = worker;
+    }
+  }
+  if (best == nullptr || cb_.cancel_trial_ == true)
+  {
+    return false;
+  }
+  x_sol_ = best->x_sol_;
+  dt_sol_ = dt_;
+  first_incumbent_ms_ = best->first_incumbent_ms_;
+  return true;
+}
+
+void SolverGurobi::setMonotoneQP(int n)
+{
+  qp_workers_.clear();
+  double max_values[3] = { v_max_, a_max_, j_max_ };
+  for (int i = 0; i < n; i++)
+  {
+    SolverGurobi* worker = new SolverGurobi();
+    worker->convex_ = true;
+    worker->setN(N_);
+    worker->formulation_ = formulation_;
+    worker->createVars();
+    worker->setDC(DC);
+    worker->setBounds(max_values);
+    worker->setThreads(1);  // Small QPs, the parallelism is across assignments
+    worker->setVerbose(verbose_);
+    worker->setWMax(w_max_);
+    qp_workers_.push_back(std::unique_ptr<SolverGurobi>(worker));
+  }
+}
+
+// State (pos, vel, accel, jerk) at time T of the trajectory with coefficients sol (see x_sol_) and step dt. After the
+// end of the trajectory, the final position at rest
+void SolverGurobi::evalSolution(const std::vector<double>& sol, double dt, double T, double out[4][3])
+{
+  int n = sol.size() / 12;
+  int interval = std::min(std::max((int)(T / dt), 0), n - 1);
+  double tau = std::min(T - interval * dt, dt);
+  bool ended = (T > n * dt);
+  const double* c = &sol[12 * interval];
+  for (int ii = 0; ii < 3; ii++)
+  {
+    out[0][ii] = c[0 + ii] * tau * tau * tau + c[3 + ii] * tau * tau + c[6 + ii] * tau + c[9 + ii];
+    out[1][ii] = ended ? 0 : 3 * c[0 + ii] * tau * tau + 2 * c[3 + ii] * tau + c[6 + ii];
+    out[2][ii] = ended ? 0 : 6 * c[0 + ii] * tau + 2 * c[3 + ii];
+    out[3][ii] = ended ? 0 : 6 * c[0 + ii];
+  }
+}
+
+// Time of the trajectory sol (sampled every DC) closest to pos
+double SolverGurobi::closestTime(const std::vector<double>& sol, double dt, const Eigen::Vector3d& pos)
+{
+  double best_T = 0;
+  double best_dist = std::numeric_limits<double>::max();
+  double out[4][3];
+  double duration = (sol.size() / 12) * dt;
+  for (double T = 0; T <= duration; T = T + DC)
+  {
+    evalSolution(sol, dt, T, out);
+    double dist = (Eigen::Vector3d(out[0][0], out[0][1], out[0][2]) - pos).squaredNorm();
+    if (dist < best_dist)
+    {
+      best_dist = dist;
+      best_T = T;
+    }
+  }
+  return best_T;
+}
+
+// MIP start from the last solution of this solver, shifted so that it starts at the point closest to the new X0 (see
+// genNewTraj()) and resampled with the current dt_. Each interval takes the Taylor expansion of the previous
+// trajectory at its start (exact if it doesn't cross an interval of the previous one), and goes to the polytope that
+// contains its control points (or the one they violate least). The binaries are also given as hints. Gurobi completes
+// or repairs the start if it's not feasible
+void SolverGurobi::setWarmStartValues()
+{
+  if (convex_ == true || qp_workers_.empty() == false)
+  {
+    return;
+  }
+
+  // Coefficients, or Bezier control points (without repeating the shared ones)
+  std::vector<GRBVar> x_vars, b_vars;
+  for (int t = 0; t < N_; t++)
+  {
+    if (controlPoints() == false)
+    {
+      x_vars.insert(x_vars.end(), x[t].begin(), x[t].end());
+    }
+    else
+    {
+      x_vars.insert(x_vars.end(), p[t].begin(), p[t].begin() + ((t == N_ - 1) ? 12 : 9));
+    }
+    b_vars.insert(b_vars.end(), b[t].begin(), b[t].end());
+  }
+
+  if (warm_start_ == false || warm_x_sol_.empty() == true)
+  {
+    if (warm_start_set_ == true)
+    {
+      std::vector<double> undefined(std::max(x_vars.size(), b_vars.size()), GRB_UNDEFINED);
+      m.set(GRB_DoubleAttr_Start, x_vars.data(), undefined.data(), x_vars.size());
+      m.set(GRB_DoubleAttr_Start, b_vars.data(), undefined.data(), b_vars.size());
+      m.set(GRB_DoubleAttr_VarHintVal, b_vars.data(), undefined.data(), b_vars.size());
+      warm_start_set_ = false;
+    }
+    return;
+  }
+
+  std::vector<double> x_start(x_vars.size());
+  std::vector<double> b_start(b_vars.size(), 0.0);
+  double state[4][3];
+  int b_index = 0;
+  for (int t = 0; t < N_; t++)
+  {
+    evalSolution(warm_x_sol_, warm_dt_sol_, warm_shift_ + t * dt_, state);
+    double c[12];
+    for (int ii = 0; ii < 3; ii++)
+    {
+      c[0 + ii] = state[3][ii] / 6.0;
+      c[3 + ii] = state[2][ii] / 2.0;
+      c[6 + ii] = state[1][ii];
+      c[9 + ii] = state[0][ii];
+    }
+
+    // Bezier control points
+    std::vector<Eigen::Vector3d> cps(4);
+    for (int ii = 0; ii < 3; ii++)
+    {
+      double an = c[0 + ii] * dt_ * dt_ * dt_, bn = c[3 + ii] * dt_ * dt_, cn = c[6 + ii] * dt_, dn = c[9 + ii];
+      cps[0](ii) = dn;
+      cps[1](ii) = (cn + 3 * dn) / 3;
+      cps[2](ii) = (bn + 2 * cn + 3 * dn) / 3;
+      cps[3](ii) = an + bn + cn + dn;
+    }
+
+    if (formulation_ == COEFFICIENTS)
+    {
+      std::copy(c, c + 12, &x_start[12 * t]);
+    }
+    else if (formulation_ == NORMALIZED)
+    {
+      for (int ii = 0; ii < 3; ii++)
+      {
+        x_start[12 * t + 0 + ii] = c[0 + ii] * dt_ * dt_ * dt_;
+        x_start[12 * t + 3 + ii] = c[3 + ii] * dt_ * dt_;
+        x_start[12 * t + 6 + ii] = c[6 + ii] * dt_;
+        x_start[12 * t + 9 + ii] = c[9 + ii];
+      }
+    }
+    else
+    {
+      for (int k = 0; k < ((t == N_ - 1) ? 4 : 3); k++)
+      {
+        for (int ii = 0; ii < 3; ii++)
+        {
+          x_start[9 * t + 3 * k + ii] = cps[k](ii);
+        }
+      }
+    }
+    int best_poly = 0;
+    double best_violation = std::numeric_limits<double>::max();
+    for (int poly = 0; poly < b[t].size() && poly < polytopes_.size(); poly++)
+    {
+      double violation = -std::numeric_limits<double>::max();
+      for (const Eigen::Vector3d& cp : cps)
+      {
+        violation = std::max(violation, (polytopes_[poly].A_ * cp - polytopes_[poly].b_).maxCoeff());
+      }
+      if (violation < best_violation)
+      {
+        best_violation = violation;
+        best_poly = poly;
+      }
+    }
+    b_start[b_index + best_poly] = 1.0;
+    b_index = b_index + b[t].size();
+  }
+
+  m.set(GRB_DoubleAttr_Start, x_vars.data(), x_start.data(), x_vars.size());
+  m.set(GRB_DoubleAttr_Start, b_vars.data(), b_start.data(), b_vars.size());
+  m.set(GRB_DoubleAttr_VarHintVal, b_vars.data(), b_start.data(), b_vars.size());
+  warm_start_set_ = true;
+}
+
+// Tries the factors first, first + n_solvers, first + 2 * n_solvers,... until one of them works, a smaller one has
+// worked in another solver (best), or the deadline is reached
+void SolverGurobi::tryFactors(const std::vector<double>& factors, int first, std::atomic<int>& best,
+                              const std::vector<SolverGurobi*>& solvers)
+{
+  prepareModel();
+
+  for (int index = first; index < factors.size() && cb_.should_terminate_ == false; index = index + solvers.size())
+  {
+    current_factor_ = index;
+    if (index > best)
+    {
+      break;  // A smaller factor has already worked
+    }
+    if (timeLeft() <= 0)
+    {
+      FASTER_DEBUG("Deadline reached, no more factors tried");
+      break;
+    }
+
+    if (tryFactor(factors[index]) == true)
+    {
+      // std::cout << "Factor= " << i << "(dt_= " << dt_ << ")---> worked" << std::endl;
+      int previous = best;
+      while (index < previous && best.compare_exchange_weak(previous, index) == false)
+      {
+      }
+      // Stop the solvers that are trying larger factors (the ones that start a new factor will see best)
+      for (SolverGurobi* solver : solvers)
+      {
+        if (solver->current_factor_ > index)
+        {
+          solver->cb_.cancel_trial_ = true;
+        }
+      }
+      break;
+    }
+  }
+  current_factor_ = -1;
 }
 
-void SolverGurobi::setPolytopesConstraints()
+// Assumes that feasibility is monotone in the factor (a larger factor gives more time to every interval). The first
+// trial is the factor that worked in the previous replan (the range set by Faster is around it). Then, while there are
+// untried factors between the largest infeasible one (lo) and the smallest feasible one (hi), that bracket is split in
+// n_solvers + 1 parts, and each solver tries one of the split points. With one solver this needs ~log2(n_factors)
+// trials. Returns the index of the smallest feasible factor found (factors.size() if none), and leaves its solution
+// in x_sol_ and dt_sol_
+int SolverGurobi::bisectFactors(const std::vector<double>& factors, const std::vector<SolverGurobi*>& solvers)
 {
-  // std::cout << "Setting POLYTOPES=" << polytopes_cons.size() << std::endl;
-
-  // Remove previous polytopes constraints
-  for (int i = 0; i < polytopes_cons.size(); i++)
+  int n = factors.size();
+  int lo = -1;
+  int hi = n;
+  if (n == 0)
   {
-    m.remove(polytopes_cons[i]);
+    return n;
   }
-  polytopes_cons.clear();
 
-  // Remove previous polytopes constraints
-  for (int i = 0; i < polytope_cons.size(); i++)
+  std::vector<std::future<void>> futures;
+  for (int j = 1; j < solvers.size(); j++)
   {
-    m.remove(polytope_cons[i]);
+    futures.push_back(std::async(std::launch::async, &SolverGurobi::prepareModel, solvers[j]));
   }
-
-  polytope_cons.clear();
-
-  // Remove previous at_least_1_pol_cons constraints
-  for (int i = 0; i < at_least_1_pol_cons.size(); i++)
+  prepareModel();
+  for (std::future<void>& future : futures)
   {
-    m.remove(at_least_1_pol_cons[i]);
+    future.wait();
   }
 
-  at_least_1_pol_cons.clear();
-
-  // Remove previous binary variables  (They depend on the number of polytopes--> I can't reuse them)
-  for (int i = 0; i < b.size(); i++)
+  int seed = n / 2;
+  if (factor_that_worked_ > 0)
   {
-    for (int j = 0; j < b[i].size(); j++)
-    {
-      m.remove(b[i][j]);
-    }
+    seed = (int)std::round((factor_that_worked_ - factor_initial_) / factor_increment_);
+    seed = std::min(std::max(seed, 0), n - 1);
   }
-  b.clear();
 
-  if (polytopes_.size() > 0)  // If there are polytope constraints
+  std::vector<double> best_x_sol;
+  double best_dt_sol = 0;
+  double best_incumbent_ms = -1;
+  std::vector<int> probes = { seed };  // Ascending
+  while (probes.empty() == false && cb_.should_terminate_ == false)
   {
-    // Declare binary variables
-    for (int t = 0; t < N_ + 1; t++)
+    if (timeLeft() <= 0)
     {
-      std::vector<GRBVar> row;
-      for (int i = 0; i < polytopes_.size(); i++)  // For all the polytopes
-      {
-        GRBVar variable =
-            m.addVar(-GRB_INFINITY, GRB_INFINITY, 0, GRB_BINARY, "s" + std::to_string(i) + "_" + std::to_string(t));
-        row.push_back(variable);
-      }
-      b.push_back(row);
+      FASTER_DEBUG("Deadline reached, no more factors tried");
+      break;
     }
 
-    // std::cout << "NUMBER OF POLYTOPES=" << polytopes_.size() << std::endl;
-    // std::cout << "NUMBER OF FACES of the first polytope=" << polytopes_[0].A().rows() << std::endl;
-
-    // Polytope constraints (if binary_varible==1 --> In that polytope) and at_least_1_pol_cons (at least one polytope)
-    // constraints
-    for (int t = 0; t < N_; t++)  // Start in t=1 (because t=0 is already fixed with the initial condition)
+    std::vector<char> feasible(probes.size(), false);
+    futures.clear();
+    for (int j = 1; j < probes.size(); j++)
+    {
+      futures.push_back(std::async(std::launch::async, [&, j]() {
+        feasible[j] = solvers[j]->tryFactor(factors[probes[j]]);
+      }));
+    }
+    feasible[0] = tryFactor(factors[probes[0]]);
+    for (std::future<void>& future : futures)
     {
-      // std::cout << "*********************t= " << t << std::endl;
+      future.wait();
+    }
 
-      GRBLinExpr sum = 0;
-      for (int col = 0; col < b[0].size(); col++)
+    for (int j = 0; j < probes.size(); j++)
+    {
+      if (feasible[j] == true && probes[j] < hi)
       {
-        sum = sum + b[t][col];
+        hi = probes[j];
+        best_x_sol = solvers[j]->x_sol_;
+        best_dt_sol = solvers[j]->dt_sol_;
+        best_incumbent_ms = solvers[j]->first_incumbent_ms_;
       }
-      at_least_1_pol_cons.push_back(m.addConstr(sum == 1, "At_least_1_pol_t_" + std::to_string(t)));  // at least in
-                                                                                                      // one polytope
-
-      std::vector<GRBLinExpr> cp0 = getCP0(t);  // Control Point 0
-      std::vector<GRBLinExpr> cp1 = getCP1(t);  // Control Point 1
-      std::vector<GRBLinExpr> cp2 = getCP2(t);  // Control Point 2
-      std::vector<GRBLinExpr> cp3 = getCP3(t);  // Control Point 3
-
-      for (int n_poly = 0; n_poly < polytopes_.size(); n_poly++)  // Loop over the number of polytopes
+    }
+    for (int j = 0; j < probes.size(); j++)
+    {
+      if (feasible[j] == false && probes[j] > lo && probes[j] < hi)
       {
-        // Constraint A1x<=b1
-        Eigen::MatrixXd A1 = polytopes_[n_poly].A();
-        auto bb = polytopes_[n_poly].b();
-
-        // std::cout << "Using A1=" << A1 << std::endl;
-
-        std::vector<std::vector<double>> A1std = eigenMatrix2std(A1);
-
-        // std::cout << "Before multip for n_poly=" << n_poly << std::endl;
-        std::vector<GRBLinExpr> Acp0 = MatrixMultiply(A1std, cp0);  // A times control point 0
-        std::vector<GRBLinExpr> Acp1 = MatrixMultiply(A1std, cp1);  // A times control point 1
-        std::vector<GRBLinExpr> Acp2 = MatrixMultiply(A1std, cp2);  // A times control point 2
-        std::vector<GRBLinExpr> Acp3 = MatrixMultiply(A1std, cp3);  // A times control point 3
-
-        for (int i = 0; i < bb.rows(); i++)
-        {
-          std::string name0 =
-              "Poly" + std::to_string(n_poly) + "_face" + std::to_string(i) + "_t" + std::to_string(t) + "_cp0";
-          std::string name1 =
-              "Poly" + std::to_string(n_poly) + "_face" + std::to_string(i) + "_t" + std::to_string(t) + "_cp1";
-          std::string name2 =
-              "Poly" + std::to_string(n_poly) + "_face" + std::to_string(i) + "_t" + std::to_string(t) + "_cp2";
-          std::string name3 =
-              "Poly" + std::to_string(n_poly) + "_face" + std::to_string(i) + "_t" + std::to_string(t) + "_cp3";
-          // std::cout << "Plane=" << i << "out of" << bb.rows() - 1 << std::endl;
-          // If b[t,0]==1, all the control points are in that polytope
-
-          polytopes_cons.push_back(m.addGenConstrIndicator(b[t][n_poly], 1, Acp0[i], GRB_LESS_EQUAL, bb[i], name0));
-          polytopes_cons.push_back(m.addGenConstrIndicator(b[t][n_poly], 1, Acp1[i], GRB_LESS_EQUAL, bb[i], name1));
-          polytopes_cons.push_back(m.addGenConstrIndicator(b[t][n_poly], 1, Acp2[i], GRB_LESS_EQUAL, bb[i], name2));
-          polytopes_cons.push_back(m.addGenConstrIndicator(b[t][n_poly], 1, Acp3[i], GRB_LESS_EQUAL, bb[i], name3));
-        }
+        lo = probes[j];
       }
     }
+
+    probes.clear();
+    int n_probes = std::min((int)solvers.size(), hi - lo - 1);
+    for (int j = 1; j <= n_probes; j++)
+    {
+      probes.push_back(lo + j * (hi - lo) / (n_probes + 1));
+    }
+  }
+
+  if (hi < n)
+  {
+    x_sol_ = best_x_sol;
+    dt_sol_ = best_dt_sol;
+    first_incumbent_ms_ = best_incumbent_ms;
   }
+  return hi;
 }
 
-void SolverGurobi::setDC(double dc)
+void SolverGurobi::setParallelFactors(int n)
 {
-  DC = dc;
+  factor_workers_.clear();
+  double max_values[3] = { v_max_, a_max_, j_max_ };
+  for (int i = 1; i < n; i++)
+  {
+    SolverGurobi* worker = new SolverGurobi();
+    worker->setN(N_);
+    worker->formulation_ = formulation_;
+    worker->createVars();
+    worker->setDC(DC);
+    worker->setBounds(max_values);
+    worker->setThreads(threads_);
+    worker->setVerbose(verbose_);
+    worker->setWMax(w_max_);
+    worker->setMonotoneBinaries(monotone_binaries_);
+    worker->setMonotoneQP(qp_workers_.size());
+    worker->setLazyFaces(lazy_faces_, lazy_faces_margin_);
+    factor_workers_.push_back(std::unique_ptr<SolverGurobi>(worker));
+  }
 }
 
-void SolverGurobi::setX0(state& data)
+void SolverGurobi::setThreads(int threads)
 {
-  Eigen::Vector3d pos = data.pos;
-  Eigen::Vector3d vel = data.vel;
-  Eigen::Vector3d accel = data.accel;
+  threads_ = threads;
+  m.set("Threads", std::to_string(threads));
+}
 
-  x0_[0] = data.pos.x();
-  x0_[1] = data.pos.y();
-  x0_[2] = data.pos.z();
-  x0_[3] = data.vel.x();
-  x0_[4] = data.vel.y();
-  x0_[5] = data.vel.z();
-  x0_[6] = data.accel.x();
-  x0_[7] = data.accel.y();
-  x0_[8] = data.accel.z();
+void SolverGurobi::setVerbose(int verbose)
+{
+  verbose_ = verbose;
+  m.set("OutputFlag", std::to_string(verbose));  // 1 if you want verbose, 0 if not
 }
 
-void SolverGurobi::setXf(state& data)
+void SolverGurobi::setWMax(double w_max)
 {
-  Eigen::Vector3d pos = data.pos;
-  Eigen::Vector3d vel = data.vel;
-  Eigen::Vector3d accel = data.accel;
+  w_max_ = w_max;
+}
 
-  xf_[0] = data.pos.x();
-  xf_[1] = data.pos.y();
-  xf_[2] = data.pos.z();
-  xf_[3] = data.vel.x();
-  xf_[4] = data.vel.y();
-  xf_[5] = data.vel.z();
-  xf_[6] = data.accel.x();
-  xf_[7] = data.accel.y();
-  xf_[8] = data.accel.z();
+void SolverGurobi::findDT(double factor)
+{
+  dt_ = factor * std::max(getDTInitial(), 2 * DC);
 }
 
-void SolverGurobi::setConstraintsXf()
+// Continuity constraints and definition of the control points 1, 2, 3 (variables q) of each interval. Built once: their
+// coefficients are set by setDTCoefficients() (the coefficients 1 are placeholders)
+void SolverGurobi::setDynamicConstraints()
 {
-  // Remove previous final constraints
-  for (int i = 0; i < final_cons.size(); i++)
+  if (cp_cons.size() > 0 || dyn_cons.size() > 0)
   {
-    m.remove(final_cons[i]);
+    return;
   }
 
-  final_cons.clear();
+  if (controlPoints() == true)
+  {
+    setControlPointConstraints();
+    return;
+  }
 
-  // Constraint xT==x_final
-  for (int i = 0; i < 3; i++)
+  ConstrBatch dyn;
+  for (int t = 0; t < N_ - 1; t++)  // From 0....N_-2
   {
-    if (forceFinalConstraint_ == true)
+    const std::vector<GRBVar>& xt = x[t];
+    const std::vector<GRBVar>& xn = x[t + 1];
+    for (int i = 0; i < 3; i++)
     {
-      // std::cout << "*********FORCING FINAL CONSTRAINT******" << std::endl;
-      // std::cout << xf_[i] << std::endl;
-      final_cons.push_back(m.addConstr(getPos(N_ - 1, dt_, i) - xf_[i] == 0,
-                                       "FinalPosAxis_" + std::to_string(i)));  // Final position
+      std::string suffix = GRB_NAME("_t" + std::to_string(t) + "_axis" + std::to_string(i));
+      dyn.add({ 1, 1, 1, 1, -1 }, { xt[i], xt[3 + i], xt[6 + i], xt[9 + i], xn[9 + i] }, GRB_EQUAL, 0,
+              GRB_NAME("ContPos" + suffix));  // Continuity in position
+      dyn.add({ 1, 1, 1, -1 }, { xt[i], xt[3 + i], xt[6 + i], xn[6 + i] }, GRB_EQUAL, 0,
+              GRB_NAME("ContVel" + suffix));  // Continuity in velocity
+      dyn.add({ 1, 2, -2 }, { xt[i], xt[3 + i], xn[3 + i] }, GRB_EQUAL, 0,
+              GRB_NAME("ContAccel" + suffix));  // Continuity in acceleration
     }
-    final_cons.push_back(m.addConstr(getVel(N_ - 1, dt_, i) - xf_[i + 3] == 0,
-                                     "FinalVelAxis_" + std::to_string(i)));  // Final velocity
-    final_cons.push_back(m.addConstr(getAccel(N_ - 1, dt_, i) - xf_[i + 6] == 0,
-                                     "FinalAccel_" + std::to_string(i)));  // Final acceleration
   }
+  dyn_cons = addBatch(dyn);
+
+  // q[t] = control points 1, 2, 3 of the interval t: q[t][3 * (k - 1) + i]
+  std::vector<GRBVar> cps = addVarsBatch(9 * N_, -GRB_INFINITY, GRB_INFINITY, GRB_CONTINUOUS, [](int j) {
+    return "cp" + std::to_string((j % 9) / 3 + 1) + "_t" + std::to_string(j / 9) + "_axis" + std::to_string(j % 3);
+  });
+  ConstrBatch cp;
+  for (int t = 0; t < N_; t++)
+  {
+    q.push_back(std::vector<GRBVar>(cps.begin() + 9 * t, cps.begin() + 9 * (t + 1)));
+    const std::vector<GRBVar>& xt = x[t];
+    for (int k = 1; k <= 3; k++)
+    {
+      for (int i = 0; i < 3; i++)
+      {
+        GRBVar var = q[t][3 * (k - 1) + i];
+        std::string name = GRB_NAME("Cp" + std::to_string(k) + "_t" + std::to_string(t) + "_axis" + std::to_string(i));
+        if (k == 1)
+        {
+          cp.add({ 1, -1, -1 }, { var, xt[9 + i], xt[6 + i] }, GRB_EQUAL, 0, name);
+        }
+        else if (k == 2)
+        {
+          cp.add({ 1, -1, -1, -1 }, { var, xt[9 + i], xt[6 + i], xt[3 + i] }, GRB_EQUAL, 0, name);
+        }
+        else
+        {
+          cp.add({ 1, -1, -1, -1, -1 }, { var, xt[9 + i], xt[6 + i], xt[3 + i], xt[i] }, GRB_EQUAL, 0, name);
+        }
+      }
+    }
+  }
+  cp_cons = addBatch(cp);
 }
 
-void SolverGurobi::setConstraintsX0()
+// BEZIER and MINVO: continuity in vel and accel between intervals (the position is a shared variable), and definition
+// of the MINVO vertices. None of them depends on dt_ (all the intervals have the same dt_)
+void SolverGurobi::setControlPointConstraints()
 {
-  // Remove previous initial constraints
-  for (int i = 0; i < init_cons.size(); i++)
+  ConstrBatch dyn;
+  for (int t = 0; t < N_ - 1; t++)
   {
-    m.remove(init_cons[i]);
+    const std::vector<GRBVar>& pt = p[t];
+    const std::vector<GRBVar>& pn = p[t + 1];
+    for (int i = 0; i < 3; i++)
+    {
+      std::string suffix = GRB_NAME("_t" + std::to_string(t) + "_axis" + std::to_string(i));
+      // pn1 - pn0 = pt3 - pt2, with pn0 = pt3
+      dyn.add({ 1, -2, 1 }, { pn[3 + i], pt[9 + i], pt[6 + i] }, GRB_EQUAL, 0, GRB_NAME("ContVel" + suffix));
+      // pn2 - 2 pn1 + pn0 = pt3 - 2 pt2 + pt1
+      dyn.add({ 1, -2, 2, -1 }, { pn[6 + i], pn[3 + i], pt[6 + i], pt[3 + i] }, GRB_EQUAL, 0,
+              GRB_NAME("ContAccel" + suffix));
+    }
   }
+  dyn_cons = addBatch(dyn);
 
-  init_cons.clear();
-  // Constraint x0==x_initial
-  for (int i = 0; i < 3; i++)
+  if (formulation_ != MINVO)
+  {
+    return;
+  }
+  static const Eigen::Matrix4d M = minvoFromBezier();
+  std::vector<GRBVar> vertexes = addVarsBatch(12 * N_, -GRB_INFINITY, GRB_INFINITY, GRB_CONTINUOUS, [](int j) {
+    return "V" + std::to_string((j % 12) / 3) + "_t" + std::to_string(j / 12) + "_axis" + std::to_string(j % 3);
+  });
+  ConstrBatch cp;
+  for (int t = 0; t < N_; t++)
   {
-    init_cons.push_back(m.addConstr(getPos(0, 0, i) == x0_[i],
-                                    "InitialPosAxis_" + std::to_string(i)));  // Initial position
-                                                                              // std::cout << "Velocity" << std::endl;
-    init_cons.push_back(m.addConstr(getVel(0, 0, i) == x0_[i + 3],
-                                    "InitialVelAxis_" + std::to_string(i)));  // Initial velocity
-    // std::cout << "Accel" << std::endl;
-    init_cons.push_back(m.addConstr(getAccel(0, 0, i) == x0_[i + 6],
-                                    "InitialAccelAxis_" + std::to_string(i)));  // Initial acceleration}
+    v.push_back(std::vector<GRBVar>(vertexes.begin() + 12 * t, vertexes.begin() + 12 * (t + 1)));
+    for (int k = 0; k < 4; k++)
+    {
+      for (int i = 0; i < 3; i++)
+      {
+        cp.add({ 1, -M(k, 0), -M(k, 1), -M(k, 2), -M(k, 3) },
+               { v[t][3 * k + i], p[t][i], p[t][3 + i], p[t][6 + i], p[t][9 + i] }, GRB_EQUAL, 0,
+               GRB_NAME("V" + std::to_string(k) + "_t" + std::to_string(t) + "_axis" + std::to_string(i)));
+      }
+    }
   }
+  cp_cons = addBatch(cp);
 }
 
-void SolverGurobi::resetX()
+// BEZIER, MINVO and NORMALIZED: dt_ only appears in the right-hand sides of the limits, X0 and Xf. The rows of the
+// vel, accel and jerk are the ones of the control points (BEZIER and MINVO: P1 - P0 = vel * dt / 3,...) or of the
+// coefficients in normalized time (c = vel * dt,...)
+void SolverGurobi::setDTRightHandSides()
 {
-  int size = (int)(N_)*dt_ / DC;
-  size = (size < 2) ? 2 : size;  // force size to be at least 2
-  std::vector<state> tmp(size);
-  X_temp_ = tmp;
-}
+  double dt = dt_;
+  double scale_vel = (formulation_ == NORMALIZED) ? dt : dt / 3;
+  double scale_accel = (formulation_ == NORMALIZED) ? dt * dt : dt * dt / 6;
+  double scale_jerk = (formulation_ == NORMALIZED) ? dt * dt * dt : dt * dt * dt / 6;
 
-void SolverGurobi::setMaxConstraints()
-{
-  // Constraint v<=vmax, a<=amax, u<=umax
+  std::vector<double> rhs;
   for (int t = 0; t < N_; t++)
   {
     for (int i = 0; i < 3; i++)
     {
-      m.addConstr(getVel(t, 0, i) <= v_max_, "MaxVel_t" + std::to_string(t) + "_axis_" + std::to_string(i));
-      m.addConstr(getVel(t, 0, i) >= -v_max_, "MinVel_t" + std::to_string(t) + "_axis_" + std::to_string(i));
+      rhs.push_back(v_max_ * scale_vel);
+      rhs.push_back(-v_max_ * scale_vel);
+      rhs.push_back(a_max_ * scale_accel);
+      rhs.push_back(-a_max_ * scale_accel);
+      rhs.push_back(j_max_ * scale_jerk);
+      rhs.push_back(-j_max_ * scale_jerk);
+    }
+  }
+  m.set(GRB_DoubleAttr_RHS, max_cons.data(), rhs.data(), max_cons.size());
 
-      m.addConstr(getAccel(t, 0, i) <= a_max_, "MaxAccel_t" + std::to_string(t) + "_axis_" + std::to_string(i));
-      m.addConstr(getAccel(t, 0, i) >= -a_max_, "MinAccel_t" + std::to_string(t) + "_axis_" + std::to_string(i));
+  rhs.clear();
+  for (int i = 0; i < 3; i++)
+  {
+    rhs.push_back(x0_[i]);
+    rhs.push_back(x0_[i + 3] * scale_vel);
+    rhs.push_back(x0_[i + 6] * scale_accel);
+  }
+  m.set(GRB_DoubleAttr_RHS, init_cons.data(), rhs.data(), init_cons.size());
 
-      m.addConstr(getJerk(t, 0, i) <= j_max_, "MaxJerk_t" + std::to_string(t) + "_axis_" + std::to_string(i));
-      m.addConstr(getJerk(t, 0, i) >= -j_max_, "MinJerk_t" + std::to_string(t) + "_axis_" + std::to_string(i));
+  rhs.clear();
+  for (int i = 0; i < 3; i++)
+  {
+    if (forceFinalConstraint_ == true)
+    {
+      rhs.push_back(xf_[i]);
     }
+    rhs.push_back(xf_[i + 3] * scale_vel);
+    rhs.push_back(xf_[i + 6] * scale_accel);
   }
+  m.set(GRB_DoubleAttr_RHS, final_cons.data(), rhs.data(), final_cons.size());
 }
 
-void SolverGurobi::setBounds(double max_values[3])
+void SolverGurobi::readSolution(std::vector<double>& sol)
 {
-  v_max_ = max_values[0];
-  a_max_ = max_values[1];
-  j_max_ = max_values[2];
-
-  setMaxConstraints();
-}
+  sol.resize(12 * N_);
+  if (formulation_ == COEFFICIENTS || formulation_ == NORMALIZED)
+  {
+    // NORMALIZED: a * dt^3, b * dt^2, c * dt, d
+    double scale[4] = { 1, 1, 1, 1 };
+    if (formulation_ == NORMALIZED)
+    {
+      scale[0] = 1 / (dt_ * dt_ * dt_);
+      scale[1] = 1 / (dt_ * dt_);
+      scale[2] = 1 / dt_;
+    }
+    for (int t = 0; t < N_; t++)
+    {
+      for (int j = 0; j < 12; j++)
+      {
+        sol[12 * t + j] = x[t][j].get(GRB_DoubleAttr_X) * scale[j / 3];
+      }
+    }
+    return;
+  }
 
-void SolverGurobi::setFactorInitialAndFinalAndIncrement(double factor_initial, double factor_final,
-                                                        double factor_increment)
-{
-  factor_initial_ = factor_initial;
-  factor_final_ = factor_final;
-  factor_increment_ = factor_increment;
+  // P0 + 3 (P1 - P0) s + 3 (P2 - 2 P1 + P0) s^2 + (P3 - 3 P2 + 3 P1 - P0) s^3, with s = tau / dt_
+  std::vector<GRBVar> vars;
+  for (int t = 0; t < N_; t++)
+  {
+    vars.insert(vars.end(), p[t].begin(), p[t].end());
+  }
+  double* values = m.get(GRB_DoubleAttr_X, vars.data(), vars.size());
+  double dt = dt_;
+  for (int t = 0; t < N_; t++)
+  {
+    const double* P = values + 12 * t;
+    for (int i = 0; i < 3; i++)
+    {
+      sol[12 * t + 0 + i] = (P[9 + i] - 3 * P[6 + i] + 3 * P[3 + i] - P[i]) / (dt * dt * dt);
+      sol[12 * t + 3 + i] = 3 * (P[6 + i] - 2 * P[3 + i] + P[i]) / (dt * dt);
+      sol[12 * t + 6 + i] = 3 * (P[3 + i] - P[i]) / dt;
+      sol[12 * t + 9 + i] = P[i];
+    }
+  }
+  delete[] values;
 }
 
-bool SolverGurobi::genNewTraj()
+// Changes, in place, all the coefficients that depend on dt_ (continuity, final state and control points). With
+// NORMALIZED they are the ones of dt=1, and dt_ goes to the right-hand sides
+void SolverGurobi::setDTCoefficients()
 {
-  bool solved = false;
-
-  trials_ = 0;
-
-  /*  std::cout << "A is\n";
-    std::cout << polytopes_[0].A() << std::endl;
-    std::cout << "B es esto:\n";
-    std::cout << polytopes_[0].b().transpose() << std::endl;
-    std::cout << "Number of rows= " << bb.rows() << std::endl;*/
-
-  if (factor_initial_ < 1)
+  if (controlPoints() == true)
   {
-    std::cout << "factor_initial_ is less than one, it doesn't make sense" << std::endl;
+    setDTRightHandSides();
+    return;
   }
 
-  runtime_ms_ = 0;
-
-  for (double i = factor_initial_; i <= factor_final_ && solved == false && cb_.should_terminate_ == false;
-       i = i + factor_increment_)
-  {
-    trials_ = trials_ + 1;
-    findDT(i);
-    // std::cout << "Going to try with dt_= " << dt_ << ", should_terminate_=" << cb_.should_terminate_ << std::endl;
-    setPolytopesConstraints();
-    setConstraintsX0();
-    setConstraintsXf();
-    setDynamicConstraints();
-    setObjective();
-    resetX();
-
-    solved = callOptimizer();
-    /*    if (solved == true)
-        {
-          solved = isWmaxSatisfied();
-        }*/
-    if (solved == true)  // solved and Wmax is satisfied
+  double dt = (formulation_ == NORMALIZED) ? 1.0 : dt_;
+  double dt2 = dt * dt;
+  double dt3 = dt2 * dt;
+
+  std::vector<GRBConstr> constrs;
+  std::vector<GRBVar> vars;
+  std::vector<double> coeffs;
+  auto add = [&](const GRBConstr& constr, const GRBVar& var, double coeff) {
+    constrs.push_back(constr);
+    vars.push_back(var);
+    coeffs.push_back(coeff);
+  };
+  // Pos, vel or accel at the end (tau=dt) of the interval t: only the coefficients of a, b, c depend on dt
+  auto addEndOfInterval = [&](const GRBConstr& constr, int t, int i, int derivative) {
+    if (derivative == 0)
     {
-      factor_that_worked_ = i;
-      // std::cout << "Factor= " << i << "(dt_= " << dt_ << ")---> worked" << std::endl;
+      add(constr, x[t][0 + i], dt3);
+      add(constr, x[t][3 + i], dt2);
+      add(constr, x[t][6 + i], dt);
+    }
+    else if (derivative == 1)
+    {
+      add(constr, x[t][0 + i], 3 * dt2);
+      add(constr, x[t][3 + i], 2 * dt);
     }
     else
     {
-      // std::cout << "Factor= " << i << "(dt_= " << dt_ << ")---> didn't worked" << std::endl;
+      add(constr, x[t][0 + i], 6 * dt);
     }
-  }
-
-  cb_.should_terminate_ = false;  // Should be at the end of genNewTaj, not at the beginning
-
-  return solved;
-}
+  };
 
-void SolverGurobi::setThreads(int threads)
-{
-  m.set("Threads", std::to_string(threads));
-}
-
-void SolverGurobi::setVerbose(int verbose)
-{
-  m.set("OutputFlag", std::to_string(verbose));  // 1 if you want verbose, 0 if not
-}
-
-void SolverGurobi::setWMax(double w_max)
-{
-  w_max_ = w_max;
-}
-
-void SolverGurobi::findDT(double factor)
-{
-  dt_ = factor * std::max(getDTInitial(), 2 * DC);
-}
+  int index = 0;
+  for (int t = 0; t < N_ - 1; t++)
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      for (int derivative = 0; derivative < 3; derivative++)
+      {
+        addEndOfInterval(dyn_cons[index++], t, i, derivative);
+      }
+    }
+  }
 
-void SolverGurobi::setDynamicConstraints()
-{
-  // Remove the previous dynamic constraints
-  for (int i = 0; i < dyn_cons.size(); i++)
+  index = 0;
+  for (int i = 0; i < 3; i++)
   {
-    m.remove(dyn_cons[i]);
+    for (int derivative = (forceFinalConstraint_ == true) ? 0 : 1; derivative < 3; derivative++)
+    {
+      addEndOfInterval(final_cons[index++], N_ - 1, i, derivative);
+    }
   }
-  dyn_cons.clear();
 
-  // Dynamic Constraints
-  for (int t = 0; t < N_ - 1; t++)  // From 0....N_-2
+  index = 0;
+  for (int t = 0; t < N_; t++)
   {
-    for (int i = 0; i < 3; i++)
+    for (int k = 1; k <= 3; k++)
     {
-      dyn_cons.push_back(m.addConstr(getPos(t, dt_, i) == getPos(t + 1, 0, i),
-                                     "ContPos_t" + std::to_string(t) + "_axis" + std::to_string(i)));  // Continuity in
-                                                                                                       // position
-      dyn_cons.push_back(m.addConstr(getVel(t, dt_, i) == getVel(t + 1, 0, i),
-                                     "ContVel_t" + std::to_string(t) + "_axis" + std::to_string(i)));  // Continuity in
-                                                                                                       // velocity
-      dyn_cons.push_back(
-          m.addConstr(getAccel(t, dt_, i) == getAccel(t + 1, 0, i),
-                      "ContAccel_t" + std::to_string(t) + "_axis" + std::to_string(i)));  // Continuity in acceleration
+      for (int i = 0; i < 3; i++)
+      {
+        const GRBConstr& constr = cp_cons[index++];
+        if (k == 1)
+        {
+          add(constr, x[t][6 + i], -dt / 3);  // cp1 = d + c*dt/3
+        }
+        else if (k == 2)
+        {
+          add(constr, x[t][3 + i], -dt2 / 3);  // cp2 = d + 2*c*dt/3 + b*dt^2/3
+          add(constr, x[t][6 + i], -2 * dt / 3);
+        }
+        else
+        {
+          add(constr, x[t][0 + i], -dt3);  // cp3 = d + c*dt + b*dt^2 + a*dt^3
+          add(constr, x[t][3 + i], -dt2);
+          add(constr, x[t][6 + i], -dt);
+        }
+      }
     }
   }
+
+  m.chgCoeffs(constrs.data(), vars.data(), coeffs.data(), constrs.size());
+  if (formulation_ == NORMALIZED)
+  {
+    setDTRightHandSides();
+  }
 }
 
 // For the Jackal:
@@ -539,7 +1932,7 @@ bool SolverGurobi::isWmaxSatisfied()
 
     if (w_desired > w_max_)
     {
-      std::cout << "w_desired > than w_max: " << w_desired << " > " << w_max_ << "  , solving again" << std::endl;
+      FASTER_DEBUG("w_desired > than w_max: " << w_desired << " > " << w_max_ << "  , solving again");
       return false;
     }
   }
@@ -556,6 +1949,12 @@ bool SolverGurobi::callOptimizer()
   // m.set("NumericFocus", "3");
   // m.set("Presolve", "0");
 
+  if (lazy_faces_found_.empty() == false)
+  {
+    addFaceRows(lazy_faces_found_);  // Found in the previous trial
+    lazy_faces_found_.clear();
+  }
+
   m.update();
   temporal_ = temporal_ + 1;
   // printf("Writing into model.lp number=%d\n", temporal_);
@@ -571,6 +1970,11 @@ bool SolverGurobi::callOptimizer()
   //          << std::endl;
 
   runtime_ms_ = runtime_ms_ + m.get(GRB_DoubleAttr_Runtime) * 1000;
+  if (convex_ == false)
+  {
+    node_count_ = node_count_ + m.get(GRB_DoubleAttr_NodeCount);  // Only defined for MIPs
+  }
+  iterations_ = iterations_ + m.get(GRB_DoubleAttr_IterCount) + m.get(GRB_IntAttr_BarIterCount);
 
   /*  times_log.open("/home/jtorde/Desktop/ws/src/acl-planning/faster/models/times_log.txt", std::ios_base::app);
     times_log << elapsed << "\n";
@@ -578,8 +1982,17 @@ bool SolverGurobi::callOptimizer()
 
   // printf("Going to check status");
   int optimstatus = m.get(GRB_IntAttr_Status);
-  if (optimstatus == GRB_OPTIMAL)
+  bool stopped = (optimstatus == GRB_TIME_LIMIT || optimstatus == GRB_INTERRUPTED);
+  if (optimstatus == GRB_NUMERIC || optimstatus == GRB_SUBOPTIMAL)
+  {
+    numeric_issues_ = numeric_issues_ + 1;
+  }
+  if (optimstatus == GRB_OPTIMAL || (stopped && m.get(GRB_IntAttr_SolCount) > 0))
   {
+    if (optimstatus != GRB_OPTIMAL)
+    {
+      FASTER_DEBUG("GUROBI Status: Stopped before the optimum, using the best feasible solution found");
+    }
     // m.write(ros::package::getPath("faster") + "/models/model_wt" + std::to_string(temporal_) + ".lp");
 
     /*    if (polytopes_cons.size() > 0)  // Print the binary matrix only if I've included the polytope constraints
@@ -642,7 +2055,7 @@ bool SolverGurobi::callOptimizer()
 
     if (optimstatus == GRB_INTERRUPTED)
     {
-      printf("GUROBI Status: Interrumped by the user\n");
+      FASTER_DEBUG("GUROBI Status: Interrumped by the user");
     }
   }
   return solved;
@@ -658,104 +2071,7 @@ bool SolverGurobi::callOptimizer()
 
 double SolverGurobi::getDTInitial()
 {
-  double dt_initial = 0;
-  float t_vx = 0;
-  float t_vy = 0;
-  float t_vz = 0;
-  float t_ax = 0;
-  float t_ay = 0;
-  float t_az = 0;
-  float t_jx = 0;
-  float t_jy = 0;
-  float t_jz = 0;
-
-  t_vx = fabs(xf_[0] - x0_[0]) / v_max_;
-  t_vy = fabs(xf_[1] - x0_[1]) / v_max_;
-  t_vz = fabs(xf_[2] - x0_[2]) / v_max_;
-
-  /*  printf("times vel: t_ax, t_ay, t_az:\n");
-    std::cout << t_vx << "  " << t_vy << "  " << t_vz << std::endl;*/
-
-  float jerkx = copysign(1, xf_[0] - x0_[0]) * j_max_;
-  float jerky = copysign(1, xf_[1] - x0_[1]) * j_max_;
-  float jerkz = copysign(1, xf_[2] - x0_[2]) * j_max_;
-  float a0x = x0_[6];
-  float a0y = x0_[7];
-  float a0z = x0_[8];
-  float v0x = x0_[3];
-  float v0y = x0_[4];
-  float v0z = x0_[5];
-
-  // Solve For JERK
-  // polynomial ax3+bx2+cx+d=0 --> coeff=[d c b a]
-  Eigen::Vector4d coeff_jx(x0_[0] - xf_[0], v0x, a0x / 2.0, jerkx / 6.0);
-  Eigen::Vector4d coeff_jy(x0_[1] - xf_[1], v0y, a0y / 2.0, jerky / 6.0);
-  Eigen::Vector4d coeff_jz(x0_[2] - xf_[2], v0z, a0z / 2.0, jerkz / 6.0);
-
-  /*  std::cout << "Coefficients for jerk" << std::endl;
-    std::cout << "Coeffx=" << coeff_jx.transpose() << std::endl;
-    std::cout << "Coeffy=" << coeff_jy.transpose() << std::endl;
-    std::cout << "Coeffz=" << coeff_jz.transpose() << std::endl;*/
-
-  Eigen::PolynomialSolver<double, Eigen::Dynamic> psolve_jx(coeff_jx);
-  Eigen::PolynomialSolver<double, Eigen::Dynamic> psolve_jy(coeff_jy);
-  Eigen::PolynomialSolver<double, Eigen::Dynamic> psolve_jz(coeff_jz);
-
-  std::vector<double> realRoots_jx;
-  std::vector<double> realRoots_jy;
-  std::vector<double> realRoots_jz;
-  psolve_jx.realRoots(realRoots_jx);
-  psolve_jy.realRoots(realRoots_jy);
-  psolve_jz.realRoots(realRoots_jz);
-
-  t_jx = MinPositiveElement(realRoots_jx);
-  t_jy = MinPositiveElement(realRoots_jy);
-  t_jz = MinPositiveElement(realRoots_jz);
-
-  /*  printf("times jerk: t_jx, t_jy, t_jz:\n");
-    std::cout << t_jx << "  " << t_jy << "  " << t_jz << std::endl;*/
-
-  float accelx = copysign(1, xf_[0] - x0_[0]) * a_max_;
-  float accely = copysign(1, xf_[1] - x0_[1]) * a_max_;
-  float accelz = copysign(1, xf_[2] - x0_[2]) * a_max_;
-
-  // Solve For ACCELERATION
-  // polynomial ax2+bx+c=0 --> coeff=[c b a]
-  Eigen::Vector3d coeff_ax(x0_[0] - xf_[0], v0x, 0.5 * accelx);
-  Eigen::Vector3d coeff_ay(x0_[1] - xf_[1], v0y, 0.5 * accely);
-  Eigen::Vector3d coeff_az(x0_[2] - xf_[2], v0z, 0.5 * accelz);
-
-  /*  std::cout << "Coefficients for accel" << std::endl;
-    std::cout << "coeff_ax=" << coeff_ax.transpose() << std::endl;
-    std::cout << "coeff_ay=" << coeff_ay.transpose() << std::endl;
-    std::cout << "coeff_az=" << coeff_az.transpose() << std::endl;*/
-
-  Eigen::PolynomialSolver<double, Eigen::Dynamic> psolve_ax(coeff_ax);
-  Eigen::PolynomialSolver<double, Eigen::Dynamic> psolve_ay(coeff_ay);
-  Eigen::PolynomialSolver<double, Eigen::Dynamic> psolve_az(coeff_az);
-
-  std::vector<double> realRoots_ax;
-  std::vector<double> realRoots_ay;
-  std::vector<double> realRoots_az;
-  psolve_ax.realRoots(realRoots_ax);
-  psolve_ay.realRoots(realRoots_ay);
-  psolve_az.realRoots(realRoots_az);
-
-  t_ax = MinPositiveElement(realRoots_ax);
-  t_ay = MinPositiveElement(realRoots_ay);
-  t_az = MinPositiveElement(realRoots_az);
-
-  /*  printf("times accel: t_ax, t_ay, t_az:\n");
-    std::cout << t_ax << "  " << t_ay << "  " << t_az << std::endl;
-  */
-  dt_initial = std::max({ t_vx, t_vy, t_vz, t_ax, t_ay, t_az, t_jx, t_jy, t_jz }) / N_;
-  if (dt_initial > 10000)  // happens when there is no solution to the previous eq.
-  {
-    printf("there is not a solution to the previous equations\n");
-    dt_initial = 0;
-  }
-  // printf("returning dt_initial=%f\n", dt_initial);
-  return dt_initial;
+  return dtLowerBound(x0_, xf_, v_max_, a_max_, j_max_, N_);
 }
 
 GRBLinExpr SolverGurobi::getPos(int t, double tau, int ii)
@@ -828,35 +2144,3 @@ GRBLinExpr SolverGurobi::getDn(int t, int ii)  // interval, axis
 {
   return x[t][9 + ii];
 }
-
-// Control Points (of the splines) getters
-std::vector<GRBLinExpr> SolverGurobi::getCP0(int t)  // Control Point 0 of interval t
-{                                                    // Control Point 0 is initial position
-                                                     // std::cout << "Getting CP0" << std::endl;
-  std::vector<GRBLinExpr> cp = { getPos(t, 0, 0), getPos(t, 0, 1), getPos(t, 0, 2) };
-  return cp;
-}
-
-std::vector<GRBLinExpr> SolverGurobi::getCP1(int t)  // Control Point 1 of interval t
-{
-  GRBLinExpr cpx = (getCn(t, 0) + 3 * getDn(t, 0)) / 3;
-  GRBLinExpr cpy = (getCn(t, 1) + 3 * getDn(t, 1)) / 3;
-  GRBLinExpr cpz = (getCn(t, 2) + 3 * getDn(t, 2)) / 3;
-  std::vector<GRBLinExpr> cp = { cpx, cpy, cpz };
-  return cp;
-}
-
-std::vector<GRBLinExpr> SolverGurobi::getCP2(int t)  // Control Point 2 of interval t
-{
-  GRBLinExpr cpx = (getBn(t, 0) + 2 * getCn(t, 0) + 3 * getDn(t, 0)) / 3;
-  GRBLinExpr cpy = (getBn(t, 1) + 2 * getCn(t, 1) + 3 * getDn(t, 1)) / 3;
-  GRBLinExpr cpz = (getBn(t, 2) + 2 * getCn(t, 2) + 3 * getDn(t, 2)) / 3;
-  std::vector<GRBLinExpr> cp = { cpx, cpy, cpz };
-  return cp;
-}
-
-std::vector<GRBLinExpr> SolverGurobi::getCP3(int t)  // Control Point 3 of interval t
-{                                                    // Control Point 3 is end position
-  std::vector<GRBLinExpr> cp = { getPos(t, dt_, 0), getPos(t, dt_, 1), getPos(t, dt_, 2) };
-  return cp;
-}
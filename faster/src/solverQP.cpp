@@ -0,0 +1,197 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2020, Jesus Tordesillas Torres, Aerospace Controls Laboratory
+ * Massachusetts Institute of Technology
+ * All Rights Reserved
+ * Authors: Jesus Tordesillas, et al.
+ * See LICENSE file for the license information
+ * -------------------------------------------------------------------------- */
+
+#include "solverQP.hpp"
+#include "logger.hpp"
+
+#include <algorithm>
+#include <limits>
+
+void SolverQP::setup(const solver_settings& settings)
+{
+  N_ = settings.N;
+  intervals_ = N_;
+  dc_ = settings.dc;
+  v_max_ = settings.v_max;
+  a_max_ = settings.a_max;
+  j_max_ = settings.j_max;
+  force_final_ = settings.force_final_constraint;
+  setFactorInitialAndFinalAndIncrement(settings.factor_initial, settings.factor_final, settings.factor_increment);
+  verbose_ = settings.verbose;
+}
+
+void SolverQP::warmUp(int n_polytopes, int n_faces)
+{
+  resizeQP(n_faces);
+  for (int n = 1; n <= n_polytopes; n++)
+  {
+    assignments(n);
+  }
+}
+
+void SolverQP::resizeQP(int max_faces)
+{
+  if (N_ == qp_N_ && max_faces <= qp_faces_)
+  {
+    return;
+  }
+  qp_.resize(N_, max_faces);
+  qp_faces_ = std::max(max_faces, qp_faces_);  // The workspace of CubicQP never shrinks
+  qp_N_ = N_;
+}
+
+const std::vector<std::vector<int>>& SolverQP::assignments(int n_polytopes)
+{
+  std::pair<int, int> shape(N_, n_polytopes);
+  auto it = assignments_.find(shape);
+  if (it == assignments_.end())
+  {
+    it = assignments_.emplace(shape, monotoneAssignments(N_, n_polytopes)).first;
+  }
+  return it->second;
+}
+
+void SolverQP::setX0(state& data)
+{
+  for (int i = 0; i < 3; i++)
+  {
+    x0_[i] = data.pos(i);
+    x0_[3 + i] = data.vel(i);
+    x0_[6 + i] = data.accel(i);
+  }
+}
+
+void SolverQP::setXf(state& data)
+{
+  for (int i = 0; i < 3; i++)
+  {
+    xf_[i] = data.pos(i);
+    xf_[3 + i] = data.vel(i);
+    xf_[6 + i] = data.accel(i);
+  }
+}
+
+void SolverQP::setPolytopes(std::vector<LinearConstraint3D> polytopes)
+{
+  polytopes_ = polytopes;
+}
+
+void SolverQP::setForceFinalConstraint(bool forceFinalConstraint)
+{
+  force_final_ = forceFinalConstraint;
+}
+
+void SolverQP::setFactorInitialAndFinalAndIncrement(double factor_initial, double factor_final,
+                                                    double factor_increment)
+{
+  factor_initial_ = factor_initial;
+  factor_final_ = factor_final;
+  factor_increment_ = factor_increment;
+}
+
+void SolverQP::setDeadline(std::chrono::steady_clock::time_point deadline)
+{
+  deadline_ = deadline;
+}
+
+void SolverQP::StopExecution()
+{
+  should_terminate_ = true;
+}
+
+void SolverQP::ResetToNormalState()
+{
+  should_terminate_ = false;
+}
+
+bool SolverQP::solveAssignments(double dt, const std::vector<std::vector<int>>& assignments)
+{
+  qp_.setProblem(x0_, xf_, force_final_, dt, v_max_, a_max_, j_max_);
+  double best_cost = std::numeric_limits<double>::max();
+  for (const std::vector<int>& assignment : assignments)
+  {
+    qp_.setPolytopes(polytopes_, assignment);
+    CubicQP::Status status = qp_.solve(&should_terminate_, deadline_);
+    iterations_ = iterations_ + qp_.iterations();
+    numeric_issues_ = numeric_issues_ + ((status == CubicQP::MAX_ITERATIONS || status == CubicQP::NUMERIC) ? 1 : 0);
+    if (status == CubicQP::STOPPED)
+    {
+      break;
+    }
+    if (status == CubicQP::SOLVED && qp_.cost() < best_cost)
+    {
+      best_cost = qp_.cost();
+      qp_.getCoefficients(coeffs_);
+    }
+    if (verbose_ > 0)
+    {
+      FASTER_DEBUG("QP: dt=" << dt << ", status " << status << " in " << qp_.iterations() << " iterations");
+    }
+  }
+  if (best_cost == std::numeric_limits<double>::max())
+  {
+    return false;
+  }
+  x_sol_.swap(coeffs_);
+  dt_sol_ = dt;
+  return true;
+}
+
+bool SolverQP::genNewTraj()
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  trials_ = 0;
+  runtime_ms_ = 0;
+  node_count_ = 0;
+  iterations_ = 0;
+  numeric_issues_ = 0;
+  first_incumbent_ms_ = -1;
+
+  int max_faces = 0;
+  for (const LinearConstraint3D& polytope : polytopes_)
+  {
+    max_faces = std::max(max_faces, (int)polytope.A().rows());
+  }
+  resizeQP(max_faces);
+  const std::vector<std::vector<int>>& shape_assignments = assignments(polytopes_.size());
+  double dt_initial = std::max(dtLowerBound(x0_, xf_, v_max_, a_max_, j_max_, N_), 2 * dc_);
+
+  bool solved = false;
+  for (double factor = factor_initial_; factor <= factor_final_; factor = factor + factor_increment_)
+  {
+    if (should_terminate_ == true || std::chrono::steady_clock::now() >= deadline_)
+    {
+      break;
+    }
+    trials_ = trials_ + 1;
+    if (solveAssignments(factor * dt_initial, shape_assignments) == true)
+    {
+      factor_that_worked_ = factor;
+      solved = true;
+      break;
+    }
+  }
+
+  runtime_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  if (solved == true)
+  {
+    first_incumbent_ms_ = runtime_ms_;
+  }
+  return solved;
+}
+
+void SolverQP::fillX()
+{
+  sampleSolution(x_sol_, dt_sol_, dc_, X_temp_);
+}
+
+void SolverQP::getCoefficients(std::vector<double>& coeffs, double& dt)
+{
+  coeffs = x_sol_;
+  dt = dt_sol_;
+}
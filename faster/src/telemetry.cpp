@@ -0,0 +1,106 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2020, Jesus Tordesillas Torres, Aerospace Controls Laboratory
+ * Massachusetts Institute of Technology
+ * All Rights Reserved
+ * Authors: Jesus Tordesillas, et al.
+ * See LICENSE file for the license information
+ * -------------------------------------------------------------------------- */
+
+#include "telemetry.hpp"
+#include "logger.hpp"
+
+#include <chrono>
+#include <string.h>
+
+Telemetry::Telemetry(int capacity) : ring_(capacity)
+{
+}
+
+Telemetry::~Telemetry()
+{
+  stop();
+}
+
+bool Telemetry::start(const std::string& file, Sink sink)
+{
+  stop();
+
+  if (file != "")
+  {
+    file_ = fopen(file.c_str(), "wb");
+    if (file_ == nullptr)
+    {
+      FASTER_ERROR("Telemetry: cannot open " << file);
+      return false;
+    }
+    TelemetryHeader header;
+    memset(&header, 0, sizeof(header));
+    strncpy(header.magic, TELEMETRY_MAGIC, sizeof(header.magic) - 1);
+    header.version = TELEMETRY_VERSION;
+    header.record_size = sizeof(replan_record);
+    fwrite(&header, sizeof(header), 1, file_);
+  }
+  sink_ = sink;
+
+  running_ = true;
+  thread_ = std::thread(&Telemetry::drain, this);
+  return true;
+}
+
+void Telemetry::stop()
+{
+  if (thread_.joinable())
+  {
+    running_ = false;
+    thread_.join();
+  }
+  if (file_ != nullptr)
+  {
+    fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+void Telemetry::push(const replan_record& record)
+{
+  if (running_ == false)
+  {
+    return;
+  }
+  if (ring_.push(record) == false)
+  {
+    dropped_++;
+  }
+}
+
+void Telemetry::drain()
+{
+  while (running_)
+  {
+    flush();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  flush();  // Records pushed before stop()
+}
+
+void Telemetry::flush()
+{
+  replan_record record;
+  bool written = false;
+  while (ring_.pop(record))
+  {
+    if (file_ != nullptr)
+    {
+      fwrite(&record, sizeof(record), 1, file_);
+      written = true;
+    }
+    if (sink_)
+    {
+      sink_(record);
+    }
+  }
+  if (written)
+  {
+    fflush(file_);  // A crash loses at most the last 100 ms
+  }
+}
@@ -0,0 +1,908 @@
+/* ----------------------------------------------------------------------------
+ * Copyright 2020, Jesus Tordesillas Torres, Aerospace Controls Laboratory
+ * Massachusetts Institute of Technology
+ * All Rights Reserved
+ * Authors: Jesus Tordesillas, et al.
+ * See LICENSE file for the license information
+ * -------------------------------------------------------------------------- */
+
+#include "trajectory_solver.hpp"
+#include "solverQP.hpp"
+#include "logger.hpp"
+#ifdef FASTER_WITH_GUROBI
+#include "solverGurobi.hpp"
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <Eigen/Dense>
+
+static double MinPositiveElement(std::vector<double> v)
+{
+  std::sort(v.begin(), v.end());  // sorted in ascending order
+  double min_value = 0;
+  for (int i = 0; i < v.size(); i++)
+  {
+    if (v[i] > 0)
+    {
+      min_value = v[i];
+      break;
+    }
+  }
+  return min_value;
+}
+
+// Real roots of coeff(0) + coeff(1)*t + coeff(2)*t^2 = 0 (same order of the coefficients as Eigen::PolynomialSolver)
+static std::vector<double> RealRootsQuadratic(const Eigen::Vector3d& coeff)
+{
+  double c = coeff(0), b = coeff(1), a = coeff(2);
+  std::vector<double> roots;
+  if (fabs(a) < 1e-12)
+  {
+    if (fabs(b) > 1e-12)
+    {
+      roots.push_back(-c / b);
+    }
+    return roots;
+  }
+  double dis = b * b - 4 * a * c;
+  if (dis < 0)
+  {
+    return roots;
+  }
+  // q avoids the cancellation of -b + sqrt(dis) when b*b >> 4ac
+  double q = -0.5 * (b + copysign(sqrt(dis), b));
+  roots.push_back(q / a);
+  if (q != 0)
+  {
+    roots.push_back(c / q);
+  }
+  return roots;
+}
+
+// Real roots of coeff(0) + coeff(1)*t + coeff(2)*t^2 + coeff(3)*t^3 = 0, closed form (Cardano when there is one real
+// root, trigonometric method when there are three)
+static std::vector<double> RealRootsCubic(const Eigen::Vector4d& coeff)
+{
+  if (fabs(coeff(3)) < 1e-12)
+  {
+    return RealRootsQuadratic(coeff.head<3>());
+  }
+  // t^3 + a t^2 + b t + c = 0, and with t = y - a/3 --> y^3 + p y + q = 0
+  double a = coeff(2) / coeff(3), b = coeff(1) / coeff(3), c = coeff(0) / coeff(3);
+  double p = b - a * a / 3.0;
+  double q = 2.0 * a * a * a / 27.0 - a * b / 3.0 + c;
+  double shift = -a / 3.0;
+  double dis = q * q / 4.0 + p * p * p / 27.0;
+
+  std::vector<double> roots;
+  if (dis > 1e-14)
+  {
+    double sq = sqrt(dis);
+    roots.push_back(cbrt(-q / 2.0 + sq) + cbrt(-q / 2.0 - sq) + shift);
+  }
+  else if (fabs(p) < 1e-12)
+  {
+    roots.push_back(shift);  // Triple root
+  }
+  else if (dis > -1e-14)
+  {
+    roots.push_back(3.0 * q / p + shift);  // Simple and double root
+    roots.push_back(-1.5 * q / p + shift);
+  }
+  else
+  {
+    double r = 2.0 * sqrt(-p / 3.0);
+    double cos_arg = std::min(std::max(1.5 * q / p * sqrt(-3.0 / p), -1.0), 1.0);
+    double phi = acos(cos_arg) / 3.0;
+    for (int k = 0; k < 3; k++)
+    {
+      roots.push_back(r * cos(phi - 2.0 * M_PI * k / 3.0) + shift);
+    }
+  }
+  return roots;
+}
+
+double dtLowerBound(const double x0[9], const double xf[9], double v_max, double a_max, double j_max, int N)
+{
+  float t_vx = fabs(xf[0] - x0[0]) / v_max;
+  float t_vy = fabs(xf[1] - x0[1]) / v_max;
+  float t_vz = fabs(xf[2] - x0[2]) / v_max;
+
+  float jerkx = copysign(1, xf[0] - x0[0]) * j_max;
+  float jerky = copysign(1, xf[1] - x0[1]) * j_max;
+  float jerkz = copysign(1, xf[2] - x0[2]) * j_max;
+  float a0x = x0[6];
+  float a0y = x0[7];
+  float a0z = x0[8];
+  float v0x = x0[3];
+  float v0y = x0[4];
+  float v0z = x0[5];
+
+  // Solve For JERK
+  // polynomial ax3+bx2+cx+d=0 --> coeff=[d c b a]
+  Eigen::Vector4d coeff_jx(x0[0] - xf[0], v0x, a0x / 2.0, jerkx / 6.0);
+  Eigen::Vector4d coeff_jy(x0[1] - xf[1], v0y, a0y / 2.0, jerky / 6.0);
+  Eigen::Vector4d coeff_jz(x0[2] - xf[2], v0z, a0z / 2.0, jerkz / 6.0);
+
+  float t_jx = MinPositiveElement(RealRootsCubic(coeff_jx));
+  float t_jy = MinPositiveElement(RealRootsCubic(coeff_jy));
+  float t_jz = MinPositiveElement(RealRootsCubic(coeff_jz));
+
+  float accelx = copysign(1, xf[0] - x0[0]) * a_max;
+  float accely = copysign(1, xf[1] - x0[1]) * a_max;
+  float accelz = copysign(1, xf[2] - x0[2]) * a_max;
+
+  // Solve For ACCELERATION
+  // polynomial ax2+bx+c=0 --> coeff=[c b a]
+  Eigen::Vector3d coeff_ax(x0[0] - xf[0], v0x, 0.5 * accelx);
+  Eigen::Vector3d coeff_ay(x0[1] - xf[1], v0y, 0.5 * accely);
+  Eigen::Vector3d coeff_az(x0[2] - xf[2], v0z, 0.5 * accelz);
+
+  float t_ax = MinPositiveElement(RealRootsQuadratic(coeff_ax));
+  float t_ay = MinPositiveElement(RealRootsQuadratic(coeff_ay));
+  float t_az = MinPositiveElement(RealRootsQuadratic(coeff_az));
+
+  double dt_initial = std::max({ t_vx, t_vy, t_vz, t_ax, t_ay, t_az, t_jx, t_jy, t_jz }) / N;
+  if (dt_initial > 10000)  // happens when there is no solution to the previous eq.
+  {
+    FASTER_WARN("there is not a solution to the previous equations");
+    dt_initial = 0;
+  }
+  return dt_initial;
+}
+
+std::vector<std::vector<int>> monotoneAssignments(int N, int n_polytopes)
+{
+  std::vector<std::vector<int>> result;
+  if (n_polytopes == 0)
+  {
+    return result;
+  }
+  std::vector<int> assignment(N, 0);
+  std::function<void(int)> enumerate = [&](int t) {
+    if (t == N)
+    {
+      result.push_back(assignment);
+      return;
+    }
+    for (int step = 0; step <= 1; step++)
+    {
+      assignment[t] = assignment[t - 1] + step;
+      if (assignment[t] < n_polytopes)
+      {
+        enumerate(t + 1);
+      }
+    }
+  };
+  enumerate(1);
+  return result;
+}
+
+// Cubic MINVO basis lambda_i(u), u in [-1, 1] (Tordesillas and How, "MINVO basis", 2020), in its factored form
+// a (1 - u) (u - r)^2 and e (u + 1) (u - p)^2 (and their mirrors), with the roots of the paper and a, e such that the
+// sum is exactly 1. The lambdas are then >= 0 and sum 1, so the curve is inside the hull of the vertices
+static double minvoBasis(int i, double u)
+{
+  const double r = 0.03092;
+  const double p = 0.77356;
+  const double a = 0.5 / (r * r + (1 + 2 * r) * p * p / (2 * p - 1));
+  const double e = a * (1 + 2 * r) / (2 * p - 1);
+  switch (i)
+  {
+    case 0:
+      return a * (1 - u) * (u - r) * (u - r);
+    case 1:
+      return e * (u + 1) * (u - p) * (u - p);
+    case 2:
+      return e * (1 - u) * (u + p) * (u + p);
+    default:
+      return a * (u + 1) * (u + r) * (u + r);
+  }
+}
+
+// Both bases give the same cubic, so it's enough that they agree at 4 instants
+Eigen::Matrix4d minvoFromBezier()
+{
+  Eigen::Matrix4d bernstein, minvo;
+  for (int j = 0; j < 4; j++)
+  {
+    double s = j / 3.0;
+    bernstein.col(j) << (1 - s) * (1 - s) * (1 - s), 3 * s * (1 - s) * (1 - s), 3 * s * s * (1 - s), s * s * s;
+    for (int i = 0; i < 4; i++)
+    {
+      minvo(i, j) = minvoBasis(i, 2 * s - 1);
+    }
+  }
+  return (bernstein * minvo.inverse()).transpose();
+}
+
+bool isTurn(const Vecf<3>& previous, const Vecf<3>& vertex, const Vecf<3>& next)
+{
+  Vecf<3> in = vertex - previous;
+  Vecf<3> out = next - vertex;
+  if (in.norm() < 1e-6 || out.norm() < 1e-6)
+  {
+    return false;
+  }
+  return in.normalized().dot(out.normalized()) < cos(20 * M_PI / 180);
+}
+
+int countTurns(const vec_Vecf<3>& path)
+{
+  int turns = 0;
+  for (int j = 1; j + 1 < path.size(); j++)
+  {
+    turns = turns + (isTurn(path[j - 1], path[j], path[j + 1]) ? 1 : 0);
+  }
+  return turns;
+}
+
+void sampleSolution(const std::vector<double>& coeffs, double dt, double dc, std::vector<state>& X)
+{
+  int N = coeffs.size() / 12;
+  int size = (int)(N)*dt / dc;
+  size = (size < 2) ? 2 : size;  // force size to be at least 2
+  X.assign(size, state());
+
+  double t = 0;
+  int interval = 0;
+  for (int i = 0; i < X.size(); i++)
+  {
+    t = t + dc;
+    if (t > dt * (interval + 1))
+    {
+      interval = std::min(interval + 1, N - 1);
+    }
+
+    // At^3 + Bt^2 + Ct + D of each axis
+    const double* c = &coeffs[12 * interval];
+    double tau = t - interval * dt;
+    double pos[3], vel[3], accel[3], jerk[3];
+    for (int ii = 0; ii < 3; ii++)
+    {
+      pos[ii] = c[0 + ii] * tau * tau * tau + c[3 + ii] * tau * tau + c[6 + ii] * tau + c[9 + ii];
+      vel[ii] = 3 * c[0 + ii] * tau * tau + 2 * c[3 + ii] * tau + c[6 + ii];
+      accel[ii] = 6 * c[0 + ii] * tau + 2 * c[3 + ii];
+      jerk[ii] = 6 * c[0 + ii];
+    }
+
+    X[i].setPos(pos[0], pos[1], pos[2]);
+    X[i].setVel(vel[0], vel[1], vel[2]);
+    X[i].setAccel(accel[0], accel[1], accel[2]);
+    X[i].setJerk(jerk[0], jerk[1], jerk[2]);
+  }
+
+  // Force the final input to be 0 (I'll keep applying this input if when I arrive to the final state I still
+  // haven't planned again).
+  X[X.size() - 1].vel = Eigen::Vector3d::Zero().transpose();
+  X[X.size() - 1].accel = Eigen::Vector3d::Zero().transpose();
+  X[X.size() - 1].jerk = Eigen::Vector3d::Zero().transpose();
+}
+
+#ifdef FASTER_WITH_GUROBI
+// Backend "gurobi_vs_qp": the same problems are solved with Gurobi (whose result is used) and with the qp backend,
+// and the differences are logged. To check the qp backend against Gurobi on recorded sequences (faster_bench)
+class ComparisonSolver : public TrajectorySolver
+{
+public:
+  void setup(const solver_settings& settings) override
+  {
+    reference_.setup(settings);
+    candidate_.setup(settings);
+  }
+  void setX0(state& data) override
+  {
+    reference_.setX0(data);
+    candidate_.setX0(data);
+  }
+  void setXf(state& data) override
+  {
+    reference_.setXf(data);
+    candidate_.setXf(data);
+  }
+  void setPolytopes(std::vector<LinearConstraint3D> polytopes) override
+  {
+    reference_.setPolytopes(polytopes);
+    candidate_.setPolytopes(polytopes);
+  }
+  void setGuidePath(const vec_Vecf<3>& path) override
+  {
+    reference_.setGuidePath(path);
+    candidate_.setGuidePath(path);
+  }
+  void setForceFinalConstraint(bool forceFinalConstraint) override
+  {
+    reference_.setForceFinalConstraint(forceFinalConstraint);
+    candidate_.setForceFinalConstraint(forceFinalConstraint);
+  }
+  void setFactorInitialAndFinalAndIncrement(double factor_initial, double factor_final,
+                                            double factor_increment) override
+  {
+    reference_.setFactorInitialAndFinalAndIncrement(factor_initial, factor_final, factor_increment);
+    candidate_.setFactorInitialAndFinalAndIncrement(factor_initial, factor_final, factor_increment);
+  }
+  // The two solvers run one after the other, each one with the time left now (so the candidate can end after the
+  // deadline: this backend is only for comparisons)
+  void setDeadline(std::chrono::steady_clock::time_point deadline) override
+  {
+    has_budget_ = (deadline != std::chrono::steady_clock::time_point::max());
+    budget_ = has_budget_ ? (deadline - std::chrono::steady_clock::now()) : std::chrono::steady_clock::duration::zero();
+  }
+  void warmUp(int n_polytopes, int n_faces) override
+  {
+    reference_.warmUp(n_polytopes, n_faces);
+    candidate_.warmUp(n_polytopes, n_faces);
+  }
+
+  bool genNewTraj() override
+  {
+    bool reference_cut = false, candidate_cut = false;
+    bool reference_solved = genWithBudget(reference_, reference_cut);
+    bool candidate_solved = genWithBudget(candidate_, candidate_cut);
+    if (reference_cut == true || candidate_cut == true)
+    {
+      FASTER_WARN("gurobi_vs_qp: " << (reference_cut ? "gurobi" : "") << (reference_cut && candidate_cut ? " and " : "")
+                                   << (candidate_cut ? "qp" : "") << " cut off by the deadline");
+    }
+
+    trials_ = reference_.trials_;
+    runtime_ms_ = reference_.runtime_ms_;
+    node_count_ = reference_.node_count_;
+    iterations_ = reference_.iterations_;
+    numeric_issues_ = reference_.numeric_issues_;
+    factor_that_worked_ = reference_.factor_that_worked_;
+    first_incumbent_ms_ = reference_.first_incumbent_ms_;
+    intervals_ = reference_.intervals_;
+
+    if (reference_solved != candidate_solved)
+    {
+      FASTER_WARN("gurobi_vs_qp: solved by " << (reference_solved ? "gurobi" : "qp") << " only");
+    }
+    else if (reference_solved == true)
+    {
+      std::vector<double> coeffs_ref, coeffs_qp;
+      double dt_ref, dt_qp;
+      reference_.getCoefficients(coeffs_ref, dt_ref);
+      candidate_.getCoefficients(coeffs_qp, dt_qp);
+      double max_distance = 0;
+      if (dt_ref == dt_qp)
+      {
+        reference_.fillX();
+        candidate_.fillX();
+        for (int i = 0; i < std::min(reference_.X_temp_.size(), candidate_.X_temp_.size()); i++)
+        {
+          max_distance = std::max(max_distance, (reference_.X_temp_[i].pos - candidate_.X_temp_[i].pos).norm());
+        }
+      }
+      FASTER_INFO("gurobi_vs_qp: factor " << reference_.factor_that_worked_ << " vs " << candidate_.factor_that_worked_
+                                          << ", cost " << jerkCost(coeffs_ref) << " vs " << jerkCost(coeffs_qp)
+                                          << ", max distance " << max_distance << " m, " << reference_.runtime_ms_
+                                          << " vs " << candidate_.runtime_ms_ << " ms");
+    }
+    return reference_solved;
+  }
+  void fillX() override
+  {
+    reference_.fillX();
+    X_temp_ = reference_.X_temp_;
+  }
+  void getCoefficients(std::vector<double>& coeffs, double& dt) override
+  {
+    reference_.getCoefficients(coeffs, dt);
+  }
+
+  void StopExecution() override
+  {
+    reference_.StopExecution();
+    candidate_.StopExecution();
+  }
+  void ResetToNormalState() override
+  {
+    reference_.ResetToNormalState();
+    candidate_.ResetToNormalState();
+  }
+
+private:
+  // cut: not solved because the budget ran out
+  bool genWithBudget(TrajectorySolver& solver, bool& cut)
+  {
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    if (has_budget_ == true)
+    {
+      deadline = std::chrono::steady_clock::now() + budget_;
+    }
+    solver.setDeadline(deadline);
+    bool solved = solver.genNewTraj();
+    cut = (solved == false && std::chrono::steady_clock::now() >= deadline);
+    return solved;
+  }
+
+  // Objective of both backends
+  static double jerkCost(const std::vector<double>& coeffs)
+  {
+    double cost = 0;
+    for (int t = 0; 12 * t < coeffs.size(); t++)
+    {
+      for (int i = 0; i < 3; i++)
+      {
+        cost = cost + 36 * coeffs[12 * t + i] * coeffs[12 * t + i];
+      }
+    }
+    return cost;
+  }
+
+  SolverGurobi reference_;
+  SolverQP candidate_;
+  bool has_budget_ = false;
+  std::chrono::steady_clock::duration budget_;  // Of each solver, from the last setDeadline()
+};
+#endif
+
+// See createAdaptiveSolver(). The inputs are kept until genNewTraj(), where N is chosen and they are given to the
+// solver of that N (the outputs are the ones of that solver)
+class AdaptiveSolver : public TrajectorySolver
+{
+public:
+  AdaptiveSolver(const std::string& backend, TrajectorySolver* largest) : backend_(backend)
+  {
+    largest_.reset(largest);
+  }
+
+  void setup(const solver_settings& settings) override
+  {
+    settings_ = settings;
+    settings_.N_min = std::max(std::min(settings.N_min, settings.N), 1);
+    largest_->setup(settings_);
+    shapes_[settings_.N] = std::move(largest_);
+    setFactorInitialAndFinalAndIncrement(settings.factor_initial, settings.factor_final, settings.factor_increment);
+    force_final_ = settings.force_final_constraint;
+  }
+  void setX0(state& data) override
+  {
+    x0_ = data;
+  }
+  void setXf(state& data) override
+  {
+    xf_ = data;
+  }
+  void setPolytopes(std::vector<LinearConstraint3D> polytopes) override
+  {
+    polytopes_ = polytopes;
+  }
+  void setGuidePath(const vec_Vecf<3>& path) override
+  {
+    guide_path_ = path;
+  }
+  void setForceFinalConstraint(bool forceFinalConstraint) override
+  {
+    force_final_ = forceFinalConstraint;
+  }
+  void setFactorInitialAndFinalAndIncrement(double factor_initial, double factor_final,
+                                            double factor_increment) override
+  {
+    factor_initial_ = factor_initial;
+    factor_final_ = factor_final;
+    factor_increment_ = factor_increment;
+  }
+  void setDeadline(std::chrono::steady_clock::time_point deadline) override
+  {
+    deadline_ = deadline;
+  }
+  // Builds the solvers of all the N in [N_min, N]. The one of each N for at most N - 2 polytopes (see chooseN())
+  void warmUp(int n_polytopes, int n_faces) override
+  {
+    std::lock_guard<std::mutex> lock(mtx_shapes_);
+    for (int N = settings_.N_min; N <= settings_.N; N++)
+    {
+      shape(N)->warmUp(std::max(std::min(n_polytopes, N - 2), 1), n_faces);
+    }
+  }
+
+  bool genNewTraj() override
+  {
+    int N = chooseN();
+    {
+      std::lock_guard<std::mutex> lock(mtx_shapes_);
+      active_ = shape(N);
+      if (stopped_ == true)
+      {
+        active_->StopExecution();  // StopExecution() was called before this solver was chosen
+      }
+    }
+
+    active_->setX0(x0_);
+    active_->setXf(xf_);
+    active_->setPolytopes(polytopes_);
+    active_->setGuidePath(guide_path_);
+    active_->setForceFinalConstraint(force_final_);
+    active_->setFactorInitialAndFinalAndIncrement(factor_initial_, factor_final_, factor_increment_);
+    active_->setDeadline(deadline_);
+    bool solved = active_->genNewTraj();
+
+    trials_ = active_->trials_;
+    runtime_ms_ = active_->runtime_ms_;
+    node_count_ = active_->node_count_;
+    iterations_ = active_->iterations_;
+    numeric_issues_ = active_->numeric_issues_;
+    factor_that_worked_ = active_->factor_that_worked_;
+    first_incumbent_ms_ = active_->first_incumbent_ms_;
+    intervals_ = N;
+    return solved;
+  }
+  void fillX() override
+  {
+    active_->fillX();
+    X_temp_ = active_->X_temp_;
+  }
+  void getCoefficients(std::vector<double>& coeffs, double& dt) override
+  {
+    active_->getCoefficients(coeffs, dt);
+  }
+
+  void StopExecution() override
+  {
+    std::lock_guard<std::mutex> lock(mtx_shapes_);
+    stopped_ = true;
+    if (active_ != nullptr)
+    {
+      active_->StopExecution();
+    }
+  }
+  void ResetToNormalState() override
+  {
+    std::lock_guard<std::mutex> lock(mtx_shapes_);
+    stopped_ = false;
+    for (auto& shape : shapes_)
+    {
+      shape.second->ResetToNormalState();
+    }
+  }
+
+private:
+  // Solver of this N (built and set up the first time). Call it with mtx_shapes_ locked
+  TrajectorySolver* shape(int N)
+  {
+    std::unique_ptr<TrajectorySolver>& solver = shapes_[N];
+    if (solver == nullptr)
+    {
+      solver_settings settings = settings_;
+      settings.N = N;
+      solver.reset(createTrajectorySolver(backend_));
+      solver->setup(settings);
+    }
+    return solver.get();
+  }
+
+  // At least two intervals more than polytopes (the same margin as N_whole and N_safe with max_poly_whole and
+  // max_poly_safe), one more per turn and one more per length_per_interval of the guide path
+  int chooseN()
+  {
+    int N = polytopes_.size() + 2 + countTurns(guide_path_);
+    double length = 0;
+    for (int j = 0; j + 1 < guide_path_.size(); j++)
+    {
+      length = length + (guide_path_[j + 1] - guide_path_[j]).norm();
+    }
+    N = N + (int)(length / settings_.length_per_interval);
+    return std::min(std::max(N, settings_.N_min), settings_.N);
+  }
+
+  std::string backend_;
+  solver_settings settings_;
+  std::unique_ptr<TrajectorySolver> largest_;  // Until setup()
+  std::map<int, std::unique_ptr<TrajectorySolver>> shapes_;  // One solver per N
+  TrajectorySolver* active_ = nullptr;  // Solver of the last genNewTraj()
+  std::mutex mtx_shapes_;               // shapes_, active_ and stopped_ (StopExecution() comes from other threads)
+  bool stopped_ = false;
+
+  state x0_, xf_;
+  std::vector<LinearConstraint3D> polytopes_;
+  vec_Vecf<3> guide_path_;
+  bool force_final_ = true;
+  double factor_initial_ = 1, factor_final_ = 10, factor_increment_ = 1;
+  std::chrono::steady_clock::time_point deadline_ = std::chrono::steady_clock::time_point::max();
+};
+
+// See createCachedSolver()
+class CachedSolver : public TrajectorySolver
+{
+public:
+  CachedSolver(TrajectorySolver* solver)
+  {
+    solver_.reset(solver);
+  }
+
+  void setup(const solver_settings& settings) override
+  {
+    settings_ = settings;
+    settings_.cache_size = std::max(settings.cache_size, 1);
+    force_final_ = settings.force_final_constraint;
+    factor_initial_ = settings.factor_initial;
+    factor_final_ = settings.factor_final;
+    solver_->setup(settings);
+  }
+  void setX0(state& data) override
+  {
+    x0_ = data;
+    solver_->setX0(data);
+  }
+  void setXf(state& data) override
+  {
+    xf_ = data;
+    solver_->setXf(data);
+  }
+  void setPolytopes(std::vector<LinearConstraint3D> polytopes) override
+  {
+    polytopes_ = polytopes;
+    solver_->setPolytopes(polytopes);
+  }
+  void setGuidePath(const vec_Vecf<3>& path) override
+  {
+    solver_->setGuidePath(path);
+  }
+  void setForceFinalConstraint(bool forceFinalConstraint) override
+  {
+    force_final_ = forceFinalConstraint;
+    solver_->setForceFinalConstraint(forceFinalConstraint);
+  }
+  void setFactorInitialAndFinalAndIncrement(double factor_initial, double factor_final,
+                                            double factor_increment) override
+  {
+    factor_initial_ = factor_initial;
+    factor_final_ = factor_final;
+    solver_->setFactorInitialAndFinalAndIncrement(factor_initial, factor_final, factor_increment);
+  }
+  void setDeadline(std::chrono::steady_clock::time_point deadline) override
+  {
+    solver_->setDeadline(deadline);
+  }
+  void warmUp(int n_polytopes, int n_faces) override
+  {
+    solver_->warmUp(n_polytopes, n_faces);
+  }
+
+  bool genNewTraj() override
+  {
+    Key key = makeKey();
+    auto it = index_.find(key.hash);
+    if (it != index_.end() && it->second->key.values == key.values && isValid(*it->second))
+    {
+      entries_.splice(entries_.begin(), entries_, it->second);  // Most recently used
+      coeffs_ = it->second->coeffs;
+      dt_ = it->second->dt;
+      trials_ = 0;
+      runtime_ms_ = 0;
+      node_count_ = 0;
+      iterations_ = 0;
+      numeric_issues_ = 0;
+      factor_that_worked_ = it->second->factor;
+      first_incumbent_ms_ = 0;
+      intervals_ = coeffs_.size() / 12;
+      from_cache_ = true;
+      return true;
+    }
+
+    bool solved = solver_->genNewTraj();
+    trials_ = solver_->trials_;
+    runtime_ms_ = solver_->runtime_ms_;
+    node_count_ = solver_->node_count_;
+    iterations_ = solver_->iterations_;
+    numeric_issues_ = solver_->numeric_issues_;
+    factor_that_worked_ = solver_->factor_that_worked_;
+    first_incumbent_ms_ = solver_->first_incumbent_ms_;
+    intervals_ = solver_->intervals_;
+    from_cache_ = false;
+    if (solved == false)
+    {
+      return false;
+    }
+
+    solver_->getCoefficients(coeffs_, dt_);
+    if (it != index_.end())
+    {
+      entries_.erase(it->second);  // Stale (or a collision of the hash)
+      index_.erase(it);
+    }
+    entries_.push_front(Entry{ key, coeffs_, dt_, factor_that_worked_ });
+    index_[key.hash] = entries_.begin();
+    if (entries_.size() > settings_.cache_size)
+    {
+      index_.erase(entries_.back().key.hash);
+      entries_.pop_back();
+    }
+    return true;
+  }
+  void fillX() override
+  {
+    if (from_cache_ == true)
+    {
+      sampleSolution(coeffs_, dt_, settings_.dc, X_temp_);
+      return;
+    }
+    solver_->fillX();
+    X_temp_ = solver_->X_temp_;
+  }
+  void getCoefficients(std::vector<double>& coeffs, double& dt) override
+  {
+    coeffs = coeffs_;
+    dt = dt_;
+  }
+
+  void StopExecution() override
+  {
+    solver_->StopExecution();
+  }
+  void ResetToNormalState() override
+  {
+    solver_->ResetToNormalState();
+  }
+
+private:
+  struct Key
+  {
+    std::vector<int64_t> values;  // Quantized X0 and Xf, force_final_ and the hash of the polytopes
+    uint64_t hash;
+  };
+  struct Entry
+  {
+    Key key;
+    std::vector<double> coeffs;
+    double dt;
+    double factor;
+  };
+
+  // FNV-1a
+  static uint64_t hashBytes(const void* data, size_t size, uint64_t hash)
+  {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+      hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+  }
+
+  Key makeKey() const
+  {
+    Key key;
+    for (const state* s : { &x0_, &xf_ })
+    {
+      for (const Eigen::Vector3d* v : { &s->pos, &s->vel, &s->accel })
+      {
+        for (int i = 0; i < 3; i++)
+        {
+          key.values.push_back((int64_t)std::llround((*v)(i) / settings_.cache_resolution));
+        }
+      }
+    }
+    key.values.push_back(force_final_ ? 1 : 0);
+
+    uint64_t poly_hash = 14695981039346656037ULL;
+    for (const LinearConstraint3D& poly : polytopes_)
+    {
+      poly_hash = hashBytes(poly.A_.data(), poly.A_.size() * sizeof(double), poly_hash);
+      poly_hash = hashBytes(poly.b_.data(), poly.b_.size() * sizeof(double), poly_hash);
+    }
+    int64_t poly_value;
+    std::memcpy(&poly_value, &poly_hash, sizeof(poly_value));
+    key.values.push_back(poly_value);
+
+    key.hash = hashBytes(key.values.data(), key.values.size() * sizeof(int64_t), 14695981039346656037ULL);
+    return key;
+  }
+
+  // Same constraints as the solvers: starts at X0 (within the resolution of the key) and ends at Xf, each interval
+  // inside one of the polytopes (its Bezier control points), and the limits at the ends of each interval
+  bool isValid(const Entry& entry) const
+  {
+    if (entry.factor < factor_initial_ || entry.factor > factor_final_)
+    {
+      return false;  // factor_that_worked_ is outside of the factors that would be tried now
+    }
+
+    const double tol = 1e-6;
+    double dt = entry.dt;
+    int N = entry.coeffs.size() / 12;
+    for (int t = 0; t < N; t++)
+    {
+      const double* c = &entry.coeffs[12 * t];
+      Eigen::Matrix<double, 3, 4> cps;  // Control points (columns)
+      for (int i = 0; i < 3; i++)
+      {
+        double a = c[0 + i], b = c[3 + i], cc = c[6 + i], d = c[9 + i];
+        cps.row(i) << d, d + cc * dt / 3, d + 2 * cc * dt / 3 + b * dt * dt / 3,
+            d + cc * dt + b * dt * dt + a * dt * dt * dt;
+
+        double vel[2] = { cc, 3 * a * dt * dt + 2 * b * dt + cc };
+        double accel[2] = { 2 * b, 6 * a * dt + 2 * b };
+        if (fabs(6 * a) > settings_.j_max + tol || std::max(fabs(vel[0]), fabs(vel[1])) > settings_.v_max + tol ||
+            std::max(fabs(accel[0]), fabs(accel[1])) > settings_.a_max + tol)
+        {
+          return false;
+        }
+        if (t == 0 && (fabs(d - x0_.pos(i)) > settings_.cache_resolution ||
+                       fabs(vel[0] - x0_.vel(i)) > settings_.cache_resolution ||
+                       fabs(accel[0] - x0_.accel(i)) > settings_.cache_resolution))
+        {
+          return false;
+        }
+        if (t == N - 1 && ((force_final_ == true && fabs(cps(i, 3) - xf_.pos(i)) > settings_.cache_resolution) ||
+                           fabs(vel[1] - xf_.vel(i)) > settings_.cache_resolution ||
+                           fabs(accel[1] - xf_.accel(i)) > settings_.cache_resolution))
+        {
+          return false;
+        }
+      }
+
+      if (settings_.formulation == "minvo")
+      {
+        static const Eigen::Matrix4d M = minvoFromBezier();
+        cps = cps * M.transpose();  // The hull that the solver constrained (tighter than the Bezier one)
+      }
+      bool inside = false;
+      for (int poly = 0; poly < polytopes_.size() && inside == false; poly++)
+      {
+        inside = ((polytopes_[poly].A_ * cps).colwise() - polytopes_[poly].b_).maxCoeff() <= tol;
+      }
+      if (inside == false)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::unique_ptr<TrajectorySolver> solver_;
+  solver_settings settings_;
+  std::list<Entry> entries_;  // Most recently used first
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+
+  state x0_, xf_;
+  std::vector<LinearConstraint3D> polytopes_;
+  bool force_final_ = true;
+  double factor_initial_ = 1, factor_final_ = 10;
+
+  std::vector<double> coeffs_;  // Of the last genNewTraj() that succeeded
+  double dt_ = 0;
+};
+
+TrajectorySolver* createCachedSolver(TrajectorySolver* solver)
+{
+  return new CachedSolver(solver);
+}
+
+TrajectorySolver* createAdaptiveSolver(const std::string& backend)
+{
+  TrajectorySolver* largest = createTrajectorySolver(backend);
+  if (largest == nullptr)
+  {
+    return nullptr;
+  }
+  return new AdaptiveSolver(backend, largest);
+}
+
+TrajectorySolver* createTrajectorySolver(const std::string& backend)
+{
+  if (backend == "qp")
+  {
+    return new SolverQP();
+  }
+#ifdef FASTER_WITH_GUROBI
+  if (backend == "gurobi")
+  {
+    return new SolverGurobi();
+  }
+  if (backend == "gurobi_vs_qp")
+  {
+    return new ComparisonSolver();
+  }
+#endif
+  return nullptr;
+}
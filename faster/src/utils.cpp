@@ -24,213 +24,6 @@ void printStateVector(std::vector<state>& data)
   }
 }
 
-void vectorOfVectors2MarkerArray(vec_Vecf<3> traj, visualization_msgs::MarkerArray* m_array, std_msgs::ColorRGBA color,
-                                 int type, std::vector<double> radii)
-{
-  if (traj.size() == 0)
-  {
-    return;
-  }
-
-  // printf("In vectorOfVectors2MarkerArray\n");
-  geometry_msgs::Point p_last = eigen2point(traj[0]);
-
-  bool first_element = true;
-  int i = 50000;  // large enough to prevent conflict with other markers
-  int j = 0;
-
-  for (const auto& it : traj)
-  {
-    i++;
-    if (first_element and type == visualization_msgs::Marker::ARROW)  // skip the first element
-    {
-      first_element = false;
-      continue;
-    }
-
-    visualization_msgs::Marker m;
-    m.type = type;
-    m.action = visualization_msgs::Marker::ADD;
-    m.id = i;
-    m.color = color;
-    // m.scale.z = 1;
-
-    m.header.frame_id = "world";
-    m.header.stamp = ros::Time::now();
-    geometry_msgs::Point p = eigen2point(it);
-    if (type == visualization_msgs::Marker::ARROW)
-    {
-      m.scale.x = 0.02;
-      m.scale.y = 0.04;
-      m.points.push_back(p_last);
-      m.points.push_back(p);
-      // std::cout << "pushing marker\n" << m << std::endl;
-      p_last = p;
-    }
-    else
-    {
-      double scale = 0.1;  // Scale is the diameter of the sphere
-      if (radii.size() != 0)
-      {  // If argument provided
-        scale = 2 * radii[j];
-      }
-      m.scale.x = scale;
-      m.scale.y = scale;
-      m.scale.z = scale;
-      m.pose.position = p;
-    }
-    (*m_array).markers.push_back(m);
-    j = j + 1;
-  }
-}
-
-std_msgs::ColorRGBA getColorJet(double v, double vmin, double vmax)
-{
-  std_msgs::ColorRGBA c;
-  c.r = 1;
-  c.g = 1;
-  c.b = 1;
-  c.a = 1;
-  // white
-  double dv;
-
-  if (v < vmin)
-    v = vmin;
-  if (v > vmax)
-    v = vmax;
-  dv = vmax - vmin;
-
-  if (v < (vmin + 0.25 * dv))
-  {
-    c.r = 0;
-    c.g = 4 * (v - vmin) / dv;
-  }
-  else if (v < (vmin + 0.5 * dv))
-  {
-    c.r = 0;
-    c.b = 1 + 4 * (vmin + 0.25 * dv - v) / dv;
-  }
-  else if (v < (vmin + 0.75 * dv))
-  {
-    c.r = 4 * (v - vmin - 0.5 * dv) / dv;
-    c.b = 0;
-  }
-  else
-  {
-    c.g = 1 + 4 * (vmin + 0.75 * dv - v) / dv;
-    c.b = 0;
-  }
-
-  return (c);
-}
-
-std_msgs::ColorRGBA color(int id)
-{
-  std_msgs::ColorRGBA red;
-  red.r = 1;
-  red.g = 0;
-  red.b = 0;
-  red.a = 1;
-  std_msgs::ColorRGBA red_trans;
-  red_trans.r = 1;
-  red_trans.g = 0;
-  red_trans.b = 0;
-  red_trans.a = 0.7;
-  std_msgs::ColorRGBA red_trans_trans;
-  red_trans_trans.r = 1;
-  red_trans_trans.g = 0;
-  red_trans_trans.b = 0;
-  red_trans_trans.a = 0.4;
-  std_msgs::ColorRGBA blue;
-  blue.r = 0;
-  blue.g = 0;
-  blue.b = 1;
-  blue.a = 1;
-  std_msgs::ColorRGBA blue_trans;
-  blue_trans.r = 0;
-  blue_trans.g = 0;
-  blue_trans.b = 1;
-  blue_trans.a = 0.7;
-  std_msgs::ColorRGBA blue_trans_trans;
-  blue_trans_trans.r = 0;
-  blue_trans_trans.g = 0;
-  blue_trans_trans.b = 1;
-  blue_trans_trans.a = 0.4;
-  std_msgs::ColorRGBA blue_light;
-  blue_light.r = 0.5;
-  blue_light.g = 0.7;
-  blue_light.b = 1;
-  blue_light.a = 1;
-  std_msgs::ColorRGBA green;
-  green.r = 0;
-  green.g = 1;
-  green.b = 0;
-  green.a = 1;
-  std_msgs::ColorRGBA yellow;
-  yellow.r = 1;
-  yellow.g = 1;
-  yellow.b = 0;
-  yellow.a = 1;
-  std_msgs::ColorRGBA orange_trans;  // orange transparent
-  orange_trans.r = 1;
-  orange_trans.g = 0.5;
-  orange_trans.b = 0;
-  orange_trans.a = 0.7;
-  switch (id)
-  {
-    case RED:
-      return red;
-      break;
-    case RED_TRANS:
-      return red_trans;
-      break;
-    case RED_TRANS_TRANS:
-      return red_trans_trans;
-      break;
-    case BLUE:
-      return blue;
-      break;
-    case BLUE_TRANS:
-      return blue_trans;
-      break;
-    case BLUE_TRANS_TRANS:
-      return blue_trans_trans;
-      break;
-    case BLUE_LIGHT:
-      return blue_light;
-      break;
-    case GREEN:
-      return green;
-      break;
-    case YELLOW:
-      return yellow;
-      break;
-    case ORANGE_TRANS:
-      return orange_trans;
-      break;
-    default:
-      ROS_ERROR("COLOR NOT DEFINED");
-  }
-}
-
-//## From Wikipedia - http://en.wikipedia.org/wiki/Conversion_between_quaternions_and_Euler_angles
-void quaternion2Euler(tf2::Quaternion q, double& roll, double& pitch, double& yaw)
-{
-  tf2::Matrix3x3(q).getRPY(roll, pitch, yaw);
-}
-
-void quaternion2Euler(Eigen::Quaterniond q, double& roll, double& pitch, double& yaw)
-{
-  tf2::Quaternion tf_q(q.x(), q.y(), q.z(), q.w());
-  quaternion2Euler(tf_q, roll, pitch, yaw);
-}
-
-void quaternion2Euler(geometry_msgs::Quaternion q, double& roll, double& pitch, double& yaw)
-{
-  tf2::Quaternion tf_q(q.x, q.y, q.z, q.w);
-  quaternion2Euler(tf_q, roll, pitch, yaw);
-}
-
 void saturate(double& var, double min, double max)
 {
   // std::cout << "min=" << min << " max=" << max << std::endl;
@@ -247,21 +40,6 @@ void saturate(double& var, double min, double max)
   // std::cout << "Value saturated" << var << std::endl;
 }
 
-visualization_msgs::Marker getMarkerSphere(double scale, int my_color)
-{
-  visualization_msgs::Marker marker;
-
-  marker.header.frame_id = "world";
-  marker.id = 0;
-  marker.type = visualization_msgs::Marker::SPHERE;
-  marker.scale.x = scale;
-  marker.scale.y = scale;
-  marker.scale.z = scale;
-  marker.color = color(my_color);
-
-  return marker;
-}
-
 double angleBetVectors(const Eigen::Vector3d& a, const Eigen::Vector3d& b)
 {
   // printf("In angleBetVEctors\n");
@@ -330,7 +108,7 @@ void printElementsOfJPS(vec_Vecf<3>& path)
 std::vector<Eigen::Vector3d> samplePointsSphereWithJPS(Eigen::Vector3d& B, double r, Eigen::Vector3d& center_sent,
                                                        vec_Vecf<3>& path_sent, int last_index_inside_sphere)
 {
-  printf("In samplePointsSphereWithJPS\n");
+  FASTER_DEBUG("In samplePointsSphereWithJPS");
   // printElementsOfJPS(path_sent);
 
   vec_Vecf<3> path;
@@ -377,8 +155,8 @@ std::vector<Eigen::Vector3d> samplePointsSphereWithJPS(Eigen::Vector3d& B, doubl
     /*    Eigen::Vector3d& point_i_ref(point_i);      // point i expressed with origin=origin sphere
         Eigen::Vector3d& point_im1_ref(point_im1);  // point i minus 1*/
 
-    std::cout << "i=" << i << "point_i=" << path[i].transpose() << std::endl;
-    std::cout << "i=" << i << "point_im1=" << path[i - 1].transpose() << std::endl;
+    FASTER_DEBUG("i=" << i << "point_i=" << path[i].transpose());
+    FASTER_DEBUG("i=" << i << "point_im1=" << path[i - 1].transpose());
 
     Eigen::Vector3d a = point_i;
     Eigen::Vector3d b = point_im1;
@@ -390,8 +168,8 @@ std::vector<Eigen::Vector3d> samplePointsSphereWithJPS(Eigen::Vector3d& B, doubl
       double tmp = a.dot(b) / (a.norm() * b.norm());
       saturate(tmp, -1, 1);
       angle_max = acos(tmp);
-      printf("tmp=%f\n", tmp);
-      printf("angle_max=%f\n", angle_max);
+      FASTER_DEBUG("tmp=" << tmp);
+      FASTER_DEBUG("angle_max=" << angle_max);
       if (angle_max < 0.02)
       {
         samples.push_back(B);
@@ -419,8 +197,7 @@ std::vector<Eigen::Vector3d> samplePointsSphereWithJPS(Eigen::Vector3d& B, doubl
         }*/
 
     Eigen::Vector3d perp = (point_i.cross(point_im1)).normalized();  // perpendicular vector to point_i and point_ip1;
-    printf("Perpendicular vector=\n");
-    std::cout << perp << std::endl;
+    FASTER_DEBUG("Perpendicular vector=\n" << perp);
 
     for (double angle = 0; angle < angle_max; angle = angle + 0.34)
     {
@@ -483,10 +260,10 @@ std::vector<Eigen::Vector3d> samplePointsSphereWithJPS(Eigen::Vector3d& B, doubl
   samples.insert(samples.end(), uniform_samples.begin(),
                  uniform_samples.end());  // concatenate samples and uniform samples
 
-  printf("**y despues samples vale:\n");
+  FASTER_DEBUG("**y despues samples vale:");
   for (int i = 0; i < samples.size(); i++)
   {
-    std::cout << samples[i].transpose() << std::endl;
+    FASTER_DEBUG(samples[i].transpose());
   }
   /*printf("returning it:\n");*/
 
@@ -565,65 +342,13 @@ float solvePolyOrder2(Eigen::Vector3f coeff)
       return x2;
     }
   }
-  printf("No solution found to the equation\n");
+  FASTER_WARN("No solution found to the equation");
   return std::numeric_limits<float>::max();
 }
 
 // coeff is from highest degree to lowest degree. Returns the smallest positive real solution. Returns -1 if a
 // root is imaginary or if it's negative
 
-geometry_msgs::Point pointOrigin()
-{
-  geometry_msgs::Point tmp;
-  tmp.x = 0;
-  tmp.y = 0;
-  tmp.z = 0;
-  return tmp;
-}
-
-Eigen::Vector3d vec2eigen(geometry_msgs::Vector3 vector)
-{
-  Eigen::Vector3d tmp;
-  tmp << vector.x, vector.y, vector.z;
-  return tmp;
-}
-
-geometry_msgs::Vector3 eigen2rosvector(Eigen::Vector3d vector)
-{
-  geometry_msgs::Vector3 tmp;
-  tmp.x = vector(0, 0);
-  tmp.y = vector(1, 0);
-  tmp.z = vector(2, 0);
-  return tmp;
-}
-
-geometry_msgs::Point eigen2point(Eigen::Vector3d vector)
-{
-  geometry_msgs::Point tmp;
-  tmp.x = vector[0];
-  tmp.y = vector[1];
-  tmp.z = vector[2];
-  return tmp;
-}
-
-geometry_msgs::Vector3 vectorNull()
-{
-  geometry_msgs::Vector3 tmp;
-  tmp.x = 0;
-  tmp.y = 0;
-  tmp.z = 0;
-  return tmp;
-}
-
-geometry_msgs::Vector3 vectorUniform(double a)
-{
-  geometry_msgs::Vector3 tmp;
-  tmp.x = a;
-  tmp.y = a;
-  tmp.z = a;
-  return tmp;
-}
-
 template <typename T>
 using vec_E = std::vector<T, Eigen::aligned_allocator<T>>;
 
@@ -736,8 +461,8 @@ Eigen::Vector3d getIntersectionWithSphere(Eigen::Vector3d& A, Eigen::Vector3d& B
   float discrim = b * b - 4 * a * c;
   if (discrim <= 0)
   {
-    printf("The line is tangent or doesn't intersect, returning the intersection with the center and the first "
-           "point\n");
+    FASTER_DEBUG("The line is tangent or doesn't intersect, returning the intersection with the center and the first "
+                 "point");
 
     float x1 = center[0];
     float y1 = center[1];
@@ -838,7 +563,7 @@ Eigen::Vector3d getFirstIntersectionWithSphere(vec_Vecf<3>& path, double r, Eige
       }
       break;
     case 0:  // First element is outside the sphere
-      printf("First element is still oustide the sphere, there is sth wrong, returning the first element\n");
+      FASTER_WARN("First element is still oustide the sphere, there is sth wrong, returning the first element");
       intersection = path[0];
       // std::cout << "radius=" << r << std::endl;
       // std::cout << "dist=" << (path[0] - center).norm() << std::endl;
@@ -940,7 +665,7 @@ Eigen::Vector3d getLastIntersectionWithSphere(vec_Vecf<3> path, double r, Eigen:
 
   if (index == path.size() - 1)
   {
-    printf("ERROR, the goal is inside the sphere Sb, returning the last point\n");
+    FASTER_WARN("ERROR, the goal is inside the sphere Sb, returning the last point");
     *Jdist = 0;
     return path[path.size() - 1];
   }
@@ -1017,49 +742,6 @@ vec_Vecf<3> copyJPS(vec_Vecf<3> path)
   return tmp;
 }
 
-visualization_msgs::MarkerArray stateVector2ColoredMarkerArray(const std::vector<state>& data, int type,
-                                                               double max_value)
-{
-  visualization_msgs::MarkerArray marker_array;
-
-  if (data.size() == 0)
-  {
-    return marker_array;
-  }
-  geometry_msgs::Point p_last;
-  p_last.x = data[0].pos(0);
-  p_last.y = data[0].pos(1);
-  p_last.z = data[0].pos(2);
-
-  int j = type * 9000;
-  for (int i = 0; i < data.size(); i = i + 1)
-  {
-    j = j + 1;
-    double vel = data[i].vel.norm();
-    visualization_msgs::Marker m;
-    m.type = visualization_msgs::Marker::ARROW;
-    m.header.frame_id = "world";
-    m.header.stamp = ros::Time::now();
-    m.action = visualization_msgs::Marker::ADD;
-    m.id = j;
-    m.color = getColorJet(vel, 0, max_value);  // note that par_.v_max is per axis!
-    m.scale.x = 0.15;
-    m.scale.y = 0;
-    m.scale.z = 0;
-    // std::cout << "Mandando bloque" << X.block(i, 0, 1, 3) << std::endl;
-    geometry_msgs::Point p;
-    p.x = data[i].pos(0);
-    p.y = data[i].pos(1);
-    p.z = data[i].pos(2);
-    m.points.push_back(p_last);
-    m.points.push_back(p);
-    // std::cout << "pushing marker\n" << m << std::endl;
-    p_last = p;
-    marker_array.markers.push_back(m);
-  }
-  return marker_array;
-}
-
 // P1-P2 is the direction used for projection. P2 is the goal clicked. wdx, wdy and wdz are the widths of a 3D box
 // centered on P1
 Eigen::Vector3d projectPointToBox(Eigen::Vector3d& P1, Eigen::Vector3d& P2, double wdx, double wdy, double wdz)
@@ -1099,7 +781,7 @@ Eigen::Vector3d projectPointToBox(Eigen::Vector3d& P1, Eigen::Vector3d& P2, doub
 
   if (intersections.size() == 0)
   {  // There is no intersection
-    ROS_ERROR("This is impossible, there should be an intersection");
+    FASTER_ERROR(termcolor::red << "This is impossible, there should be an intersection" << termcolor::reset);
   }
   std::vector<double> distances;
   // And now take the nearest intersection
@@ -6,6 +6,7 @@
 #define ELLIPSOID_DECOMP_H
 
 #include <memory>
+#include <chrono>
 #include <decomp_util/line_segment.h>
 
 /**
@@ -91,16 +92,27 @@ public:
    * @brief Decomposition thread
    * @param path The path to dilate
    * @param offset_x offset added to the long semi-axis, default is 0
+   * @param deadline if reached, the segments left are not dilated and the path is truncated (get_path() returns the
+   * part covered by the polyhedra). The first segment is always dilated
    */
-  void dilate(const vec_Vecf<Dim> &path, double offset_x = 0)
+  void dilate(const vec_Vecf<Dim> &path, double offset_x = 0,
+              std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max())
   {
-    const unsigned int N = path.size() - 1;
+    unsigned int N = path.size() - 1;
     lines_.resize(N);
     ellipsoids_.resize(N);
     polyhedrons_.resize(N);
 
     for (unsigned int i = 0; i < N; i++)
     {
+      if (i > 0 && std::chrono::steady_clock::now() > deadline)
+      {
+        N = i;
+        lines_.resize(N);
+        ellipsoids_.resize(N);
+        polyhedrons_.resize(N);
+        break;
+      }
       lines_[i] = std::make_shared<LineSegment<Dim>>(path[i], path[i + 1]);
       lines_[i]->set_local_bbox(local_bbox_);
       lines_[i]->set_obs(obs_);
@@ -110,7 +122,7 @@ public:
       polyhedrons_[i] = lines_[i]->get_polyhedron();
     }
 
-    path_ = path;
+    path_ = vec_Vecf<Dim>(path.begin(), path.begin() + N + 1);
 
     if (global_bbox_min_.norm() != 0 || global_bbox_max_.norm() != 0)
     {
@@ -7,7 +7,6 @@
 
 #include <iostream>
 #include <jps_basis/data_type.h>
-#include "ros/ros.h"
 #include <pcl/kdtree/kdtree_flann.h>
 
 namespace JPS
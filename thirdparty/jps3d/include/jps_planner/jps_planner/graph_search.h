@@ -11,6 +11,7 @@
 #include <limits>                         // std::numeric_limits
 #include <vector>                         // std::vector
 #include <unordered_map>                  // std::unordered_map
+#include <chrono>                         // std::chrono::steady_clock
 
 namespace JPS
 {
@@ -189,6 +190,9 @@ namespace JPS
        */
       bool plan(int xStart, int yStart, int zStart, int xGoal, int yGoal, int zGoal, bool useJps, int maxExpand = -1);
 
+      /// Stop planning (and return false) once this time is reached. Default is no limitation
+      void setDeadline(std::chrono::steady_clock::time_point deadline);
+
       /// Get the optimal path
       std::vector<StatePtr> getPath() const;
 
@@ -253,6 +257,7 @@ namespace JPS
       int xGoal_, yGoal_, zGoal_;
       bool use_2d_;
       bool use_jps_ = false;
+      std::chrono::steady_clock::time_point deadline_ = std::chrono::steady_clock::time_point::max();
 
       priorityQueue pq_;
       std::vector<StatePtr> hm_;
@@ -45,6 +45,8 @@ public:
   void updateMap();
   /// Planning function
   bool plan(const Vecf<Dim> &start, const Vecf<Dim> &goal, decimal_t eps = 1, bool use_jps = true);
+  /// The next calls to plan() give up (no path found) when this time is reached
+  void setDeadline(std::chrono::steady_clock::time_point deadline);
   /// Get the nodes in open set
   vec_Vecf<Dim> getOpenSet() const;
   /// Get the nodes in close set
@@ -65,6 +67,8 @@ protected:
   int status_ = 0;
   /// Enabled for printing info
   bool planner_verbose_;
+  /// Deadline passed to the graph search
+  std::chrono::steady_clock::time_point deadline_ = std::chrono::steady_clock::time_point::max();
   /// 1-D map array
   std::vector<char> cmap_;
 };
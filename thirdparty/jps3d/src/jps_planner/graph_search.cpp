@@ -120,6 +120,10 @@ bool GraphSearch::plan(int xStart, int yStart, int  zStart, int xGoal, int yGoal
   return plan(currNode_ptr, maxExpand, start_id, goal_id);
 }
 
+void GraphSearch::setDeadline(std::chrono::steady_clock::time_point deadline) {
+  deadline_ = deadline;
+}
+
 bool GraphSearch::plan(StatePtr& currNode_ptr, int maxExpand, int start_id, int goal_id) {
   // Insert start node
   currNode_ptr->heapkey = pq_.push(currNode_ptr);
@@ -200,6 +204,13 @@ bool GraphSearch::plan(StatePtr& currNode_ptr, int maxExpand, int start_id, int
       return false;
     }
 
+    // Reading the clock is not free, check it only every 64 expansions
+    if((expand_iteration & 63) == 0 && std::chrono::steady_clock::now() > deadline_) {
+      if(verbose_)
+        printf("Deadline reached after [%d] expansions!!!!!!\n\n", expand_iteration);
+      return false;
+    }
+
     if( pq_.empty()) {
       if(verbose_)
         printf("Priority queue is empty!!!!!!\n\n");
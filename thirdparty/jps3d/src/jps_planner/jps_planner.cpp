@@ -192,6 +192,12 @@ void JPSPlanner<Dim>::updateMap()
     }*/
 }
 
+template <int Dim>
+void JPSPlanner<Dim>::setDeadline(std::chrono::steady_clock::time_point deadline)
+{
+  deadline_ = deadline;
+}
+
 template <int Dim>
 bool JPSPlanner<Dim>::plan(const Vecf<Dim> &start, const Vecf<Dim> &goal, decimal_t eps, bool use_jps)
 {
@@ -249,11 +255,13 @@ bool JPSPlanner<Dim>::plan(const Vecf<Dim> &start, const Vecf<Dim> &goal, decima
   {
     graph_search_ =
         std::make_shared<JPS::GraphSearch>((map_util_->map_).data(), dim(0), dim(1), dim(2), eps, planner_verbose_);
+    graph_search_->setDeadline(deadline_);
     graph_search_->plan(start_int(0), start_int(1), start_int(2), goal_int(0), goal_int(1), goal_int(2), use_jps);
   }
   else
   {
     graph_search_ = std::make_shared<JPS::GraphSearch>(cmap_.data(), dim(0), dim(1), eps, planner_verbose_);
+    graph_search_->setDeadline(deadline_);
     graph_search_->plan(start_int(0), start_int(1), goal_int(0), goal_int(1), use_jps);
   }
 